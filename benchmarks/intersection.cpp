@@ -0,0 +1,117 @@
+#include <crawler/intersection.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string_view>
+#include <vector>
+
+using crawler::occurence_t;
+using crawler::position_t;
+
+// Times every pairwise kernel on same inputs: balanced sizes (merge and SIMD should win) and skewed
+// ones (one rare ngram and one which is everywhere, galloping should win). `intersection` is what
+// search uses, it should be as fast as the best kernel of every row.
+//
+// usage: intersection-benchmark [scale]  (sizes are multiplied by it, 1 by default)
+
+namespace {
+
+// sorted and unique, ids of `documents` with positions of short documents, so common ngrams overlap a lot
+auto random_occurences(size_t count, uint32_t documents, unsigned seed) -> std::vector<occurence_t> {
+	auto engine = std::mt19937{seed};
+	auto id = std::uniform_int_distribution<uint32_t>{0, documents - 1u};
+	auto position = std::uniform_int_distribution<uint32_t>{0, 255};
+
+	std::vector<occurence_t> output;
+	output.reserve(count);
+
+	for (size_t i = 0; i != count; ++i) {
+		output.push_back(occurence_t{.id = id(engine), .position = position_t{position(engine)}});
+	}
+
+	std::ranges::sort(output);
+	const auto duplicates = std::ranges::unique(output);
+	output.erase(duplicates.begin(), duplicates.end());
+
+	return output;
+}
+
+// best of enough runs to take at least 100ms
+template <typename Kernel> auto time_of(Kernel && kernel) -> std::chrono::nanoseconds {
+	using clock = std::chrono::steady_clock;
+
+	auto best = std::chrono::nanoseconds::max();
+	auto total = std::chrono::nanoseconds{0};
+
+	for (int runs = 0; runs < 5 || total < std::chrono::milliseconds{100}; ++runs) {
+		const auto start = clock::now();
+		const auto result = kernel();
+		const auto took = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start);
+
+		// keeps the result alive, so the call isn't optimized out
+		if (result.size() == static_cast<size_t>(-1)) {
+			std::abort();
+		}
+
+		best = std::min(best, took);
+		total += took;
+	}
+
+	return best;
+}
+
+struct case_t {
+	std::string_view name;
+	size_t small;
+	size_t big;
+};
+
+} // namespace
+
+int main(int argc, char ** argv) {
+	const size_t scale = (argc > 1) ? std::max(std::strtoul(argv[1], nullptr, 10), 1ul) : 1u;
+
+	// same number of documents everywhere, so the density of a list is its size
+	constexpr uint32_t documents = 100'000;
+
+	const case_t cases[] = {
+		{"balanced", 100'000, 100'000},
+		{"balanced big", 1'000'000, 1'000'000},
+		{"1:10", 100'000, 1'000'000},
+		{"1:100", 10'000, 1'000'000},
+		{"1:1000", 1'000, 1'000'000},
+		{"1:10000", 100, 1'000'000},
+	};
+
+	const bool avx2 = crawler::selected_intersection_kernel() == crawler::intersection_kernel::avx2;
+
+	std::cout << "simd kernel = " << crawler::kernel_name(crawler::selected_intersection_kernel()) << (avx2 ? "" : " (simd column is the scalar merge)") << "\n";
+	std::cout << std::left << std::setw(14) << "case" << std::right << std::setw(10) << "small" << std::setw(10) << "big" << std::setw(10) << "output" << std::setw(12) << "merge us" << std::setw(12) << "simd us" << std::setw(12) << "gallop us" << std::setw(12) << "picked us" << "\n";
+
+	for (const case_t & item: cases) {
+		const auto small = random_occurences(item.small * scale, documents, 1);
+		const auto big = random_occurences(item.big * scale, documents, 2);
+
+		const auto expected = crawler::merge_intersection(small, big);
+
+		if (crawler::simd_intersection(small, big) != expected || crawler::galloping_intersection(small, big) != expected || crawler::intersection(small, big) != expected) {
+			std::cerr << "kernels don't agree on " << item.name << "\n";
+			return 1;
+		}
+
+		const auto merge = time_of([&] { return crawler::merge_intersection(small, big); });
+		const auto simd = time_of([&] { return crawler::simd_intersection(small, big); });
+		const auto gallop = time_of([&] { return crawler::galloping_intersection(small, big); });
+		const auto picked = time_of([&] { return crawler::intersection(small, big); });
+
+		const auto us = [](std::chrono::nanoseconds ns) { return static_cast<double>(ns.count()) / 1000.0; };
+
+		std::cout << std::left << std::setw(14) << item.name << std::right << std::setw(10) << small.size() << std::setw(10) << big.size() << std::setw(10) << expected.size();
+		std::cout << std::fixed << std::setprecision(1) << std::setw(12) << us(merge) << std::setw(12) << us(simd) << std::setw(12) << us(gallop) << std::setw(12) << us(picked) << "\n";
+	}
+
+	return 0;
+}
@@ -1,20 +1,51 @@
+#include <algorithm>
 #include <atomic>
 #include <co_curl/co_curl.hpp>
 #include <co_curl/format.hpp>
 #include <co_curl/url.hpp>
+#include <crawler/arena.hpp>
+#include <crawler/checkpoint.hpp>
+#include <crawler/frontier.hpp>
+#include <crawler/history.hpp>
 #include <crawler/index.hpp>
+#include <crawler/ngram-sizes.hpp>
+#include <crawler/reorder.hpp>
+#include <crawler/segment.hpp>
+#include <crawler/shard.hpp>
 #include <crawler/strip-tags.hpp>
+#include <crawler/url.hpp>
 #include <ctre.hpp>
+#include <filesystem>
 #include <iostream>
+#include <map>
 #include <numeric>
 #include <ranges>
-#include <set>
+#include <vector>
 #include <string>
 #include <thread>
 #include <csignal>
+#include <cstdlib>
 
 static std::atomic<bool> stop_flag{false};
 
+#ifdef CRAWLER_COUNT_ALLOCATIONS
+void * operator new(size_t size) {
+	crawler::heap_allocations().add(size);
+	if (void * ptr = std::malloc(size != 0 ? size : 1)) {
+		return ptr;
+	}
+	throw std::bad_alloc{};
+}
+
+void operator delete(void * ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void * ptr, size_t) noexcept {
+	std::free(ptr);
+}
+#endif
+
 struct content_and_mime {
 	std::string content;
 	std::optional<std::string> mime;
@@ -46,94 +77,93 @@ static auto get_url_and_path(const std::string & original_url) -> std::optional<
 	return url_and_path{.url = std::move(*opt_url), .host = std::move(*opt_host), .path = std::move(*opt_path)};
 }
 
-auto normalize_and_filter_links(auto && range_of_links, const std::string & original_url) {
-	const auto normalize = [&](std::optional<std::string_view> in) -> std::optional<url_and_path> {
-		if (!in) {
-			return std::nullopt;
-		}
-
-		auto url = co_curl::url{original_url.c_str(), std::string(*in).c_str()}.remove_fragment().remove_query(); // in case of problems remove the forced scheme
+static auto resolve_with_curl(const std::string & original_url, std::string_view link, std::pmr::memory_resource * arena) -> std::optional<url_and_path> {
+	auto url = co_curl::url{original_url.c_str(), std::pmr::string(link, arena).c_str()}.remove_fragment().remove_query(); // in case of problems remove the forced scheme
 
-		auto opt_url = url.get();
-		auto opt_host = url.host();
-		auto opt_path = url.path();
+	auto opt_url = url.get();
+	auto opt_host = url.host();
+	auto opt_path = url.path();
 
-		if (!opt_url || !opt_host || !opt_path) {
-			return std::nullopt;
-		}
+	if (!opt_url || !opt_host || !opt_path) {
+		return std::nullopt;
+	}
 
-		if (std::string_view(original_url).starts_with("https://")) {
-			if (std::string_view(*opt_url).starts_with("http://")) {
-				url.set_scheme("https");
-				opt_url = url.get();
-				opt_host = url.host();
-			}
+	if (std::string_view(original_url).starts_with("https://")) {
+		if (std::string_view(*opt_url).starts_with("http://")) {
+			url.set_scheme("https");
+			opt_url = url.get();
+			opt_host = url.host();
 		}
+	}
 
-		return url_and_path{.url = std::move(*opt_url), .host = std::move(*opt_host), .path = std::move(*opt_path)};
-	};
+	return url_and_path{.url = std::move(*opt_url), .host = std::move(*opt_host), .path = std::move(*opt_path)};
+}
 
-	constexpr auto nonempty = [](const std::optional<url_and_path> & in) {
-		return in.has_value();
-	};
+// resolves links against page they are on (parsed once), most of them are resolved with plain string
+// operations and libcurl is used only for unusual ones, `wanted` decides on views so only links which
+// will be used are allocated and passed to `add`
+void add_normalized_links(auto && range_of_links, const std::string & original_url, std::pmr::memory_resource * arena, auto && wanted, auto && add) {
+	const auto base = crawler::base_url::parse(original_url);
+	auto buffer = std::string{};
 
-	constexpr auto unwrap = [](std::optional<url_and_path> && in) {
-		return std::move(*in);
-	};
+	for (auto && link: range_of_links) {
+		const std::optional<std::string_view> in = link;
 
-	return std::ranges::transform_view(std::move(range_of_links), std::move(normalize)) | std::views::filter(nonempty) | std::views::transform(unwrap);
-}
+		if (!in) {
+			continue;
+		}
 
-auto extract_hrefs_from_html(std::string_view content, const std::string & original_url) {
-	constexpr auto search_all_links = ctre::search_all<R"/((?:(?:href|src|data-src|data-original)=(?:"(?<dg>[^"]*+)"|'(?<sg>[^']*+)'| (?<space>[^ ]*+))))/">;
+		if (base) {
+			const auto [status, view] = base->resolve(*in, buffer);
 
-	constexpr auto remove_quotes = std::views::transform([](auto && in) -> std::string_view {
-		if (auto content = in.template get<"dg">()) {
-			return content;
-		}
+			if (status == crawler::resolve_status::rejected) {
+				continue;
+			}
 
-		if (auto content = in.template get<"sg">()) {
-			// std::cout << content << "\n";
-			return content;
+			if (status == crawler::resolve_status::resolved) {
+				if (wanted(view)) {
+					add(url_and_path{.url = std::string(view.url), .host = std::string(view.host), .path = std::string(view.path)});
+				}
+				continue;
+			}
 		}
 
-		if (auto content = in.template get<"space">()) {
-			return content;
+		if (auto info = resolve_with_curl(original_url, *in, arena)) {
+			if (wanted(crawler::url_view{.url = info->url, .host = info->host, .path = info->path})) {
+				add(std::move(*info));
+			}
 		}
-
-		std::unreachable();
-	});
-
-	return normalize_and_filter_links(search_all_links(content) | remove_quotes, original_url);
+	}
 }
 
-auto extract_urls_from_doxygen_menu(std::string_view content, const std::string & original_url) {
+// unescaped (but not resolved) urls
+auto extract_urls_from_doxygen_menu(std::string_view content, std::pmr::memory_resource * arena) {
 	constexpr auto split_by_url = ctre::split<R"/(,url:")/">;
 
-	constexpr auto remove_quotes = std::views::transform([](std::string_view in) -> std::optional<std::string> {
+	const auto remove_quotes = std::views::transform([arena](std::string_view in) -> std::optional<std::pmr::string> {
 		auto it = in.begin();
 		const auto end = in.end();
 
-		std::ostringstream buffer;
+		std::pmr::string buffer{arena};
 
 		while (it != end) {
 			if (*it == '"') {
-				return buffer.str();
+				return buffer;
 			} else if (*it == '\\') {
 				++it;
 				if (it != end) {
 					// I know, but there won't be any new lines in urls probably unicode characters
-					buffer << *it++;
+					buffer.push_back(*it++);
 				}
 			} else {
-				buffer << *it++;
+				buffer.push_back(*it++);
 			}
 		}
 
 		return std::nullopt;
 	});
 
-	return normalize_and_filter_links(split_by_url(content) | std::views::drop(1) | remove_quotes, original_url);
+	return split_by_url(content) | std::views::drop(1) | remove_quotes;
 }
 
 struct url_content {
@@ -198,7 +228,26 @@ bool blocked_extensions(std::string_view url) noexcept {
 	return false;
 }
 
-template <size_t N = 3> auto fetch_recursive(crawler::index_t<N> & index, std::string requested_url, auto & check_link, auto & add_link, std::string referer, int attempts = 10) -> co_curl::promise<void> {
+// unchanged page isn't parsed again, so links stored by previous crawl are followed instead
+// (otherwise new pages reachable only thru unchanged ones would never be found)
+static void follow_previous_links(const crawler::frontier_entry & request, const crawler::page_meta_t & previous, auto & add_link) {
+	const auto page = get_url_and_path(previous.url);
+
+	if (!page) {
+		return;
+	}
+
+	for (const std::string & link: previous.links) {
+		if (auto info = get_url_and_path(link)) {
+			add_link(request, *page, std::move(*info));
+		}
+	}
+}
+
+template <size_t N = 3> auto fetch_recursive(crawler::index_t<N> & index, crawler::frontier_entry request, auto & check_link, auto & add_link, crawler::crawl_history * history, crawler::page_sink * live, int attempts = 10) -> co_curl::promise<void> {
+	const std::string & requested_url = request.url;
+	const std::string & referer = request.referer;
+
 	if (!requested_url.ends_with("menudata.js")) {
 		// menudata.js is doxygen generated menu
 		if (blocked_extensions(requested_url)) {
@@ -216,6 +265,17 @@ template <size_t N = 3> auto fetch_recursive(crawler::index_t<N> & index, std::s
 	// handle.verbose();
 	handle.follow_location();
 	handle.write_into(output);
+
+	// re-crawl: server can answer with 304 if the page didn't change
+	if (const crawler::page_meta_t * previous = (history != nullptr) ? history->find(requested_url) : nullptr) {
+		if (!previous->etag.empty()) {
+			handle.add_header("If-None-Match: " + previous->etag);
+		}
+		if (!previous->last_modified.empty()) {
+			handle.add_header("If-Modified-Since: " + previous->last_modified);
+		}
+	}
+
 	// handle.connection_timeout(std::chrono::seconds{3});
 	// handle.low_speed_timeout(64, std::chrono::seconds{1});
 
@@ -234,6 +294,17 @@ template <size_t N = 3> auto fetch_recursive(crawler::index_t<N> & index, std::s
 			co_return;
 		}
 
+		if (handle.get_response_code() == 304) {
+			if (history != nullptr) {
+				history->mark(requested_url, crawler::crawl_history::state_t::unchanged);
+				if (const crawler::page_meta_t * previous = history->find(requested_url)) {
+					follow_previous_links(request, *previous, add_link);
+				}
+			}
+			std::cout << "not modified: " << requested_url << "\n";
+			co_return;
+		}
+
 		if (handle.get_response_code() == 503) {
 			std::cerr << "HTTP " << handle.get_response_code() << ": " << requested_url << " (referer = " << referer << ") trying again after a while...\n";
 			std::this_thread::sleep_for(std::chrono::seconds{2});
@@ -243,6 +314,10 @@ template <size_t N = 3> auto fetch_recursive(crawler::index_t<N> & index, std::s
 		if (handle.get_response_code() != co_curl::http_2XX) {
 			std::cerr << "HTTP " << handle.get_response_code() << ": " << requested_url << " (referer = " << referer << ")\n";
 
+			if (history != nullptr && (handle.get_response_code() == 404 || handle.get_response_code() == 410)) {
+				history->mark(requested_url, crawler::crawl_history::state_t::gone);
+			}
+
 			co_return;
 		}
 
@@ -274,16 +349,71 @@ template <size_t N = 3> auto fetch_recursive(crawler::index_t<N> & index, std::s
 		std::cout << "redirected: " << requested_url << " -> " << final_url << "\n";
 	}
 
-	if (mime == "text/html" || final_url.ends_with(".htm") || final_url.ends_with(".html")) {
-		for (auto && url: extract_hrefs_from_html(output, final_url)) {
-			add_link(*info, std::move(url));
+	// server without validators sends everything again, but same body doesn't need to be tokenized
+	const auto hash = crawler::content_hash(output);
+
+	if (const crawler::page_meta_t * previous = (history != nullptr) ? history->find(info->url) : nullptr) {
+		if (previous->content_hash == hash) {
+			history->mark(info->url, crawler::crawl_history::state_t::unchanged);
+			follow_previous_links(request, *previous, add_link);
+			std::cout << "unchanged: " << info->url << "\n";
+			co_return;
+		}
+	}
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	// everything temporary for this document, released when we are done with it
+	crawler::document_arena arena{};
+
+	// targets are collected before the document exists, strings are interned right away
+	auto targets = std::pmr::vector<crawler::link_target>{arena.memory()};
+
+	const auto add_section = [&](size_t pos, std::string_view target) {
+		if (target.starts_with("mw-")) {
+			return;
+		}
+		if (target == "contentSub" || target == "siteSub" || target == "content") {
+			return;
 		}
+		targets.push_back(crawler::link_target{crawler::position_t{static_cast<uint32_t>(pos)}, index.target_strings.intern(target)});
+	};
+
+	// cheap checks before anything is allocated for the link
+	const auto wanted = [&](const crawler::url_view & link) {
+		if (link.host != info->host) {
+			return false;
+		}
+		if (blocked_extensions(link.path) && !link.path.ends_with("menudata.js")) {
+			return false;
+		}
+		return static_cast<bool>(check_link(link));
+	};
+
+	// kept in page metadata, so next crawl can follow them even if this page doesn't change
+	std::vector<std::string> followed{};
+
+	const auto add = [&](url_and_path && url) {
+		followed.push_back(url.url);
+		add_link(request, *info, std::move(url));
+	};
+
+	bool converted = false;
+
+	if (mime == "text/html" || final_url.ends_with(".htm") || final_url.ends_with(".html")) {
+		// link values are overwritten by the plain text later in the pass, so they are copied
+		auto links = std::pmr::vector<std::pmr::string>{arena.memory()};
+
+		output = crawler::convert_to_plain_text(std::move(output), add_section, [&](std::string_view link) { links.emplace_back(link); });
+		converted = true;
+
+		add_normalized_links(links, final_url, arena.memory(), wanted, add);
 	} else if (mime == "application/javascript" && final_url.ends_with("/menudata.js")) {
 		std::cout << "found doxygen menudata.js\n";
-		for (auto && url: extract_urls_from_doxygen_menu(output, final_url)) {
+		add_normalized_links(extract_urls_from_doxygen_menu(output, arena.memory()), final_url, arena.memory(), wanted, [&](url_and_path && url) {
 			std::cout << url.url << "\n";
-			add_link(*info, std::move(url));
-		}
+			add_link(request, *info, std::move(url));
+		});
 		co_return;
 	}
 
@@ -309,31 +439,49 @@ template <size_t N = 3> auto fetch_recursive(crawler::index_t<N> & index, std::s
 	}
 
 	auto & doc = index.insert_document(info->url);
-	auto builder = crawler::ngram_builder_t<N>{};
+	doc.etag = handle.get_header("ETag").value_or("");
+	doc.last_modified = handle.get_header("Last-Modified").value_or("");
+	doc.content_hash = hash;
+	std::ranges::sort(followed);
+	doc.links.assign(followed.begin(), std::ranges::unique(followed).begin());
 
-	const auto start = std::chrono::high_resolution_clock::now();
+	if (history != nullptr) {
+		history->mark(info->url, crawler::crawl_history::state_t::replaced);
+	}
 
-	if (convert) {
-		// crawle thru everything
-		const auto add_section = [&](size_t pos, std::string_view target) {
-			if (target.starts_with("mw-")) {
-				return;
-			}
-			if (target == "contentSub" || target == "siteSub" || target == "content") {
-				return;
-			}
-			doc.add_target(crawler::position_t{static_cast<uint32_t>(pos)}, std::string{target});
-		};
+	auto builder = crawler::ngram_builder_t<N>{};
 
+	if (convert && !converted) {
+		// crawle thru everything
 		output = crawler::convert_to_plain_text(std::move(output), add_section);
 	}
 
+	doc.targets.assign(targets.begin(), targets.end());
+	doc.finalize_targets();
+
 	for (char c: output) {
 		if (builder.push(static_cast<char8_t>(c))) {
 			index.insert_ngram(builder, doc);
 		}
 	}
 
+	// whole words too, so queries don't need to assemble them from ngrams
+	index.insert_words(output, doc);
+
+	// keep plain text for snippets (positions in it are same as in postings)
+	doc.text = crawler::compress_text(output);
+
+	// live shard makes the page searchable right away
+	if (live != nullptr && *live) {
+		auto page = crawler::shard_page_t{.url = info->url, .text = output};
+		for (const crawler::link_target & target: doc.targets) {
+			page.targets.push_back(crawler::shard_target_t{.position = target.position.n, .name = std::string(index.target_strings.get(target.string))});
+		}
+		if (!live->send(page)) {
+			std::cerr << "live shard is gone, pages are not sent anymore\n";
+		}
+	}
+
 	const auto end = std::chrono::high_resolution_clock::now();
 
 	const auto dur = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
@@ -343,56 +491,82 @@ template <size_t N = 3> auto fetch_recursive(crawler::index_t<N> & index, std::s
 	co_return;
 }
 
-struct url_and_referer {
+struct seed_t {
 	std::string url;
-	std::string referer;
-
-	friend constexpr bool operator==(const url_and_referer & lhs, const url_and_referer & rhs) noexcept {
-		return lhs.url == rhs.url;
-	}
-	friend constexpr auto operator<=>(const url_and_referer & lhs, const url_and_referer & rhs) noexcept {
-		return lhs.url <=> rhs.url;
-	}
+	float weight{1.0f};
 };
 
-template <size_t N = 3> auto download_everything(std::set<std::string> urls, auto & allow) -> co_curl::promise<crawler::index_t<N>> {
-	std::set<url_and_referer> urls_to_download{};
-	std::set<url_and_referer> touched_urls{};
+struct checkpoint_options_t {
+	std::filesystem::path path{"build-index.checkpoint"};
+	std::chrono::seconds interval{300}; // 0 = only when stopped
+	bool resume{false};
+};
 
-	crawler::index_t<N> index{};
+template <size_t N = 3> auto download_everything(crawler::index_t<N> index, crawler::crawl_state state, std::vector<seed_t> seeds, auto & allow, const checkpoint_options_t & checkpoint_options, crawler::crawl_history * history, crawler::page_sink * live) -> co_curl::promise<crawler::index_t<N>> {
+	crawler::frontier<> urls_to_download{};
 
-	auto add_link = [&](std::string url, std::string referer) {
-		urls_to_download.emplace(std::move(url), std::move(referer));
-	};
+	// popped from frontier, but not finished yet (they are put back into checkpoints)
+	std::map<std::string, crawler::frontier_entry> in_flight{};
 
-	auto add_link_from_info = [&](const url_and_path & previous, url_and_path info) {
+	auto add_link_from_info = [&](const crawler::frontier_entry & from, const url_and_path & previous, url_and_path info) {
 		if (previous.host != info.host) {
 			return;
 		}
 		if (!allow(info)) {
 			return;
 		}
-		add_link(std::move(info.url), previous.url);
+		urls_to_download.push(crawler::frontier_entry{.url = std::move(info.url), .host = std::move(info.host), .path = std::move(info.path), .referer = previous.url, .depth = from.depth + 1u, .weight = from.weight});
 	};
 
-	for (const auto & first_url: urls) {
-		add_link(first_url, ""); // start here!
+	// continue where previous run stopped
+	for (auto & entry: state.waiting) {
+		urls_to_download.push(std::move(entry));
+	}
+	for (auto & url: state.known) {
+		urls_to_download.mark_known(std::move(url));
 	}
 
+	for (auto & seed: seeds) {
+		// start here!
+		if (auto info = get_url_and_path(seed.url)) {
+			urls_to_download.push(crawler::frontier_entry{.url = std::move(seed.url), .host = std::move(info->host), .path = std::move(info->path), .weight = seed.weight});
+		} else {
+			urls_to_download.push(crawler::frontier_entry{.url = std::move(seed.url), .weight = seed.weight});
+		}
+	}
+
+	auto fetch = [&](crawler::frontier_entry entry) -> co_curl::promise<void> {
+		const auto url = entry.url;
+		in_flight.emplace(url, entry);
+		co_await fetch_recursive(index, std::move(entry), allow, add_link_from_info, history, live);
+		in_flight.erase(url);
+	};
+
+	// checkpoint of an update would have only the changed pages, `--resume` would make a base of them
+	// (stopped update writes delta of what it has, pages which weren't checked yet stay as they are)
+	const bool checkpoints = (history == nullptr);
+
+	// documents are inserted whole between suspensions, so any point in this loop is consistent
+	auto save_checkpoint = [&] {
+		auto current = crawler::crawl_state{.waiting = urls_to_download.waiting_entries(), .known = urls_to_download.known_list()};
+		for (const auto & [url, entry]: in_flight) {
+			current.waiting.push_back(entry);
+		}
+
+		if (crawler::save_checkpoint(checkpoint_options.path, current, index)) {
+			std::cout << "checkpoint: " << index.documents.size() << " documents, " << current.waiting.size() << " waiting URLs\n";
+		}
+	};
+
 	auto queue = std::queue<co_curl::promise<void>>{};
+	auto last_checkpoint = std::chrono::steady_clock::now();
 
 	for (;;) {
-		// if we have something to download...
+		// if we have something to download... (and nobody asked us to stop)
 		int throttle = 10;
-		while (!urls_to_download.empty() && ((--throttle) > 0)) {
-			// remove it from wait set
-			auto first = urls_to_download.extract(urls_to_download.begin());
-			// and mark it as to be download
-			auto [position, inserted, node] = touched_urls.insert(std::move(first));
-			// if it's a unique element there, actually download it
-			if (inserted) {
-				queue.push(fetch_recursive(index, position->url, allow, add_link_from_info, position->referer));
-			}
+		while (!stop_flag && !urls_to_download.empty() && ((--throttle) > 0)) {
+			// best one first (frontier accepts every URL only once)
+			queue.push(fetch(*urls_to_download.pop()));
 		}
 
 		if (!queue.empty()) {
@@ -400,9 +574,27 @@ template <size_t N = 3> auto download_everything(std::set<std::string> urls, aut
 			queue.pop();
 		}
 
-		if (urls_to_download.empty() && queue.empty()) {
+		if (queue.empty() && (stop_flag || urls_to_download.empty())) {
 			break;
 		}
+
+		if (checkpoints && checkpoint_options.interval.count() != 0 && (std::chrono::steady_clock::now() - last_checkpoint) >= checkpoint_options.interval) {
+			save_checkpoint();
+			last_checkpoint = std::chrono::steady_clock::now();
+		}
+	}
+
+	if (!checkpoints) {
+		if (stop_flag) {
+			std::cout << "stopped, pages which weren't checked yet are kept as they are, run --update again for them\n";
+		}
+	} else if (stop_flag) {
+		save_checkpoint();
+		std::cout << "stopped, continue with --resume\n";
+	} else {
+		// everything is downloaded, nothing to resume
+		auto ec = std::error_code{};
+		std::filesystem::remove(checkpoint_options.path, ec);
 	}
 
 	co_return std::move(index);
@@ -461,7 +653,8 @@ template <size_t N = 3> auto download_everything(std::set<std::string> urls, aut
 	return true;
 };
 
-[[maybe_unused]] constexpr auto based_on_server = [](const url_and_path & info) -> bool {
+// works with url_and_path and crawler::url_view (links are checked before they are allocated)
+[[maybe_unused]] constexpr auto based_on_server = [](const auto & info) -> bool {
 	if (info.host == "llvm.org") {
 		return llvm_docs(info.path);
 	} else if (info.host == "en.cppreference.com") {
@@ -475,40 +668,232 @@ template <size_t N = 3> auto download_everything(std::set<std::string> urls, aut
 	}
 };
 
-std::set<std::string> args_to_set_of_string(int argc, char ** argv) {
-	std::set<std::string> urls;
+struct options_t {
+	std::vector<seed_t> seeds{};
+	crawler::reorder_strategy reorder{crawler::reorder_strategy::none};
+	crawler::leaves_layout layout{crawler::leaves_layout::files};
+	checkpoint_options_t checkpoint{};
+	std::filesystem::path live{}; // socket of `search-shard --live`
+	std::optional<std::vector<size_t>> ngram_sizes{}; // first one is the main one (3 by default)
+	bool update{false};
+};
+
+auto parse_arguments(int argc, char ** argv) -> std::optional<options_t> {
+	options_t options{};
+	float weight = 1.0f;
+
 	for (int i = 1; i != argc; ++i) {
-		urls.emplace(std::string{argv[i]});
+		const auto arg = std::string_view{argv[i]};
+
+		if (arg.starts_with("--reorder=")) {
+			if (auto strategy = crawler::parse_reorder_strategy(arg.substr(10))) {
+				options.reorder = *strategy;
+			} else {
+				std::cerr << "unknown reorder strategy: " << arg.substr(10) << " (expected none, url or ngrams)\n";
+				return std::nullopt;
+			}
+		} else if (arg == "--packs") {
+			options.layout = crawler::leaves_layout::packs;
+		} else if (arg == "--update") {
+			options.update = true;
+		} else if (arg.starts_with("--ngram=")) {
+			options.ngram_sizes = crawler::parse_ngram_sizes(arg.substr(8));
+			if (!options.ngram_sizes) {
+				std::cerr << "unsupported ngram sizes: " << arg.substr(8) << " (expected list of 2, 3 or 4)\n";
+				return std::nullopt;
+			}
+		} else if (arg == "--resume") {
+			options.checkpoint.resume = true;
+		} else if (arg.starts_with("--live=")) {
+			options.live = arg.substr(7);
+		} else if (arg.starts_with("--checkpoint=")) {
+			options.checkpoint.path = arg.substr(13);
+		} else if (arg.starts_with("--checkpoint-every=")) {
+			const auto value = std::string(arg.substr(19));
+			char * end = nullptr;
+			const long seconds = std::strtol(value.c_str(), &end, 10);
+			if (value.empty() || *end != '\0' || seconds < 0) {
+				std::cerr << "invalid checkpoint interval: " << arg.substr(19) << " (expected seconds)\n";
+				return std::nullopt;
+			}
+			options.checkpoint.interval = std::chrono::seconds{seconds};
+		} else if (arg.starts_with("--weight=")) {
+			// applies to all following URLs
+			const auto value = std::string(arg.substr(9));
+			char * end = nullptr;
+			weight = std::strtof(value.c_str(), &end);
+			if (value.empty() || *end != '\0' || !(weight > 0.0f)) {
+				std::cerr << "invalid weight: " << arg.substr(9) << " (expected positive number)\n";
+				return std::nullopt;
+			}
+		} else {
+			options.seeds.push_back(seed_t{.url = std::string(arg), .weight = weight});
+		}
 	}
-	return urls;
-}
 
-int main(int argc, char ** argv) {
-	signal(
-		SIGINT, +[](int) {
-		std::cerr << "requesting stop...\n";
-		stop_flag = true;
-		signal(SIGINT, SIG_DFL);
-	});
+	if (options.update && options.checkpoint.resume) {
+		// checkpoint doesn't know which pages of the old index were already checked
+		std::cerr << "--update can't be combined with --resume\n";
+		return std::nullopt;
+	}
+
+	return options;
+}
 
+template <size_t N> int build(const options_t & options, const std::filesystem::path & prefix, std::span<const size_t> ngram_sizes) {
 	co_curl::get_scheduler().waiting.curl.max_total_connections(6);
 
-	auto index = download_everything<3>(args_to_set_of_string(argc, argv), based_on_server).get();
+	const auto delta_prefix = prefix / "delta";
+
+	auto resumed = crawler::index_t<N>{};
+	auto state = crawler::crawl_state{};
+	auto seeds = options.seeds;
+	auto history = std::optional<crawler::crawl_history>{};
+
+	if (options.update) {
+		history = crawler::crawl_history::load(prefix);
+
+		if (!history) {
+			std::cerr << "nothing to update in " << prefix << "\n";
+			return 1;
+		}
+
+		// every known page is checked again (unchanged ones don't give us their links)
+		for (std::string & url: history->urls()) {
+			seeds.push_back(seed_t{.url = std::move(url)});
+		}
+	}
+
+	if (options.checkpoint.resume) {
+		auto loaded = crawler::load_checkpoint(options.checkpoint.path, resumed);
+
+		if (!loaded) {
+			return 1;
+		}
+
+		state = std::move(*loaded);
+		std::cout << "resuming: " << resumed.documents.size() << " documents, " << state.waiting.size() << " waiting URLs\n";
+	} else if (seeds.empty()) {
+		std::cerr << "no URLs to crawl\n";
+		return 1;
+	}
+
+	auto live = std::optional<crawler::page_sink>{};
+
+	if (!options.live.empty()) {
+		live = crawler::page_sink::connect(options.live);
+
+		if (!live) {
+			return 1;
+		}
+	}
+
+	auto index = download_everything<N>(std::move(resumed), std::move(state), std::move(seeds), based_on_server, options.checkpoint, history ? &*history : nullptr, live ? &*live : nullptr).get();
+
+	if (history) {
+		using enum crawler::crawl_history::state_t;
+		std::cout << "unchanged = " << history->count(unchanged) << ", changed = " << history->count(replaced) << ", gone = " << history->count(gone) << ", not visited = " << history->count(not_visited) << "\n";
+
+		// documents of the old delta which are still current are copied into the new one
+		if (const auto kept = history->kept_from_delta(); !kept.empty()) {
+			auto previous = crawler::index_t<N>{};
+
+			if (!crawler::load_segment(delta_prefix / "segment.bin", previous)) {
+				return 1;
+			}
+
+			index.append_documents(previous, kept);
+			std::cout << "kept from previous delta = " << kept.size() << "\n";
+		}
+	}
 
 	std::cout << "indexed documents = " << index.documents.size() << "\n";
 	std::cout << "unique ngrams = " << index.leaves.size() << "\n";
+	std::cout << "unique words = " << index.words.size() << "\n";
 	const size_t total_count = std::accumulate(index.leaves.begin(), index.leaves.end(), size_t{0}, [](size_t lhs, const auto & rhs) {
 		return lhs + rhs.second.unsorted_data.size();
 	});
 
 	const size_t total_targets = std::accumulate(index.documents.begin(), index.documents.end(), size_t{0}, [](size_t lhs, const auto & rhs) {
-		return lhs + rhs.position_to_target.size();
+		return lhs + rhs.targets.size();
 	});
-	std::cout << "targets = " << total_targets << "\n";
+	std::cout << "targets = " << total_targets << " (unique = " << index.target_strings.size() << ")\n";
 	std::cout << "total ngrams = " << total_count << "\n";
+
+	if (options.reorder != crawler::reorder_strategy::none) {
+		const size_t before = crawler::compressed_postings_size(index);
+		index.reorder_documents(crawler::order_documents(index, options.reorder));
+		const size_t after = crawler::compressed_postings_size(index);
+		std::cout << "reordered documents, compressed postings = " << before << " -> " << after << " bytes\n";
+	}
+
 	std::cout << "saving...\n";
 
-	index.save_into("web/index/");
+	if (history) {
+		// only changed and new documents, old ones are replaced by tombstones (written last, readers look for them)
+		auto ec = std::error_code{};
+		std::filesystem::remove(delta_prefix / "tombstones.bin", ec);
+
+		index.save_into(delta_prefix, options.layout);
+		crawler::save_other_ngram_sizes(index, crawler::ngram_size_info(index), ngram_sizes, delta_prefix, options.layout);
+		crawler::save_segment(delta_prefix / "segment.bin", index);
+		crawler::save_tombstones(delta_prefix / "tombstones.bin", history->tombstones());
+	} else {
+		index.save_into(prefix, options.layout);
+		crawler::save_other_ngram_sizes(index, crawler::ngram_size_info(index), ngram_sizes, prefix, options.layout);
+
+		// delta belonged to previous index
+		auto ec = std::error_code{};
+		std::filesystem::remove_all(delta_prefix, ec);
+	}
 
 	std::cout << "done.\n";
+
+	std::cout << "arena chunks = " << crawler::arena_allocations().calls << " (" << crawler::arena_allocations().bytes << " bytes)\n";
+#ifdef CRAWLER_COUNT_ALLOCATIONS
+	std::cout << "heap allocations = " << crawler::heap_allocations().calls << " (" << crawler::heap_allocations().bytes << " bytes)\n";
+#endif
+
+	return 0;
+}
+
+int main(int argc, char ** argv) {
+	signal(
+		SIGINT, +[](int) {
+		std::cerr << "requesting stop...\n";
+		stop_flag = true;
+		signal(SIGINT, SIG_DFL);
+	});
+
+	const auto options = parse_arguments(argc, argv);
+
+	if (!options) {
+		return 1;
+	}
+
+	const auto prefix = std::filesystem::path{"web/index/"};
+
+	auto ngram_sizes = options->ngram_sizes.value_or(std::vector<size_t>{3});
+
+	if (options->update) {
+		// delta must have same ngrams as the index it's added to
+		const auto existing = crawler::ngram_sizes_of(prefix);
+
+		if (!existing) {
+			std::cerr << "nothing to update in " << prefix << "\n";
+			return 1;
+		}
+
+		if (!options->ngram_sizes) {
+			ngram_sizes = *existing;
+		} else if (ngram_sizes.front() != existing->front()) {
+			std::cerr << "index in " << prefix << " has ngrams of size " << existing->front() << ", --update can't change it\n";
+			return 1;
+		}
+	}
+
+	// everything with ngrams is specialized for their size
+	return crawler::with_ngram_size(ngram_sizes.front(), [&](auto n) {
+		return build<decltype(n)::value>(*options, prefix, ngram_sizes);
+	});
 }
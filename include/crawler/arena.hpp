@@ -0,0 +1,79 @@
+#ifndef CRAWLER_ARENA_HPP
+#define CRAWLER_ARENA_HPP
+
+#include <array>
+#include <atomic>
+#include <memory_resource>
+#include <cstddef>
+
+namespace crawler {
+
+struct allocation_counters {
+	std::atomic<size_t> calls{0};
+	std::atomic<size_t> bytes{0};
+
+	void add(size_t size) noexcept {
+		calls.fetch_add(1, std::memory_order_relaxed);
+		bytes.fetch_add(size, std::memory_order_relaxed);
+	}
+};
+
+// chunks which arenas really asked heap for
+inline allocation_counters & arena_allocations() noexcept {
+	static allocation_counters counters{};
+	return counters;
+}
+
+// all heap allocations, only counted when build-index is built with CRAWLER_COUNT_ALLOCATIONS
+inline allocation_counters & heap_allocations() noexcept {
+	static allocation_counters counters{};
+	return counters;
+}
+
+class counting_resource final: public std::pmr::memory_resource {
+	std::pmr::memory_resource * upstream;
+	allocation_counters & counters;
+
+	void * do_allocate(size_t bytes, size_t alignment) override {
+		counters.add(bytes);
+		return upstream->allocate(bytes, alignment);
+	}
+
+	void do_deallocate(void * ptr, size_t bytes, size_t alignment) override {
+		upstream->deallocate(ptr, bytes, alignment);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource & other) const noexcept override {
+		return this == &other;
+	}
+
+public:
+	counting_resource(std::pmr::memory_resource * up, allocation_counters & c) noexcept: upstream{up}, counters{c} { }
+};
+
+inline std::pmr::memory_resource * arena_upstream() noexcept {
+	static counting_resource resource{std::pmr::new_delete_resource(), arena_allocations()};
+	return &resource;
+}
+
+// scratch memory for processing one document (links before normalization, unescaped strings, ...)
+// everything is released at once when the arena is destroyed, small pages fit into the inline buffer
+class document_arena {
+	static constexpr size_t inline_size = 16u * 1024u;
+
+	alignas(std::max_align_t) std::array<std::byte, inline_size> buffer;
+	std::pmr::monotonic_buffer_resource resource{buffer.data(), buffer.size(), arena_upstream()};
+
+public:
+	document_arena() noexcept = default;
+	document_arena(const document_arena &) = delete;
+	document_arena & operator=(const document_arena &) = delete;
+
+	std::pmr::memory_resource * memory() noexcept {
+		return &resource;
+	}
+};
+
+} // namespace crawler
+
+#endif
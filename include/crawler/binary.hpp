@@ -0,0 +1,168 @@
+#ifndef CRAWLER_BINARY_HPP
+#define CRAWLER_BINARY_HPP
+
+#include <array>
+#include <bit>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <cstdint>
+
+namespace crawler {
+
+// all binary files in the index are little-endian, so JS can read them with DataView(..., true)
+
+template <typename T> inline void write_le(std::ostream & out, T value) {
+	static_assert(std::is_unsigned_v<T>);
+	std::array<char, sizeof(T)> buffer;
+	for (char & c: buffer) {
+		c = static_cast<char>(value & 0xFFu);
+		value = static_cast<T>(value >> 8u);
+	}
+	out.write(buffer.data(), buffer.size());
+}
+
+inline void write_u16(std::ostream & out, uint16_t value) {
+	write_le(out, value);
+}
+
+inline void write_u32(std::ostream & out, uint32_t value) {
+	write_le(out, value);
+}
+
+inline void write_u64(std::ostream & out, uint64_t value) {
+	write_le(out, value);
+}
+
+inline void write_magic(std::ostream & out, std::string_view magic) {
+	out.write(magic.data(), static_cast<std::streamsize>(magic.size()));
+}
+
+struct binary_reader {
+	std::span<const char> data;
+	size_t offset{0};
+	bool failed{false};
+
+	explicit constexpr binary_reader(std::span<const char> in) noexcept: data{in} { }
+
+	constexpr bool has(size_t n) noexcept {
+		if (failed || data.size() - offset < n) {
+			failed = true;
+			return false;
+		}
+		return true;
+	}
+
+	template <typename T> constexpr T read_le() noexcept {
+		if (!has(sizeof(T))) {
+			return T{0};
+		}
+		T value{0};
+		for (size_t i = 0; i != sizeof(T); ++i) {
+			value = static_cast<T>(value | (static_cast<T>(static_cast<unsigned char>(data[offset + i])) << (8u * i)));
+		}
+		offset += sizeof(T);
+		return value;
+	}
+
+	constexpr uint16_t read_u16() noexcept {
+		return read_le<uint16_t>();
+	}
+
+	constexpr uint32_t read_u32() noexcept {
+		return read_le<uint32_t>();
+	}
+
+	constexpr uint64_t read_u64() noexcept {
+		return read_le<uint64_t>();
+	}
+
+	constexpr std::string_view read_bytes(size_t n) noexcept {
+		if (!has(n)) {
+			return {};
+		}
+		const auto result = std::string_view(data.data() + offset, n);
+		offset += n;
+		return result;
+	}
+
+	constexpr bool expect_magic(std::string_view magic) noexcept {
+		return read_bytes(magic.size()) == magic && !failed;
+	}
+
+	constexpr void seek(size_t position) noexcept {
+		if (position > data.size()) {
+			failed = true;
+			return;
+		}
+		offset = position;
+	}
+};
+
+// `index`-th number of a table of little-endian numbers (mapped from a file), 0 outside of it
+template <typename T> constexpr T le_at(std::span<const char> table, size_t index) noexcept {
+	auto in = binary_reader{table};
+	in.seek(index * sizeof(T));
+	return in.read_le<T>();
+}
+
+constexpr uint32_t u32_at(std::span<const char> table, size_t index) noexcept {
+	return le_at<uint32_t>(table, index);
+}
+
+constexpr uint64_t u64_at(std::span<const char> table, size_t index) noexcept {
+	return le_at<uint64_t>(table, index);
+}
+
+// table of `count` + 1 u32 offsets starts at 0 and never goes back, so [offset(i), offset(i + 1))
+// is a valid range of anything it points into (up to the last offset, which is checked separately)
+constexpr bool monotonic_offsets(std::span<const char> table, size_t count) noexcept {
+	if (table.size() / sizeof(uint32_t) <= count || u32_at(table, 0) != 0) {
+		return false;
+	}
+
+	for (size_t i = 0; i != count; ++i) {
+		if (u32_at(table, i + 1u) < u32_at(table, i)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+inline auto read_whole_file(const std::filesystem::path & name) -> std::optional<std::string> {
+	auto in = std::ifstream{name, std::ios_base::in | std::ios_base::binary};
+
+	if (!in) {
+		return std::nullopt;
+	}
+
+	return std::string{std::istreambuf_iterator<char>{in}, {}};
+}
+
+// bytes [offset, offset + length) of the file, std::nullopt if the file is shorter
+inline auto read_file_range(const std::filesystem::path & name, uint64_t offset, size_t length) -> std::optional<std::string> {
+	auto in = std::ifstream{name, std::ios_base::in | std::ios_base::binary};
+
+	if (!in || !in.seekg(static_cast<std::streamoff>(offset))) {
+		return std::nullopt;
+	}
+
+	std::string output;
+	output.resize(length);
+
+	if (!in.read(output.data(), static_cast<std::streamsize>(length))) {
+		return std::nullopt;
+	}
+
+	return output;
+}
+
+} // namespace crawler
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef CRAWLER_CHECKPOINT_HPP
+#define CRAWLER_CHECKPOINT_HPP
+
+#include "binary.hpp"
+#include "frontier.hpp"
+#include "index.hpp"
+#include "mapped-file.hpp"
+#include "segment.hpp"
+#include "varint.hpp"
+#include <bit>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace crawler {
+
+// State of an unfinished crawl, everything in one file (so it's always consistent):
+// "CKPT" u32(version) u32(waiting count) u32(known count)
+// waiting: varint(length) url, host, path, referer varint(depth) u32(weight as float bits)
+// known:   varint(length) url (everything ever accepted by frontier, including waiting ones)
+// followed by segment with documents downloaded so far (see crawler/segment.hpp)
+
+static constexpr uint32_t checkpoint_version = 1;
+
+struct crawl_state {
+	std::vector<frontier_entry> waiting{}; // including pages which were being downloaded
+	std::vector<std::string> known{};
+};
+
+template <size_t N> bool save_checkpoint(const std::filesystem::path & name, const crawl_state & state, index_t<N> & index) {
+	auto tmp = name;
+	tmp += ".tmp";
+
+	{
+		auto of = std::ofstream{tmp, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc};
+
+		if (!of) {
+			std::cerr << "can't open file: " << tmp << "\n";
+			return false;
+		}
+
+		write_magic(of, "CKPT");
+		write_u32(of, checkpoint_version);
+		write_u32(of, static_cast<uint32_t>(state.waiting.size()));
+		write_u32(of, static_cast<uint32_t>(state.known.size()));
+
+		std::string buffer;
+
+		for (const frontier_entry & entry: state.waiting) {
+			write_string(buffer, entry.url);
+			write_string(buffer, entry.host);
+			write_string(buffer, entry.path);
+			write_string(buffer, entry.referer);
+			write_varint(buffer, entry.depth);
+			of.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+			write_u32(of, std::bit_cast<uint32_t>(entry.weight));
+			buffer.clear();
+		}
+
+		for (const std::string & url: state.known) {
+			write_string(buffer, url);
+		}
+		of.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+
+		write_segment(of, index);
+
+		if (!of.flush()) {
+			std::cerr << "can't write file: " << tmp << "\n";
+			return false;
+		}
+	}
+
+	auto ec = std::error_code{};
+	std::filesystem::rename(tmp, name, ec);
+
+	if (ec) {
+		std::cerr << "can't rename " << tmp << " to " << name << "\n";
+		return false;
+	}
+
+	return true;
+}
+
+// documents are appended to `index`, std::nullopt if there is no checkpoint or it's broken
+template <size_t N> auto load_checkpoint(const std::filesystem::path & name, index_t<N> & index) -> std::optional<crawl_state> {
+	const auto file = mapped_file::open(name);
+
+	if (!file) {
+		std::cerr << "can't open file: " << name << "\n";
+		return std::nullopt;
+	}
+
+	auto header = binary_reader{file->data()};
+
+	if (!header.expect_magic("CKPT") || header.read_u32() != checkpoint_version) {
+		std::cerr << "unsupported checkpoint: " << name << "\n";
+		return std::nullopt;
+	}
+
+	const uint32_t waiting = header.read_u32();
+	const uint32_t known = header.read_u32();
+
+	if (header.failed) {
+		std::cerr << "truncated checkpoint: " << name << "\n";
+		return std::nullopt;
+	}
+
+	auto input = std::string_view(file->data().data(), file->size()).substr(header.offset);
+
+	crawl_state state{};
+	state.waiting.reserve(waiting);
+	state.known.reserve(known);
+
+	const auto broken = [&] {
+		std::cerr << "broken checkpoint: " << name << "\n";
+		return std::nullopt;
+	};
+
+	for (uint32_t i = 0; i != waiting; ++i) {
+		const auto url = read_string(input);
+		const auto host = read_string(input);
+		const auto path = read_string(input);
+		const auto referer = read_string(input);
+		const auto depth = read_varint(input);
+
+		if (!url || !host || !path || !referer || !depth || input.size() < sizeof(uint32_t)) {
+			return broken();
+		}
+
+		auto weight = binary_reader{std::span<const char>(input.data(), sizeof(uint32_t))}.read_u32();
+		input.remove_prefix(sizeof(uint32_t));
+
+		state.waiting.push_back(frontier_entry{.url = std::string(*url), .host = std::string(*host), .path = std::string(*path), .referer = std::string(*referer), .depth = static_cast<unsigned>(*depth), .weight = std::bit_cast<float>(weight)});
+	}
+
+	for (uint32_t i = 0; i != known; ++i) {
+		const auto url = read_string(input);
+
+		if (!url) {
+			return broken();
+		}
+
+		state.known.emplace_back(*url);
+	}
+
+	if (!read_segment(input, index)) {
+		return broken();
+	}
+
+	return state;
+}
+
+} // namespace crawler
+
+#endif
@@ -0,0 +1,162 @@
+#include "completion-table.hpp"
+#include "binary.hpp"
+#include <algorithm>
+#include <iostream>
+
+auto crawler::completion_table::open(const std::filesystem::path & name) -> std::optional<completion_table> {
+	auto file = mapped_file::open(name);
+
+	if (!file) {
+		std::cerr << "can't open file: " << name << "\n";
+		return std::nullopt;
+	}
+
+	auto in = binary_reader{file->data()};
+
+	if (!in.expect_magic("CMPL") || in.read_u32() != 1) {
+		std::cerr << "unsupported completion table: " << name << "\n";
+		return std::nullopt;
+	}
+
+	completion_table output{};
+	output.k = in.read_u32();
+	output.count = in.read_u32();
+	output.nodes = in.read_u32();
+
+	// best terms of all nodes would overflow their size
+	if (output.nodes != 0 && output.k > file->size() / output.nodes) {
+		std::cerr << "truncated completion table: " << name << "\n";
+		return std::nullopt;
+	}
+
+	output.string_offsets = in.read_bytes((size_t{output.count} + 1u) * sizeof(uint32_t));
+	output.scores = in.read_bytes(size_t{output.count} * sizeof(uint32_t));
+	output.first_term = in.read_bytes(size_t{output.nodes} * sizeof(uint32_t));
+	output.last_term = in.read_bytes(size_t{output.nodes} * sizeof(uint32_t));
+	output.best = in.read_bytes(size_t{output.nodes} * output.k * sizeof(uint32_t));
+
+	if (in.failed) {
+		std::cerr << "truncated completion table: " << name << "\n";
+		return std::nullopt;
+	}
+
+	output.pool = file->data().subspan(in.offset);
+
+	if (u32_at(output.string_offsets, output.count) > output.pool.size()) {
+		std::cerr << "truncated completion table: " << name << "\n";
+		return std::nullopt;
+	}
+
+	// everything is checked once here, so completions don't need to
+	if (!output.valid()) {
+		std::cerr << "corrupted completion table: " << name << "\n";
+		return std::nullopt;
+	}
+
+	output.file = std::move(*file);
+
+	return output;
+}
+
+// terms don't overlap and nodes are ranges of terms with best ones among existing terms
+bool crawler::completion_table::valid() const noexcept {
+	if (!monotonic_offsets(string_offsets, count)) {
+		return false;
+	}
+
+	for (uint32_t node = 0; node != nodes; ++node) {
+		const uint32_t first = u32_at(first_term, node);
+		const uint32_t last = u32_at(last_term, node);
+
+		if (first > last || last > count) {
+			return false;
+		}
+	}
+
+	for (size_t i = 0; i != size_t{nodes} * k; ++i) {
+		if (u32_at(best, i) >= count) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+auto crawler::completion_table::term_at(uint32_t index) const noexcept -> std::string_view {
+	const uint32_t from = u32_at(string_offsets, index);
+	const uint32_t to = u32_at(string_offsets, index + 1u);
+
+	return std::string_view(pool.data() + from, to - from);
+}
+
+auto crawler::completion_table::completion_at(uint32_t index) const noexcept -> completion_t {
+	return completion_t{.term = term_at(index), .score = u32_at(scores, index)};
+}
+
+auto crawler::completion_table::complete(std::string_view prefix, size_t limit) const -> std::vector<completion_t> {
+	if (prefix.empty() || limit == 0) {
+		return {};
+	}
+
+	// first term not before `prefix`
+	uint32_t first = 0;
+	for (uint32_t length = count; length > 0;) {
+		const uint32_t half = length / 2u;
+		if (term_at(first + half) < prefix) {
+			first += half + 1u;
+			length -= half + 1u;
+		} else {
+			length = half;
+		}
+	}
+
+	// first term after it which doesn't start with it
+	uint32_t last = first;
+	for (uint32_t length = count - first; length > 0;) {
+		const uint32_t half = length / 2u;
+		if (term_at(last + half).starts_with(prefix)) {
+			last += half + 1u;
+			length -= half + 1u;
+		} else {
+			length = half;
+		}
+	}
+
+	std::vector<completion_t> output;
+
+	if (last - first <= k) {
+		for (uint32_t i = first; i != last; ++i) {
+			output.push_back(completion_at(i));
+		}
+
+		// same order as precomputed ones
+		std::ranges::sort(output, better_completion);
+	} else {
+		// node of the range (by first term, longer range first)
+		uint32_t node = 0;
+		for (uint32_t length = nodes; length > 0;) {
+			const uint32_t half = length / 2u;
+			const uint32_t node_first = u32_at(first_term, node + half);
+			if (node_first < first || (node_first == first && u32_at(last_term, node + half) > last)) {
+				node += half + 1u;
+				length -= half + 1u;
+			} else {
+				length = half;
+			}
+		}
+
+		if (node == nodes || u32_at(first_term, node) != first || u32_at(last_term, node) != last) {
+			return {};
+		}
+
+		for (uint32_t i = 0; i != k; ++i) {
+			output.push_back(completion_at(u32_at(best, size_t{node} * k + i)));
+		}
+	}
+
+	if (output.size() > limit) {
+		output.resize(limit);
+	}
+
+	return output;
+}
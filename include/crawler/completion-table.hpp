@@ -0,0 +1,63 @@
+#ifndef CRAWLER_COMPLETION_TABLE_HPP
+#define CRAWLER_COMPLETION_TABLE_HPP
+
+#include "mapped-file.hpp"
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <tuple>
+#include <vector>
+#include <cstdint>
+
+namespace crawler {
+
+// Completions written by `save_completions_file`: a prefix is two binary searches in sorted
+// terms and one in nodes with precomputed best terms, nothing is parsed or allocated besides
+// the result, so it's fast enough for every keystroke.
+
+struct completion_t {
+	std::string_view term;
+	uint32_t score;
+};
+
+// in more documents first, then alphabetically (so shorter of terms with same prefix)
+constexpr bool better_completion(const completion_t & lhs, const completion_t & rhs) noexcept {
+	return std::tie(rhs.score, lhs.term) < std::tie(lhs.score, rhs.term);
+}
+
+class completion_table {
+	mapped_file file{};
+	std::span<const char> string_offsets{};
+	std::span<const char> scores{};
+	std::span<const char> first_term{};
+	std::span<const char> last_term{};
+	std::span<const char> best{};
+	std::span<const char> pool{};
+	uint32_t count{0};
+	uint32_t nodes{0};
+	uint32_t k{0};
+
+	auto term_at(uint32_t index) const noexcept -> std::string_view;
+	auto completion_at(uint32_t index) const noexcept -> completion_t;
+
+	bool valid() const noexcept;
+
+public:
+	static auto open(const std::filesystem::path & name) -> std::optional<completion_table>;
+
+	uint32_t size() const noexcept {
+		return count;
+	}
+
+	void will_need() const noexcept {
+		file.will_need();
+	}
+
+	// most frequent terms starting with `prefix` (best first), there is at most k of them
+	auto complete(std::string_view prefix, size_t limit) const -> std::vector<completion_t>;
+};
+
+} // namespace crawler
+
+#endif
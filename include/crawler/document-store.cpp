@@ -0,0 +1,270 @@
+#include "document-store.hpp"
+#include "binary.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <zlib.h>
+
+crawler::compressed_text_t crawler::compress_text(std::string_view text) {
+	compressed_text_t output{};
+	output.size = static_cast<uint32_t>(text.size());
+
+	std::string buffer;
+
+	for (size_t start = 0; start < text.size(); start += text_block_size) {
+		const auto block = text.substr(start, text_block_size);
+
+		auto length = compressBound(static_cast<uLong>(block.size()));
+		buffer.resize(length);
+
+		if (compress2(reinterpret_cast<Bytef *>(buffer.data()), &length, reinterpret_cast<const Bytef *>(block.data()), static_cast<uLong>(block.size()), Z_BEST_COMPRESSION) != Z_OK) {
+			// this can't happen with buffer of compressBound size, but better empty text than broken one
+			return compressed_text_t{};
+		}
+
+		output.data.append(buffer.data(), length);
+		output.block_offsets.push_back(static_cast<uint32_t>(output.data.size()));
+	}
+
+	output.data.shrink_to_fit();
+	output.block_offsets.shrink_to_fit();
+
+	return output;
+}
+
+auto crawler::decompress_block(std::string_view compressed, size_t uncompressed_size) -> std::optional<std::string> {
+	std::string output;
+	output.resize(uncompressed_size);
+
+	auto length = static_cast<uLongf>(uncompressed_size);
+
+	if (uncompress(reinterpret_cast<Bytef *>(output.data()), &length, reinterpret_cast<const Bytef *>(compressed.data()), static_cast<uLong>(compressed.size())) != Z_OK || length != uncompressed_size) {
+		return std::nullopt;
+	}
+
+	return output;
+}
+
+void crawler::save_document_store(const std::filesystem::path & name, std::span<const compressed_text_t * const> documents) {
+	auto of = std::ofstream{name, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc};
+
+	if (!of) {
+		std::cerr << "can't open file: " << name << "\n";
+		return;
+	}
+
+	write_magic(of, "TEXT");
+	write_u32(of, 1);
+	write_u32(of, text_block_size);
+	write_u32(of, static_cast<uint32_t>(documents.size()));
+
+	uint32_t block = 0;
+	for (const compressed_text_t * text: documents) {
+		write_u32(of, block);
+		block += static_cast<uint32_t>(text->blocks());
+	}
+	write_u32(of, block);
+
+	for (const compressed_text_t * text: documents) {
+		write_u32(of, text->size);
+	}
+
+	uint64_t offset = 0;
+	for (const compressed_text_t * text: documents) {
+		for (size_t i = 0; i != text->blocks(); ++i) {
+			write_u64(of, offset + text->block_offsets[i]);
+		}
+		offset += text->data.size();
+	}
+	write_u64(of, offset);
+
+	for (const compressed_text_t * text: documents) {
+		of.write(text->data.data(), static_cast<std::streamsize>(text->data.size()));
+	}
+}
+
+auto crawler::document_store::open(const std::filesystem::path & name) -> std::optional<document_store> {
+	auto file = mapped_file::open(name);
+
+	if (!file) {
+		std::cerr << "can't open file: " << name << "\n";
+		return std::nullopt;
+	}
+
+	auto in = binary_reader{file->data()};
+
+	if (!in.expect_magic("TEXT") || in.read_u32() != 1) {
+		std::cerr << "unsupported document store: " << name << "\n";
+		return std::nullopt;
+	}
+
+	document_store output{};
+	output.block_size = in.read_u32();
+	output.count = in.read_u32();
+
+	const auto first_block = in.read_bytes((size_t{output.count} + 1u) * sizeof(uint32_t));
+	const auto text_size = in.read_bytes(size_t{output.count} * sizeof(uint32_t));
+	const uint32_t total_blocks = in.failed ? 0u : u32_at(first_block, output.count);
+	const auto block_offset = in.read_bytes((size_t{total_blocks} + 1u) * sizeof(uint64_t));
+
+	if (in.failed || output.block_size == 0) {
+		std::cerr << "truncated document store: " << name << "\n";
+		return std::nullopt;
+	}
+
+	output.first_block = first_block;
+	output.text_size = text_size;
+	output.block_offset = block_offset;
+	output.data = file->data().subspan(in.offset);
+
+	// everything is checked once here, so extracting text doesn't need to
+	if (!output.valid()) {
+		std::cerr << "corrupted document store: " << name << "\n";
+		return std::nullopt;
+	}
+
+	output.file = std::move(*file);
+
+	return output;
+}
+
+// every document has as many blocks as its size needs and all of them are inside of data
+bool crawler::document_store::valid() const noexcept {
+	if (u32_at(first_block, 0) != 0) {
+		return false;
+	}
+
+	for (uint32_t id = 0; id != count; ++id) {
+		const uint32_t first = u32_at(first_block, id);
+		const uint32_t last = u32_at(first_block, id + 1u);
+		const uint64_t blocks = (uint64_t{u32_at(text_size, id)} + block_size - 1u) / block_size;
+
+		if (last < first || last - first != blocks) {
+			return false;
+		}
+	}
+
+	const uint32_t total_blocks = u32_at(first_block, count);
+
+	if (u64_at(block_offset, 0) != 0) {
+		return false;
+	}
+
+	for (uint32_t block = 0; block != total_blocks; ++block) {
+		if (u64_at(block_offset, block + 1u) < u64_at(block_offset, block)) {
+			return false;
+		}
+	}
+
+	return u64_at(block_offset, total_blocks) <= data.size();
+}
+
+auto crawler::document_store::document_size(uint32_t id) const noexcept -> std::optional<uint32_t> {
+	if (id >= count) {
+		return std::nullopt;
+	}
+	return u32_at(text_size, id);
+}
+
+auto crawler::document_store::compressed(uint32_t id) const -> std::optional<compressed_text_t> {
+	const auto size = document_size(id);
+
+	if (!size) {
+		return std::nullopt;
+	}
+
+	const uint32_t first = u32_at(first_block, id);
+	const uint32_t last = u32_at(first_block, id + 1u);
+	const uint64_t start = u64_at(block_offset, first);
+
+	compressed_text_t output{};
+	output.size = *size;
+
+	for (uint32_t block = first; block != last; ++block) {
+		output.block_offsets.push_back(static_cast<uint32_t>(u64_at(block_offset, block + 1u) - start));
+	}
+
+	const uint64_t end = u64_at(block_offset, last);
+	output.data.assign(data.data() + start, static_cast<size_t>(end - start));
+
+	return output;
+}
+
+// text in [position, position + length) of a document of `size` bytes, `compressed(block)` gives data of its block
+static auto extract_from_blocks(uint32_t size, uint32_t block_size, uint32_t position, uint32_t length, auto && compressed) -> std::optional<std::string> {
+	if (position >= size) {
+		return std::string{};
+	}
+
+	const uint32_t end = (length < size - position) ? (position + length) : size;
+
+	std::string output;
+	output.reserve(end - position);
+
+	for (uint32_t block = position / block_size; block * block_size < end; ++block) {
+		const uint32_t block_start = block * block_size;
+		const uint32_t block_length = std::min(block_size, size - block_start);
+
+		const auto text = crawler::decompress_block(compressed(block), block_length);
+
+		if (!text) {
+			return std::nullopt;
+		}
+
+		const uint32_t local_begin = std::max(position, block_start) - block_start;
+		const uint32_t local_end = std::min(end, block_start + block_length) - block_start;
+		output.append(*text, local_begin, local_end - local_begin);
+	}
+
+	return output;
+}
+
+// match at [position, position + length) with up to `context` bytes around it, `extract(begin, length)` gives the text
+static auto snippet_from(uint32_t position, uint32_t length, uint32_t context, auto && extract) -> std::optional<crawler::snippet_t> {
+	const uint32_t begin = (position > context) ? (position - context) : 0u;
+
+	auto text = extract(begin, (position - begin) + length + context);
+
+	if (!text) {
+		return std::nullopt;
+	}
+
+	const size_t match_begin = std::min<size_t>(position - begin, text->size());
+	const size_t match_end = std::min<size_t>(match_begin + length, text->size());
+
+	return crawler::snippet_t{.before = text->substr(0, match_begin), .match = text->substr(match_begin, match_end - match_begin), .after = text->substr(match_end)};
+}
+
+auto crawler::document_store::extract(uint32_t id, uint32_t position, uint32_t length) const -> std::optional<std::string> {
+	const auto size = document_size(id);
+
+	if (!size) {
+		return std::nullopt;
+	}
+
+	const uint32_t first = u32_at(first_block, id);
+
+	return extract_from_blocks(*size, block_size, position, length, [&](uint32_t block) {
+		const uint64_t from = u64_at(block_offset, first + block);
+		const uint64_t to = u64_at(block_offset, first + block + 1u);
+		return std::string_view(data.data() + from, static_cast<size_t>(to - from));
+	});
+}
+
+auto crawler::document_store::snippet(uint32_t id, uint32_t position, uint32_t length, uint32_t context) const -> std::optional<snippet_t> {
+	return snippet_from(position, length, context, [&](uint32_t begin, uint32_t size) { return extract(id, begin, size); });
+}
+
+auto crawler::extract_text(const compressed_text_t & text, uint32_t position, uint32_t length) -> std::optional<std::string> {
+	return extract_from_blocks(text.size, text_block_size, position, length, [&](uint32_t block) -> std::string_view {
+		if (block + 1u >= text.block_offsets.size() || text.block_offsets[block + 1u] > text.data.size()) {
+			// it fails to decompress
+			return {};
+		}
+		return std::string_view(text.data).substr(text.block_offsets[block], text.block_offsets[block + 1u] - text.block_offsets[block]);
+	});
+}
+
+auto crawler::snippet_of(const compressed_text_t & text, uint32_t position, uint32_t length, uint32_t context) -> std::optional<snippet_t> {
+	return snippet_from(position, length, context, [&](uint32_t begin, uint32_t size) { return extract_text(text, begin, size); });
+}
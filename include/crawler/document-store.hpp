@@ -0,0 +1,88 @@
+#ifndef CRAWLER_DOCUMENT_STORE_HPP
+#define CRAWLER_DOCUMENT_STORE_HPP
+
+#include "mapped-file.hpp"
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace crawler {
+
+// Plain text of a document (as produced by convert_to_plain_text, so positions in postings
+// are positions here) cut into fixed blocks which are deflated one by one. Any window can
+// be decoded by inflating only blocks it touches.
+
+static constexpr uint32_t text_block_size = 4096;
+
+struct compressed_text_t {
+	std::string data{};
+	std::vector<uint32_t> block_offsets{0}; // block i is data[block_offsets[i], block_offsets[i+1])
+	uint32_t size{0};						// uncompressed
+
+	size_t blocks() const noexcept {
+		return block_offsets.size() - 1u;
+	}
+};
+
+compressed_text_t compress_text(std::string_view text);
+
+// inflates one block, returns std::nullopt if it's corrupted
+auto decompress_block(std::string_view compressed, size_t uncompressed_size) -> std::optional<std::string>;
+
+struct snippet_t {
+	std::string before;
+	std::string match;
+	std::string after;
+};
+
+// same as `document_store::extract` and `document_store::snippet` for a document still in memory
+auto extract_text(const compressed_text_t & text, uint32_t position, uint32_t length) -> std::optional<std::string>;
+auto snippet_of(const compressed_text_t & text, uint32_t position, uint32_t length, uint32_t context = 80) -> std::optional<snippet_t>;
+
+// whole store in one file:
+// "TEXT" u32(version) u32(block size) u32(document count)
+// u32(first block)[document count + 1] u32(text size)[document count]
+// u64(block offset)[total blocks + 1] (relative to start of data) data...
+void save_document_store(const std::filesystem::path & name, std::span<const compressed_text_t * const> documents);
+
+class document_store {
+	mapped_file file{};
+	std::span<const char> first_block{};
+	std::span<const char> text_size{};
+	std::span<const char> block_offset{};
+	std::span<const char> data{};
+	uint32_t block_size{text_block_size};
+	uint32_t count{0};
+
+	bool valid() const noexcept;
+
+public:
+	static auto open(const std::filesystem::path & name) -> std::optional<document_store>;
+
+	uint32_t documents() const noexcept {
+		return count;
+	}
+
+	void will_need() const noexcept {
+		file.will_need();
+	}
+
+	auto document_size(uint32_t id) const noexcept -> std::optional<uint32_t>;
+
+	// blocks of the document as they are stored (for copying into another store)
+	auto compressed(uint32_t id) const -> std::optional<compressed_text_t>;
+
+	// text in [position, position + length) (shorter if document ends sooner)
+	auto extract(uint32_t id, uint32_t position, uint32_t length) const -> std::optional<std::string>;
+
+	// match at [position, position + length) with up to `context` bytes around it
+	auto snippet(uint32_t id, uint32_t position, uint32_t length, uint32_t context = 80) const -> std::optional<snippet_t>;
+};
+
+} // namespace crawler
+
+#endif
@@ -0,0 +1,187 @@
+#ifndef CRAWLER_FRONTIER_HPP
+#define CRAWLER_FRONTIER_HPP
+
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <cstdint>
+
+namespace crawler {
+
+// what we expect behind a link, before downloading it (only from its path)
+enum class content_kind {
+	link_hub,   // doxygen menudata.js, only links
+	index_page, // directory listing, index.html, ... (many links)
+	page,       // regular document
+	other       // text files and unknown extensions
+};
+
+inline auto expected_content(std::string_view path) noexcept -> content_kind {
+	if (path.ends_with("/menudata.js")) {
+		return content_kind::link_hub;
+	}
+
+	if (path.empty() || path.ends_with('/') || path.ends_with("/index.html") || path.ends_with("/index.htm") || path.ends_with("/index.php")) {
+		return content_kind::index_page;
+	}
+
+	const auto name = path.substr(path.rfind('/') + 1u);
+	const auto dot = name.rfind('.');
+
+	if (dot == std::string_view::npos || name.ends_with(".html") || name.ends_with(".htm") || name.ends_with(".php")) {
+		return content_kind::page;
+	}
+
+	return content_kind::other;
+}
+
+struct frontier_entry {
+	std::string url{};
+	std::string host{};
+	std::string path{};
+	std::string referer{};
+	unsigned depth{0};   // number of links from a seed
+	float weight{1.0f}; // seeds have explicit weight, links inherit it from page where they were found
+};
+
+// higher is downloaded sooner, shallow pages and pages with many links first
+struct default_priority {
+	float depth_penalty{1.0f};
+	float link_hub_bonus{4.0f};
+	float index_page_bonus{1.0f};
+	float other_penalty{2.0f};
+
+	float operator()(const frontier_entry & entry) const noexcept {
+		float score = -depth_penalty * static_cast<float>(entry.depth);
+
+		switch (expected_content(entry.path)) {
+		case content_kind::link_hub: score += link_hub_bonus; break;
+		case content_kind::index_page: score += index_page_bonus; break;
+		case content_kind::page: break;
+		case content_kind::other: score -= other_penalty; break;
+		}
+
+		return score * (score < 0.0f ? 1.0f / entry.weight : entry.weight);
+	}
+};
+
+// URLs waiting for download, every URL is accepted only once (first referer wins)
+// hosts take turns (so one big site doesn't starve others), inside a host the best priority goes first
+// and equal priorities are in order of discovery
+template <typename Priority = default_priority> class frontier {
+	struct queued_entry {
+		float priority;
+		uint64_t sequence;
+		frontier_entry entry;
+
+		friend bool operator<(const queued_entry & lhs, const queued_entry & rhs) noexcept {
+			if (lhs.priority != rhs.priority) {
+				return lhs.priority < rhs.priority;
+			}
+			return lhs.sequence > rhs.sequence;
+		}
+	};
+
+	Priority priority;
+	std::unordered_set<std::string> known{};
+	std::unordered_map<std::string, size_t> host_ids{};
+	std::vector<std::vector<queued_entry>> hosts{}; // each one is a heap
+	size_t next_host{0};
+	uint64_t sequence{0};
+	size_t waiting{0};
+
+public:
+	explicit frontier(Priority p = {}): priority{std::move(p)} { }
+
+	// false if the URL was already seen
+	bool push(frontier_entry entry) {
+		if (!known.insert(entry.url).second) {
+			return false;
+		}
+
+		const auto [it, inserted] = host_ids.try_emplace(entry.host, hosts.size());
+		if (inserted) {
+			hosts.emplace_back();
+		}
+
+		auto & heap = hosts[it->second];
+		const float score = priority(entry);
+		heap.push_back(queued_entry{score, sequence++, std::move(entry)});
+		std::push_heap(heap.begin(), heap.end());
+		++waiting;
+
+		return true;
+	}
+
+	auto pop() -> std::optional<frontier_entry> {
+		for (size_t i = 0; i != hosts.size(); ++i) {
+			auto & heap = hosts[(next_host + i) % hosts.size()];
+
+			if (heap.empty()) {
+				continue;
+			}
+
+			next_host = (next_host + i + 1u) % hosts.size();
+
+			std::pop_heap(heap.begin(), heap.end());
+			auto result = std::move(heap.back().entry);
+			heap.pop_back();
+			--waiting;
+
+			return result;
+		}
+
+		return std::nullopt;
+	}
+
+	bool empty() const noexcept {
+		return waiting == 0;
+	}
+
+	size_t size() const noexcept {
+		return waiting;
+	}
+
+	// waiting + already taken
+	size_t known_urls() const noexcept {
+		return known.size();
+	}
+
+	// for checkpoints (in order of discovery, so resumed crawl breaks ties same way)
+	auto waiting_entries() const -> std::vector<frontier_entry> {
+		std::vector<const queued_entry *> all;
+		all.reserve(waiting);
+		for (const auto & heap: hosts) {
+			for (const queued_entry & queued: heap) {
+				all.push_back(&queued);
+			}
+		}
+
+		std::ranges::sort(all, {}, &queued_entry::sequence);
+
+		std::vector<frontier_entry> output;
+		output.reserve(all.size());
+		for (const queued_entry * queued: all) {
+			output.push_back(queued->entry);
+		}
+		return output;
+	}
+
+	auto known_list() const -> std::vector<std::string> {
+		return std::vector<std::string>(known.begin(), known.end());
+	}
+
+	// URL won't be accepted anymore (already downloaded in previous run)
+	void mark_known(std::string url) {
+		known.insert(std::move(url));
+	}
+};
+
+} // namespace crawler
+
+#endif
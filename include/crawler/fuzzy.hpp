@@ -0,0 +1,247 @@
+#ifndef CRAWLER_FUZZY_HPP
+#define CRAWLER_FUZZY_HPP
+
+#include "index.hpp"
+#include "planner.hpp"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace crawler {
+
+// Typo tolerant matching: place in a document is similar to the word when enough of the word's
+// ngrams are there at their offsets (one character off is still fine, so a missing or an extra
+// character in the middle doesn't break rest of the word). Similarity is matched / all ngrams
+// of the word (Dice coefficient of both ngram sets when the lengths are same). One wrong
+// character breaks at most N ngrams, so long words need more than the similarity says, which
+// keeps them from matching every word with same beginning.
+//
+// Only some ngrams are needed to find candidates: if `need` of `c` checked ngrams must match,
+// every match has at least one of any `c - need + 1` of them. Postings of the rarest ones are
+// merged with a heap (by document and aligned start) and every candidate is then checked in
+// postings of the other ones with galloping cursors (candidates come in order, cursors only move
+// forward), which are loaded only when some candidate gets to them.
+//
+// Very common ngrams (`max_common_ratio` times more postings than the candidates come from) are
+// not checked at all while the edit limit decides `need`: at most `max_edits * N` ngrams are
+// broken, so a place which has all but those of the word has all but those of the checked ones
+// too, and one unchecked ngram is one needed less. Nothing within the edit limit is lost, but
+// places which didn't have the dropped ngrams can be found too, so only the common ones are.
+
+struct similar_occurence_t {
+	occurence_t occurence; // position is where the word starts
+	uint32_t matched;	   // ngrams at their place
+	uint32_t ngrams;	   // of the searched word which were checked
+
+	constexpr double similarity() const noexcept {
+		return static_cast<double>(matched) / static_cast<double>(ngrams);
+	}
+};
+
+struct fuzzy_options_t {
+	double min_similarity{0.5};
+	uint32_t max_edits{1}; // wrong, missing or extra characters
+	double max_common_ratio{4.0}; // times postings merged to find candidates
+};
+
+// first item at or after `cursor` which is not less than `needle`
+inline size_t gallop_to(std::span<const occurence_t> postings, size_t cursor, occurence_t needle) noexcept {
+	size_t step = 1;
+	size_t low = cursor;
+	size_t high = cursor;
+
+	while (high < postings.size() && postings[high] < needle) {
+		low = high + 1u;
+		high = std::min(high + step, postings.size());
+		step *= 2u;
+	}
+
+	return static_cast<size_t>(std::lower_bound(postings.begin() + static_cast<std::ptrdiff_t>(low), postings.begin() + static_cast<std::ptrdiff_t>(high), needle) - postings.begin());
+}
+
+template <typename Index> auto find_similar(const Index & index, std::string_view word, fuzzy_options_t options = {}) -> std::vector<similar_occurence_t> {
+	constexpr size_t N = Index::ngram_size;
+
+	const auto ngrams = ngrams_of<N>(word);
+	const auto q = static_cast<uint32_t>(ngrams.size());
+
+	if (q == 0) {
+		return {};
+	}
+
+	// ngrams which must match of `c` checked ones
+	const auto need_of = [&](uint32_t c) {
+		const auto by_similarity = static_cast<uint32_t>(std::ceil(static_cast<double>(c) * options.min_similarity));
+		const auto by_edits = (c > options.max_edits * N) ? static_cast<uint32_t>(c - options.max_edits * N) : 0u;
+		return std::clamp(std::max(by_similarity, by_edits), 1u, c);
+	};
+
+	struct list_t {
+		uint32_t offset;
+		uint64_t size;
+		const std::vector<occurence_t> * postings{nullptr};
+	};
+
+	std::vector<list_t> lists;
+	lists.reserve(q);
+
+	for (uint32_t i = 0; i != q; ++i) {
+		const auto info = index.lookup(ngrams[i]);
+		lists.push_back(list_t{.offset = i, .size = info ? info->postings : 0u});
+	}
+
+	// rarest first, ngrams which are nowhere (made by the typo) are the cheapest ones
+	std::ranges::stable_sort(lists, std::less<>{}, &list_t::size);
+
+	// no ngram of the word is anywhere
+	if (lists.back().size == 0) {
+		return {};
+	}
+
+	// postings which must be merged to find candidates anyway
+	uint64_t merged = 0;
+	for (uint32_t i = 0; i != q - need_of(q) + 1u; ++i) {
+		merged += lists[i].size;
+	}
+
+	const auto common = static_cast<double>(merged) * options.max_common_ratio;
+
+	for (auto c = q; c > need_of(c) + 1u && need_of(c - 1u) + 1u == need_of(c); --c) {
+		if (static_cast<double>(lists.back().size) <= common) {
+			break;
+		}
+		lists.pop_back();
+	}
+
+	const auto checked = static_cast<uint32_t>(lists.size());
+	const auto need = need_of(checked);
+
+	// every ngram is loaded once, even when it's in the word more times (reserved, so pointers stay)
+	std::vector<std::vector<occurence_t>> loaded;
+	std::vector<ngram_t<N>> loaded_ngrams;
+	loaded.reserve(checked);
+	loaded_ngrams.reserve(checked);
+
+	const auto load = [&](list_t & list) -> const std::vector<occurence_t> * {
+		if (list.postings != nullptr || list.size == 0) {
+			return list.postings;
+		}
+
+		const auto & ngram = ngrams[list.offset];
+		const auto it = std::ranges::find(loaded_ngrams, ngram);
+
+		if (it != loaded_ngrams.end()) {
+			list.postings = &loaded[static_cast<size_t>(it - loaded_ngrams.begin())];
+		} else {
+			loaded_ngrams.push_back(ngram);
+			list.postings = &loaded.emplace_back(index.postings(ngram));
+		}
+
+		return list.postings;
+	};
+
+	const size_t candidate_lists = checked - need + 1u;
+
+	struct cursor_t {
+		occurence_t key; // document and start of the word
+		uint32_t list;
+		size_t position;
+	};
+
+	constexpr auto later = [](const cursor_t & lhs, const cursor_t & rhs) { return rhs.key < lhs.key; };
+	std::priority_queue<cursor_t, std::vector<cursor_t>, decltype(later)> heap{later};
+
+	const auto push = [&](uint32_t list, size_t position) {
+		const auto & postings = *lists[list].postings;
+		const uint32_t offset = lists[list].offset;
+
+		while (position < postings.size() && postings[position].position.n < offset) {
+			++position;
+		}
+
+		if (position < postings.size()) {
+			heap.push(cursor_t{.key = occurence_t{.id = postings[position].id, .position = position_t{postings[position].position.n - offset}}, .list = list, .position = position});
+		}
+	};
+
+	for (uint32_t i = 0; i != candidate_lists; ++i) {
+		if (load(lists[i]) != nullptr) {
+			push(i, 0);
+		}
+	}
+
+	std::vector<size_t> cursors(lists.size(), 0);
+	std::vector<uint8_t> popped(lists.size(), 0);
+	std::vector<uint32_t> popped_lists;
+	std::vector<similar_occurence_t> output;
+
+	while (!heap.empty()) {
+		const occurence_t candidate = heap.top().key;
+
+		// same place from other lists, they match and don't need to be checked again
+		popped_lists.clear();
+
+		while (!heap.empty() && heap.top().key == candidate) {
+			const cursor_t top = heap.top();
+			heap.pop();
+			popped[top.list] = 1;
+			popped_lists.push_back(top.list);
+			push(top.list, top.position + 1u);
+		}
+
+		auto matched = static_cast<uint32_t>(popped_lists.size());
+		uint32_t unchecked = checked - matched;
+
+		for (uint32_t i = 0; i != lists.size() && matched + unchecked >= need; ++i) {
+			if (popped[i] != 0) {
+				continue;
+			}
+
+			--unchecked;
+
+			const auto * list_postings = load(lists[i]);
+
+			if (list_postings == nullptr) {
+				continue;
+			}
+
+			const auto & postings = *list_postings;
+			const uint32_t expected = candidate.position.n + lists[i].offset;
+			const uint32_t from = (expected != 0u) ? expected - 1u : 0u;
+
+			cursors[i] = gallop_to(postings, cursors[i], occurence_t{.id = candidate.id, .position = position_t{from}});
+
+			const size_t c = cursors[i];
+			if (c != postings.size() && postings[c].id == candidate.id && postings[c].position.n <= expected + 1u) {
+				++matched;
+			}
+		}
+
+		for (uint32_t list: popped_lists) {
+			popped[list] = 0;
+		}
+
+		if (matched < need) {
+			continue;
+		}
+
+		// one place is found from several starts (when it's one character off), best one is kept
+		if (!output.empty() && output.back().occurence.id == candidate.id && candidate.position.n - output.back().occurence.position.n < N) {
+			if (matched > output.back().matched) {
+				output.back() = similar_occurence_t{.occurence = candidate, .matched = matched, .ngrams = checked};
+			}
+			continue;
+		}
+
+		output.push_back(similar_occurence_t{.occurence = candidate, .matched = matched, .ngrams = checked});
+	}
+
+	return output;
+}
+
+} // namespace crawler
+
+#endif
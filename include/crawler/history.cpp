@@ -0,0 +1,115 @@
+#include "history.hpp"
+#include <algorithm>
+#include <iostream>
+
+auto crawler::crawl_history::load(const std::filesystem::path & prefix) -> std::optional<crawl_history> {
+	auto base = load_page_meta(prefix / "meta.bin");
+
+	if (!base) {
+		return std::nullopt;
+	}
+
+	crawl_history output{};
+	output.old_tombstones.base_documents = static_cast<uint32_t>(base->size());
+
+	std::vector<page_meta_t> delta{};
+
+	if (std::filesystem::exists(prefix / "delta" / "meta.bin")) {
+		auto tombstones = load_tombstones(prefix / "delta" / "tombstones.bin");
+		auto meta = load_page_meta(prefix / "delta" / "meta.bin");
+
+		if (!tombstones || !meta) {
+			return std::nullopt;
+		}
+
+		if (tombstones->base_documents != base->size()) {
+			std::cerr << "delta doesn't belong to the index: " << prefix << "\n";
+			return std::nullopt;
+		}
+
+		output.old_tombstones = std::move(*tombstones);
+		delta = std::move(*meta);
+	}
+
+	output.pages.reserve(base->size() + delta.size());
+
+	for (uint32_t id = 0; id != base->size(); ++id) {
+		if (!output.old_tombstones.contains(id)) {
+			output.pages.push_back(page_t{.meta = std::move((*base)[id]), .id = id, .in_delta = false});
+		}
+	}
+
+	for (uint32_t id = 0; id != delta.size(); ++id) {
+		output.pages.push_back(page_t{.meta = std::move(delta[id]), .id = id, .in_delta = true});
+	}
+
+	// newer version wins (delta is after base)
+	for (size_t i = 0; i != output.pages.size(); ++i) {
+		output.by_url.insert_or_assign(std::string_view(output.pages[i].meta.url), i);
+	}
+
+	return output;
+}
+
+auto crawler::crawl_history::find_page(std::string_view url) noexcept -> page_t * {
+	const auto it = by_url.find(url);
+	return (it != by_url.end()) ? &pages[it->second] : nullptr;
+}
+
+auto crawler::crawl_history::find(std::string_view url) const noexcept -> const page_meta_t * {
+	const auto it = by_url.find(url);
+	return (it != by_url.end()) ? &pages[it->second].meta : nullptr;
+}
+
+void crawler::crawl_history::mark(std::string_view url, state_t state) noexcept {
+	if (page_t * page = find_page(url)) {
+		page->state = state;
+	}
+}
+
+auto crawler::crawl_history::urls() const -> std::vector<std::string> {
+	std::vector<std::string> output;
+	output.reserve(by_url.size());
+	for (const auto & [url, index]: by_url) {
+		output.emplace_back(url);
+	}
+	std::ranges::sort(output);
+	return output;
+}
+
+auto crawler::crawl_history::kept_from_delta() const -> std::vector<uint32_t> {
+	std::vector<uint32_t> output;
+	for (const auto & [url, index]: by_url) {
+		const page_t & page = pages[index];
+		if (page.in_delta && (page.state == state_t::not_visited || page.state == state_t::unchanged)) {
+			output.push_back(page.id);
+		}
+	}
+	std::ranges::sort(output);
+	return output;
+}
+
+auto crawler::crawl_history::tombstones() const -> tombstones_t {
+	tombstones_t output = old_tombstones;
+
+	for (const page_t & page: pages) {
+		if (page.in_delta) {
+			continue;
+		}
+		// base version which was already shadowed by old delta, or is gone/replaced now
+		const bool shadowed = by_url.at(page.meta.url) != static_cast<size_t>(&page - pages.data());
+		if (shadowed || page.state == state_t::replaced || page.state == state_t::gone) {
+			output.ids.push_back(page.id);
+		}
+	}
+
+	std::ranges::sort(output.ids);
+	const auto duplicates = std::ranges::unique(output.ids);
+	output.ids.erase(duplicates.begin(), duplicates.end());
+
+	return output;
+}
+
+size_t crawler::crawl_history::count(state_t state) const noexcept {
+	return static_cast<size_t>(std::ranges::count_if(by_url, [&](const auto & pair) { return pages[pair.second].state == state; }));
+}
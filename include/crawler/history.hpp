@@ -0,0 +1,73 @@
+#ifndef CRAWLER_HISTORY_HPP
+#define CRAWLER_HISTORY_HPP
+
+#include "page-meta.hpp"
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+namespace crawler {
+
+// Pages of an existing index (base in `prefix` and its delta in `prefix/delta`) and what
+// happened with them during re-crawl. Result of the re-crawl is a new delta: changed and new
+// documents, unchanged documents of the old delta, and tombstones for replaced base documents.
+class crawl_history {
+public:
+	enum class state_t {
+		not_visited, // stays as it is
+		unchanged,	 // 304 or same body
+		replaced,	 // new version is in the new delta
+		gone		 // 404 or 410
+	};
+
+private:
+	struct page_t {
+		page_meta_t meta;
+		uint32_t id; // in base or in old delta
+		bool in_delta;
+		state_t state{state_t::not_visited};
+	};
+
+	std::vector<page_t> pages{};
+	std::unordered_map<std::string_view, size_t> by_url{}; // views into `pages` (it's not resized after load)
+	tombstones_t old_tombstones{};
+
+	page_t * find_page(std::string_view url) noexcept;
+
+public:
+	// std::nullopt if there is no base with page metadata
+	static auto load(const std::filesystem::path & prefix) -> std::optional<crawl_history>;
+
+	crawl_history() = default;
+	crawl_history(crawl_history &&) = default;
+	crawl_history(const crawl_history &) = delete;
+	crawl_history & operator=(crawl_history &&) = default;
+
+	// validators and hash of current version of the page
+	auto find(std::string_view url) const noexcept -> const page_meta_t *;
+
+	void mark(std::string_view url, state_t state) noexcept;
+
+	// all current pages (re-crawl starts with them, as unchanged pages don't give us their links)
+	auto urls() const -> std::vector<std::string>;
+
+	uint32_t base_documents() const noexcept {
+		return old_tombstones.base_documents;
+	}
+
+	// documents of old delta which are still current
+	auto kept_from_delta() const -> std::vector<uint32_t>;
+
+	// old tombstones + base documents which were replaced or are gone
+	auto tombstones() const -> tombstones_t;
+
+	size_t count(state_t state) const noexcept;
+};
+
+} // namespace crawler
+
+#endif
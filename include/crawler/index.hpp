@@ -1,14 +1,28 @@
 #ifndef CRAWLER_INDEX_HPP
 #define CRAWLER_INDEX_HPP
 
+#include "binary.hpp"
+#include "document-store.hpp"
+#include "interner.hpp"
+#include "page-meta.hpp"
+#include "url-dictionary.hpp"
 #include <algorithm>
 #include <array>
 #include <filesystem>
-#include <format>
 #include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
 #include <map>
+#include <numeric>
 #include <ranges>
 #include <set>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cassert>
+#include <cstdint>
 
 namespace crawler {
 
@@ -82,20 +96,70 @@ template <size_t N> struct ngram_builder_t {
 	}
 };
 
+// characters of words in the word index: lowercase letters, digits, '_' and bytes of UTF-8 sequences
+// (text is lowercase already), everything else separates words
+constexpr bool is_word_character(char c) noexcept {
+	return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_' || static_cast<unsigned char>(c) >= 0x80u;
+}
+
+// shorter ones are everywhere, longer ones (hashes, base64, mangled names) would only bloat the word
+// index, same range for any ngram size
+static constexpr size_t min_word_length = 3;
+static constexpr size_t max_word_length = 48;
+
+// word which can be in the word index as whole
+constexpr bool is_indexed_word(std::string_view word) noexcept {
+	return word.size() >= min_word_length && word.size() <= max_word_length && std::ranges::all_of(word, is_word_character);
+}
+
+// calls `callback(word, position)` for every indexed word of the text, position is of its first character
+template <typename Callback> void for_each_word(std::string_view text, Callback && callback) {
+	size_t start = 0;
+
+	for (size_t i = 0; i <= text.size(); ++i) {
+		if (i != text.size() && is_word_character(text[i])) {
+			continue;
+		}
+
+		const auto word = text.substr(start, i - start);
+
+		if (word.size() >= min_word_length && word.size() <= max_word_length) {
+			callback(word, position_t{static_cast<uint32_t>(start)});
+		}
+
+		start = i + 1u;
+	}
+}
+
 struct link_target {
-	std::string target;
+	position_t position;
+	uint32_t string; // id in index_t::target_strings
 };
 
 struct document_info {
 	std::string url;
 	size_t ngrams{0};
-	std::map<position_t, link_target> position_to_target{};
+	std::vector<link_target> targets{}; // sorted by position only after `finalize_targets`
+	compressed_text_t text{};
+	// for conditional requests of next crawl (see crawler/page-meta.hpp)
+	std::string etag{};
+	std::string last_modified{};
+	uint64_t content_hash{0};
+	std::vector<std::string> links{};
 
 	explicit document_info(std::string url_): url{std::move(url_)} { }
 
-	inline void add_target(position_t pos, std::string target) {
-		// we want always the latest one...
-		position_to_target.insert_or_assign(pos, link_target{std::move(target)});
+	inline void add_target(position_t pos, uint32_t string) {
+		targets.push_back(link_target{pos, string});
+	}
+
+	// one target per position, we want always the latest one...
+	void finalize_targets() {
+		std::ranges::stable_sort(targets, {}, &link_target::position);
+
+		const auto last_of_each = std::ranges::unique(targets.rbegin(), targets.rend(), {}, &link_target::position);
+		targets.erase(targets.begin(), last_of_each.begin().base());
+		targets.shrink_to_fit();
 	}
 };
 
@@ -107,32 +171,350 @@ struct occurence_t {
 	constexpr friend auto operator<=>(occurence_t, occurence_t) noexcept = default;
 };
 
+// number of unique documents (expects sorted data)
+inline size_t document_frequency(std::span<const occurence_t> data) noexcept {
+	size_t output = 0;
+	const occurence_t * previous = nullptr;
+	for (const occurence_t & occ: data) {
+		if (previous == nullptr || previous->id != occ.id) {
+			++output;
+		}
+		previous = &occ;
+	}
+	return output;
+}
+
+// writes sorted data as `[[id,position],...]`
+inline void write_postings(std::ostream & of, std::span<const occurence_t> data) {
+	of << "[";
+
+	bool first = true;
+	for (const occurence_t & occ: data) {
+		if (first) first = false;
+		else
+			of << ",";
+		of << "[" << occ.id << "," << occ.position.n << "]";
+	}
+
+	of << "]";
+}
+
 struct leaf_t {
 	std::set<occurence_t> data;
 	std::vector<occurence_t> unsorted_data;
 
-	template <size_t N> void save_to(ngram_t<N> ngram, const std::filesystem::path & prefix) {
+	size_t document_frequency() const noexcept {
+		return crawler::document_frequency(unsorted_data);
+	}
+
+	// sorts data and writes it as `[[id,position],...]`
+	void write_to(std::ostream & of) {
 		std::sort(unsorted_data.begin(), unsorted_data.end());
+		write_postings(of, unsorted_data);
+	}
 
+	// returns number of bytes written (0 if it failed)
+	template <size_t N> size_t save_to(ngram_t<N> ngram, const std::filesystem::path & prefix) {
 		const auto name = prefix / ngram;
 
 		auto of = std::ofstream{name, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc};
 
 		if (!of) {
 			std::cerr << "can't open: " << name << "\n";
-			return;
+			return 0;
+		}
+
+		write_to(of);
+
+		return static_cast<size_t>(of.tellp());
+	}
+};
+
+// exact size of every leaf, so query side can plan which ngrams are cheapest to use and score them
+// format: "NGRM" u32(version) u32(N) u32(count) [ngram[N] u32(postings) u32(bytes) u32(documents)]*count (sorted by ngram)
+struct dictionary_entry_t {
+	uint32_t postings;
+	uint32_t bytes;
+	uint32_t documents;
+};
+
+static constexpr uint32_t dictionary_version = 2;
+
+// leaves/<ngram>.json for every ngram, or few big packs/<n>.pack for static hosting where
+// a request per ngram is too expensive (client reads leaves from them with Range requests)
+enum class leaves_layout { files, packs };
+
+// packs are closed after reaching this size, but only between ngrams with different first byte
+static constexpr size_t pack_target_size = 4u * 1024u * 1024u;
+
+// ngrams and their sizes in same (sorted) order
+template <size_t N> void save_dictionary_file(const std::filesystem::path & name, std::span<const ngram_t<N>> ngrams, std::span<const dictionary_entry_t> sizes) {
+	assert(sizes.size() == ngrams.size());
+
+	auto of = std::ofstream{name, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc};
+
+	if (!of) {
+		std::cerr << "can't open file: " << name << "\n";
+		return;
+	}
+
+	write_magic(of, "NGRM");
+	write_u32(of, dictionary_version);
+	write_u32(of, static_cast<uint32_t>(N));
+	write_u32(of, static_cast<uint32_t>(ngrams.size()));
+
+	for (size_t i = 0; i != ngrams.size(); ++i) {
+		of.write(reinterpret_cast<const char *>(ngrams[i].data()), N);
+		write_u32(of, sizes[i].postings);
+		write_u32(of, sizes[i].bytes);
+		write_u32(of, sizes[i].documents);
+	}
+}
+
+// top 5% of ngrams by number of postings as `{"hexdec":count,...}`
+template <size_t N> void save_outliers_file(const std::filesystem::path & name, std::span<const ngram_t<N>> ngrams, std::span<const dictionary_entry_t> sizes) {
+	assert(sizes.size() == ngrams.size());
+
+	auto of = std::ofstream{name, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc};
+
+	std::vector<size_t> order(ngrams.size());
+	std::iota(order.begin(), order.end(), size_t{0});
+
+	// biggest first, then by ngram
+	std::ranges::sort(order, [&](size_t lhs, size_t rhs) {
+		return std::tie(sizes[rhs].postings, ngrams[rhs]) < std::tie(sizes[lhs].postings, ngrams[lhs]);
+	});
+
+	bool first = true;
+	of << "{";
+	for (size_t i: order | std::ranges::views::take(order.size() / 20)) {
+		if (first) first = false;
+		else
+			of << ",";
+
+		of << std::quoted(ngrams[i].get_hexdec()) << ":" << sizes[i].postings;
+	}
+	of << "}";
+}
+
+// biggest 5% of ngrams by size of their leaf with percentile above 95th as `{"hexdec":0..4,...}`
+// (sorted by ngram), static table so nothing has to list leaves when it's asked for
+template <size_t N> void save_offenders_file(const std::filesystem::path & name, std::span<const ngram_t<N>> ngrams, std::span<const dictionary_entry_t> sizes) {
+	assert(sizes.size() == ngrams.size());
+
+	auto of = std::ofstream{name, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc};
+
+	if (!of) {
+		std::cerr << "can't open file: " << name << "\n";
+		return;
+	}
+
+	std::vector<size_t> order(ngrams.size());
+	std::iota(order.begin(), order.end(), size_t{0});
+	std::ranges::stable_sort(order, std::less<>{}, [&](size_t i) { return sizes[i].bytes; });
+
+	std::vector<uint8_t> percentile(ngrams.size(), 0);
+	for (size_t rank = 0; rank != order.size(); ++rank) {
+		percentile[order[rank]] = static_cast<uint8_t>(rank * 100u / order.size());
+	}
+
+	bool first = true;
+	of << "{";
+	for (size_t i = 0; i != ngrams.size(); ++i) {
+		if (percentile[i] < 95u) {
+			continue;
+		}
+
+		if (first) first = false;
+		else
+			of << ",";
+
+		of << std::quoted(ngrams[i].get_hexdec()) << ":" << (percentile[i] - 95u);
+	}
+	of << "}";
+}
+
+// words offered while typing into the search box, only the most frequent ones are kept (so browser
+// can download all of them) and best `completions_per_prefix` of every prefix are precomputed
+static constexpr size_t max_completion_terms = 65536;
+static constexpr uint32_t completions_per_prefix = 8;
+
+struct completion_term_t {
+	std::string_view term;
+	uint32_t score; // documents with the term
+};
+
+// "CMPL" u32(version) u32(k) u32(term count) u32(node count)
+// u32(string offset)[term count + 1] u32(score)[term count]
+// u32(first term)[node count] u32(last term)[node count] u32(best terms)[node count * k] string pool
+//
+// terms are sorted, so all terms with same prefix are a range [first, last) of them, node is
+// a range with more than k terms (ranges with k terms or less are simply sorted by score when
+// asked for), nodes are sorted by first term and then by longer range first, one range of
+// several prefixes (`constexp`, `constexpr`) is there once (see crawler/completion-table.hpp)
+inline void save_completions_file(const std::filesystem::path & name, std::vector<completion_term_t> terms) {
+	auto of = std::ofstream{name, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc};
+
+	if (!of) {
+		std::cerr << "can't open file: " << name << "\n";
+		return;
+	}
+
+	constexpr auto better = [](const completion_term_t & lhs, const completion_term_t & rhs) {
+		return std::tie(rhs.score, lhs.term) < std::tie(lhs.score, rhs.term);
+	};
+
+	if (terms.size() > max_completion_terms) {
+		std::ranges::nth_element(terms, terms.begin() + max_completion_terms, better);
+		terms.resize(max_completion_terms);
+	}
+
+	std::ranges::sort(terms, std::less<>{}, &completion_term_t::term);
+
+	const auto count = static_cast<uint32_t>(terms.size());
+	constexpr uint32_t k = completions_per_prefix;
+
+	std::vector<uint32_t> rank(count);
+	{
+		std::vector<uint32_t> order(count);
+		std::iota(order.begin(), order.end(), 0u);
+		std::ranges::sort(order, [&](uint32_t lhs, uint32_t rhs) { return better(terms[lhs], terms[rhs]); });
+
+		for (uint32_t i = 0; i != count; ++i) {
+			rank[order[i]] = i;
 		}
-		of << "[";
+	}
+
+	struct node_t {
+		uint32_t first;
+		uint32_t last;
+	};
+
+	std::vector<node_t> nodes;
+	std::vector<uint32_t> best;
+	std::vector<uint32_t> range;
+
+	for (uint32_t i = 0; i != count; ++i) {
+		const std::string_view term = terms[i].term;
+
+		// shorter prefixes started with some previous term
+		const std::string_view previous = (i != 0) ? terms[i - 1u].term : std::string_view{};
+		const size_t common = static_cast<size_t>(std::ranges::mismatch(term, previous).in1 - term.begin());
+
+		for (size_t length = common + 1u; length <= term.size(); ++length) {
+			const auto prefix = term.substr(0, length);
+			const auto end = std::partition_point(terms.begin() + i, terms.end(), [&](const completion_term_t & other) { return other.term.starts_with(prefix); });
+			const auto last = static_cast<uint32_t>(end - terms.begin());
+
+			if (last - i <= k) {
+				break;
+			}
+
+			if (!nodes.empty() && nodes.back().first == i && nodes.back().last == last) {
+				continue;
+			}
+
+			nodes.push_back(node_t{.first = i, .last = last});
+
+			range.resize(last - i);
+			std::iota(range.begin(), range.end(), i);
+			std::ranges::partial_sort(range, range.begin() + k, std::less<>{}, [&](uint32_t id) { return rank[id]; });
+			best.insert(best.end(), range.begin(), range.begin() + k);
+		}
+	}
+
+	write_magic(of, "CMPL");
+	write_u32(of, 1);
+	write_u32(of, k);
+	write_u32(of, count);
+	write_u32(of, static_cast<uint32_t>(nodes.size()));
+
+	uint32_t offset = 0;
+	for (const completion_term_t & term: terms) {
+		write_u32(of, offset);
+		offset += static_cast<uint32_t>(term.term.size());
+	}
+	write_u32(of, offset);
+
+	for (const completion_term_t & term: terms) {
+		write_u32(of, term.score);
+	}
+
+	for (const node_t & node: nodes) {
+		write_u32(of, node.first);
+	}
+
+	for (const node_t & node: nodes) {
+		write_u32(of, node.last);
+	}
+
+	for (uint32_t id: best) {
+		write_u32(of, id);
+	}
+
+	for (const completion_term_t & term: terms) {
+		of.write(term.term.data(), static_cast<std::streamsize>(term.term.size()));
+	}
+}
+
+// leaves concatenated into packs/<n>.pack, manifest "PACK" u32(version) u32(pack count) u32(first ngram)[pack count + 1]
+// first ngram is index of record in ngrams.bin, offset of a leaf inside its pack is sum of `bytes` of
+// records before it in the same pack (so manifest doesn't need to repeat what dictionary has)
+class pack_writer {
+	std::filesystem::path prefix;
+	std::vector<uint32_t> first_ngram{};
+	std::ofstream of{};
+	size_t pack_size{0};
+	uint32_t leaves{0};
+	char8_t previous_prefix{0};
+
+public:
+	explicit pack_writer(std::filesystem::path p): prefix{std::move(p)} { }
+
+	// stream for next leaf (nullptr if a pack can't be created)
+	auto next(char8_t first_byte) -> std::ostream * {
+		if (!of.is_open() || (first_byte != previous_prefix && pack_size >= pack_target_size)) {
+			const auto name = prefix / "packs" / (std::to_string(first_ngram.size()) + ".pack");
+			of = std::ofstream{name, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc};
+
+			if (!of) {
+				std::cerr << "can't open file: " << name << "\n";
+				return nullptr;
+			}
+
+			first_ngram.push_back(leaves);
+			pack_size = 0;
+		}
+
+		previous_prefix = first_byte;
+		++leaves;
+
+		return &of;
+	}
+
+	void written(size_t bytes) noexcept {
+		pack_size += bytes;
+	}
+
+	// writes manifest packs.bin
+	void finish() {
+		first_ngram.push_back(leaves);
+
+		const auto name = prefix / "packs.bin";
+		auto manifest = std::ofstream{name, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc};
 
-		bool first = true;
-		for (const occurence_t & occ: unsorted_data) {
-			if (first) first = false;
-			else
-				of << ",";
-			of << "[" << occ.id << "," << occ.position.n << "]";
+		if (!manifest) {
+			std::cerr << "can't open file: " << name << "\n";
+			return;
 		}
 
-		of << "]";
+		write_magic(manifest, "PACK");
+		write_u32(manifest, 1);
+		write_u32(manifest, static_cast<uint32_t>(first_ngram.size() - 1u));
+
+		for (uint32_t first: first_ngram) {
+			write_u32(manifest, first);
+		}
 	}
 };
 
@@ -142,9 +524,12 @@ template <size_t N> struct index_t {
 
 	documents_type documents{};
 	std::map<ngram_type, leaf_t> leaves{};
+	std::map<std::string, leaf_t, std::less<>> words{}; // whole words, so they don't need to be assembled from ngrams
+	string_interner target_strings{}; // same anchors (#Parameters, #Return_value, ...) are on most pages
 
 	index_t() = default;
 	index_t(index_t &&) = default;
+	index_t & operator=(index_t &&) = default;
 	index_t(const index_t &) = delete;
 	~index_t() noexcept = default;
 
@@ -158,6 +543,23 @@ template <size_t N> struct index_t {
 		++doc.ngrams;
 	}
 
+	void insert_word(std::string_view word, position_t position, document_info & doc) {
+		auto it = words.find(word);
+		if (it == words.end()) {
+			it = words.emplace(std::string(word), leaf_t{}).first;
+		}
+		it->second.unsorted_data.emplace_back((uint32_t)std::distance(documents.data(), std::addressof(doc)), position);
+	}
+
+	// same plain text as for ngrams (positions match)
+	void insert_words(std::string_view text, document_info & doc) {
+		for_each_word(text, [&](std::string_view word, position_t position) { insert_word(word, position, doc); });
+	}
+
+	void add_target(document_info & doc, position_t position, std::string_view target) {
+		doc.add_target(position, target_strings.intern(target));
+	}
+
 	void insert_ngram(ngram_builder_t<N> & builder, document_info & doc) {
 		if (!builder) {
 			return;
@@ -166,100 +568,343 @@ template <size_t N> struct index_t {
 		insert_ngram(builder.ngram(), builder.position(), doc);
 	}
 
-	void save_documents_list(const std::filesystem::path & name) const {
+	// `order` is list of old ids in their new order, documents and postings are renumbered to match
+	void reorder_documents(std::span<const uint32_t> order) {
+		assert(order.size() == documents.size());
+
+		std::vector<uint32_t> new_id(order.size());
+		for (size_t i = 0; i != order.size(); ++i) {
+			new_id[order[i]] = static_cast<uint32_t>(i);
+		}
+
+		documents_type reordered;
+		reordered.reserve(documents.size());
+		for (uint32_t old_id: order) {
+			reordered.push_back(std::move(documents[old_id]));
+		}
+		documents = std::move(reordered);
+
+		// postings are sorted again when saved
+		for (auto & [ngram, leaf]: leaves) {
+			for (occurence_t & occ: leaf.unsorted_data) {
+				occ.id = new_id[occ.id];
+			}
+		}
+
+		for (auto & [word, leaf]: words) {
+			for (occurence_t & occ: leaf.unsorted_data) {
+				occ.id = new_id[occ.id];
+			}
+		}
+	}
+
+	// copies documents `ids` of `other` (with their postings) after documents already here
+	void append_documents(const index_t & other, std::span<const uint32_t> ids) {
+		constexpr auto missing = std::numeric_limits<uint32_t>::max();
+		std::vector<uint32_t> new_id(other.documents.size(), missing);
+
+		for (uint32_t id: ids) {
+			const document_info & source = other.documents[id];
+			new_id[id] = static_cast<uint32_t>(documents.size());
+
+			auto & doc = insert_document(source.url);
+			doc.ngrams = source.ngrams;
+			doc.text = source.text;
+			doc.etag = source.etag;
+			doc.last_modified = source.last_modified;
+			doc.content_hash = source.content_hash;
+			doc.links = source.links;
+			doc.targets.reserve(source.targets.size());
+			for (const link_target & target: source.targets) {
+				doc.add_target(target.position, target_strings.intern(other.target_strings.get(target.string)));
+			}
+		}
+
+		for (const auto & [ngram, leaf]: other.leaves) {
+			leaf_t * destination = nullptr;
+			for (const occurence_t occ: leaf.unsorted_data) {
+				if (new_id[occ.id] == missing) {
+					continue;
+				}
+				if (destination == nullptr) {
+					destination = &leaves[ngram];
+				}
+				destination->unsorted_data.push_back(occurence_t{.id = new_id[occ.id], .position = occ.position});
+			}
+		}
+
+		for (const auto & [word, leaf]: other.words) {
+			leaf_t * destination = nullptr;
+			for (const occurence_t occ: leaf.unsorted_data) {
+				if (new_id[occ.id] == missing) {
+					continue;
+				}
+				if (destination == nullptr) {
+					destination = &words[word];
+				}
+				destination->unsorted_data.push_back(occurence_t{.id = new_id[occ.id], .position = occ.position});
+			}
+		}
+	}
+
+	void save_documents_urls(const std::filesystem::path & name) const {
+		const auto urls = documents | std::views::transform([](const document_info & doc) { return std::string_view(doc.url); }) | std::ranges::to<std::vector>();
+		save_url_dictionary(name, urls);
+	}
+
+	void save_documents_meta(const std::filesystem::path & name) const {
+		const auto pages = documents | std::views::transform([](const document_info & doc) { return page_meta_t{.url = doc.url, .etag = doc.etag, .last_modified = doc.last_modified, .content_hash = doc.content_hash, .links = doc.links}; }) | std::ranges::to<std::vector>();
+		save_page_meta(name, pages);
+	}
+
+	// lengths for scoring (BM25 needs them for every document)
+	// format: "DOCS" u32(version) u32(count) u64(total ngrams) [u32(ngrams)]*count
+	void save_documents_lengths(const std::filesystem::path & name) const {
 		auto of = std::ofstream{name, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc};
-		of << "[";
-		bool first = true;
+
+		if (!of) {
+			std::cerr << "can't open file: " << name << "\n";
+			return;
+		}
+
+		const uint64_t total = std::accumulate(documents.begin(), documents.end(), uint64_t{0}, [](uint64_t lhs, const document_info & rhs) { return lhs + rhs.ngrams; });
+
+		write_magic(of, "DOCS");
+		write_u32(of, 1);
+		write_u32(of, static_cast<uint32_t>(documents.size()));
+		write_u64(of, total);
+
 		for (const auto & doc: documents) {
-			if (first) first = false;
-			else
-				of << ",";
-			of << "[" << std::quoted(doc.url) << "," << doc.ngrams << "]";
+			write_u32(of, static_cast<uint32_t>(doc.ngrams));
 		}
-		of << "]";
 	}
 
-	void save_documents_targets(const std::filesystem::path & prefix) const {
-		const auto beg = documents.begin();
-		const auto end = documents.end();
-		for (auto it = documents.begin(); it != end; ++it) {
-			const auto & doc = *it;
-			std::filesystem::path name = prefix / std::format("{:0>5}.json", std::distance(beg, it));
-			auto of = std::ofstream{name, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc};
+	void save_documents_text(const std::filesystem::path & name) const {
+		const auto texts = documents | std::views::transform([](const document_info & doc) { return &doc.text; }) | std::ranges::to<std::vector>();
+		save_document_store(name, texts);
+	}
 
-			if (!of) {
-				std::cerr << "can't open file: " << name << "\n";
-				return;
-			}
+	// "TRGT" u32(version) u32(document count) u32(target count) u32(string count)
+	// u32(first target)[document count + 1] u32(position)[target count] u32(string id)[target count]
+	// u32(string offset)[string count + 1] string pool
+	// (documents must have their targets finalized, see crawler/target-table.hpp)
+	void save_documents_targets(const std::filesystem::path & name) const {
+		auto of = std::ofstream{name, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc};
+
+		if (!of) {
+			std::cerr << "can't open file: " << name << "\n";
+			return;
+		}
 
-			of << "[";
+		const auto strings = target_strings.all();
 
-			bool first2 = true;
-			for (const auto & [position, target]: doc.position_to_target) {
-				if (first2) first2 = false;
-				else
-					of << ",";
-				of << "[";
-				of << position.n << "," << std::quoted(target.target);
-				of << "]";
+		uint32_t total = 0;
+		for (const auto & doc: documents) {
+			total += static_cast<uint32_t>(doc.targets.size());
+		}
+
+		write_magic(of, "TRGT");
+		write_u32(of, 1);
+		write_u32(of, static_cast<uint32_t>(documents.size()));
+		write_u32(of, total);
+		write_u32(of, static_cast<uint32_t>(strings.size()));
+
+		uint32_t first = 0;
+		for (const auto & doc: documents) {
+			write_u32(of, first);
+			first += static_cast<uint32_t>(doc.targets.size());
+		}
+		write_u32(of, first);
+
+		for (const auto & doc: documents) {
+			for (const link_target & target: doc.targets) {
+				write_u32(of, target.position.n);
 			}
-			of << "]";
 		}
-	}
 
-	struct ngram_and_size_t {
-		size_t size;
-		ngram_type ngram;
+		for (const auto & doc: documents) {
+			for (const link_target & target: doc.targets) {
+				write_u32(of, target.string);
+			}
+		}
 
-		friend constexpr auto operator<=>(const ngram_and_size_t & lhs, const ngram_and_size_t & rhs) noexcept {
-			// switch lhs and rhs intentionally
-			return std::tie(rhs.size, rhs.ngram) <=> std::tie(lhs.size, lhs.ngram);
+		uint32_t offset = 0;
+		for (std::string_view str: strings) {
+			write_u32(of, offset);
+			offset += static_cast<uint32_t>(str.size());
 		}
+		write_u32(of, offset);
 
-		friend constexpr bool operator==(const ngram_and_size_t & lhs, const ngram_and_size_t & rhs) noexcept = default;
-	};
+		for (std::string_view str: strings) {
+			of.write(str.data(), static_cast<std::streamsize>(str.size()));
+		}
+	}
 
-	void save_outliers(const std::filesystem::path & name) const {
+	// "WORD" u32(version) u32(word count) u32(posting count)
+	// u32(string offset)[word count + 1] u32(first posting)[word count + 1] u32(documents)[word count]
+	// [u32(id) u32(position)][posting count] string pool (words sorted, see crawler/word-table.hpp)
+	void save_words(const std::filesystem::path & name) {
 		auto of = std::ofstream{name, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc};
 
-		constexpr auto ngram_and_size = std::views::transform([](const auto & pair) {
-			return ngram_and_size_t{pair.second.unsorted_data.size(), pair.first};
-		});
+		if (!of) {
+			std::cerr << "can't open file: " << name << "\n";
+			return;
+		}
+
+		uint32_t total = 0;
+		for (auto & [word, leaf]: words) {
+			if (!std::ranges::is_sorted(leaf.unsorted_data)) {
+				std::ranges::sort(leaf.unsorted_data);
+			}
+			total += static_cast<uint32_t>(leaf.unsorted_data.size());
+		}
+
+		write_magic(of, "WORD");
+		write_u32(of, 1);
+		write_u32(of, static_cast<uint32_t>(words.size()));
+		write_u32(of, total);
+
+		uint32_t offset = 0;
+		for (const auto & word: words | std::views::keys) {
+			write_u32(of, offset);
+			offset += static_cast<uint32_t>(word.size());
+		}
+		write_u32(of, offset);
+
+		uint32_t first = 0;
+		for (const auto & leaf: words | std::views::values) {
+			write_u32(of, first);
+			first += static_cast<uint32_t>(leaf.unsorted_data.size());
+		}
+		write_u32(of, first);
 
-		auto sizes = leaves | ngram_and_size | std::ranges::to<std::vector>();
-		std::ranges::sort(sizes);
+		for (const auto & leaf: words | std::views::values) {
+			write_u32(of, static_cast<uint32_t>(leaf.document_frequency()));
+		}
 
-		bool first = true;
-		of << "{";
-		for (auto [size, ngram]: sizes | std::ranges::views::take(sizes.size() / 20)) { // top 5%
-			if (first) first = false;
-			else
-				of << ",";
+		for (const auto & leaf: words | std::views::values) {
+			for (const occurence_t occ: leaf.unsorted_data) {
+				write_u32(of, occ.id);
+				write_u32(of, occ.position.n);
+			}
+		}
 
-			of << std::quoted(ngram.get_hexdec()) << ":" << size;
+		for (const auto & word: words | std::views::keys) {
+			of.write(word.data(), static_cast<std::streamsize>(word.size()));
 		}
-		of << "}";
 	}
 
-	void save_into(const std::filesystem::path & prefix) {
-		auto ec = std::error_code{};
-		std::filesystem::create_directories(prefix, ec);
+	// from word index, postings must be sorted already (by `save_words`)
+	void save_completions(const std::filesystem::path & name) const {
+		std::vector<completion_term_t> terms;
+		terms.reserve(words.size());
+
+		for (const auto & [word, leaf]: words) {
+			terms.push_back(completion_term_t{.term = word, .score = static_cast<uint32_t>(leaf.document_frequency())});
+		}
 
-		save_documents_list(prefix / "urls.json");
+		save_completions_file(name, std::move(terms));
+	}
+
+	auto ngrams() const -> std::vector<ngram_type> {
+		return leaves | std::views::keys | std::ranges::to<std::vector>();
+	}
+
+	void save_outliers(const std::filesystem::path & name, const std::vector<dictionary_entry_t> & sizes) const {
+		save_outliers_file<N>(name, ngrams(), sizes);
+	}
+
+	void save_offenders(const std::filesystem::path & name, const std::vector<dictionary_entry_t> & sizes) const {
+		save_offenders_file<N>(name, ngrams(), sizes);
+	}
 
-		const auto target_dir = prefix / "targets";
-		std::filesystem::create_directories(target_dir, ec);
+	void save_dictionary(const std::filesystem::path & name, const std::vector<dictionary_entry_t> & sizes) const {
+		// std::map is sorted by ngram already
+		save_dictionary_file<N>(name, ngrams(), sizes);
+	}
 
-		save_documents_targets(target_dir);
+	// see pack_writer
+	auto save_packs(const std::filesystem::path & prefix) -> std::vector<dictionary_entry_t> {
+		std::vector<dictionary_entry_t> sizes;
+		sizes.reserve(leaves.size());
 
+		auto packs = pack_writer{prefix};
+
+		for (auto & [ngram, leaf]: leaves) {
+			std::ostream * of = packs.next(ngram[0]);
+
+			if (of == nullptr) {
+				return {};
+			}
+
+			const auto start = of->tellp();
+			leaf.write_to(*of);
+			const auto bytes = static_cast<size_t>(of->tellp() - start);
+			packs.written(bytes);
+
+			sizes.push_back(dictionary_entry_t{.postings = static_cast<uint32_t>(leaf.unsorted_data.size()), .bytes = static_cast<uint32_t>(bytes), .documents = static_cast<uint32_t>(leaf.document_frequency())});
+		}
+
+		packs.finish();
+
+		return sizes;
+	}
+
+	auto save_leaves(const std::filesystem::path & prefix) -> std::vector<dictionary_entry_t> {
 		const auto leaf_dir = prefix / "leaves";
+		auto ec = std::error_code{};
 		std::filesystem::create_directories(leaf_dir, ec);
 
+		std::vector<dictionary_entry_t> sizes;
+		sizes.reserve(leaves.size());
+
 		for (auto & [ngram, leaf]: leaves) {
-			leaf.save_to(ngram, leaf_dir);
+			const size_t bytes = leaf.save_to(ngram, leaf_dir);
+			sizes.push_back(dictionary_entry_t{.postings = static_cast<uint32_t>(leaf.unsorted_data.size()), .bytes = static_cast<uint32_t>(bytes), .documents = static_cast<uint32_t>(leaf.document_frequency())});
 		}
 
-		save_outliers(prefix / "outliers.json");
+		// readers prefer packs when there is a manifest, it can't be a stale one
+		std::filesystem::remove(prefix / "packs.bin", ec);
+
+		return sizes;
+	}
+
+	// leaves (or packs) and their dictionary, only what depends on size of ngrams
+	bool save_ngrams_into(const std::filesystem::path & prefix, leaves_layout layout = leaves_layout::files) {
+		auto ec = std::error_code{};
+		std::filesystem::create_directories(prefix, ec);
+
+		if (layout == leaves_layout::packs) {
+			std::filesystem::create_directories(prefix / "packs", ec);
+		}
+
+		const auto sizes = (layout == leaves_layout::packs) ? save_packs(prefix) : save_leaves(prefix);
+
+		if (sizes.size() != leaves.size()) {
+			std::cerr << "can't save leaves into: " << prefix << "\n";
+			return false;
+		}
+
+		save_dictionary(prefix / "ngrams.bin", sizes);
+		save_outliers(prefix / "outliers.json", sizes);
+		save_offenders(prefix / "offenders.json", sizes);
+
+		return true;
+	}
+
+	void save_into(const std::filesystem::path & prefix, leaves_layout layout = leaves_layout::files) {
+		auto ec = std::error_code{};
+		std::filesystem::create_directories(prefix, ec);
+
+		save_documents_urls(prefix / "urls.bin");
+		save_documents_lengths(prefix / "documents.bin");
+		save_documents_text(prefix / "text.bin");
+		save_documents_targets(prefix / "targets.bin");
+		save_documents_meta(prefix / "meta.bin");
+		save_words(prefix / "words.bin");
+		save_completions(prefix / "completions.bin");
+
+		save_ngrams_into(prefix, layout);
 	}
 };
 
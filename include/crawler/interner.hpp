@@ -0,0 +1,82 @@
+#ifndef CRAWLER_INTERNER_HPP
+#define CRAWLER_INTERNER_HPP
+
+#include <algorithm>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <cassert>
+#include <cstdint>
+
+namespace crawler {
+
+// every distinct string is stored once in big chunks and referred to by its id, views
+// returned by `get` stay valid until the interner is destroyed (chunks are never moved)
+class string_interner {
+	static constexpr size_t chunk_size = 64 * 1024;
+
+	std::vector<std::unique_ptr<char[]>> chunks{};
+	std::vector<std::unique_ptr<char[]>> large{};
+	size_t used{chunk_size}; // of the last chunk
+	std::vector<std::string_view> strings{};
+	std::unordered_map<std::string_view, uint32_t> ids{};
+
+	std::string_view store(std::string_view str) {
+		if (str.empty()) {
+			return {};
+		}
+
+		// longer strings get their own chunk, so they don't waste rest of the current one
+		if (str.size() > chunk_size / 4u) {
+			const auto & chunk = large.emplace_back(std::make_unique_for_overwrite<char[]>(str.size()));
+			std::copy(str.begin(), str.end(), chunk.get());
+			return std::string_view(chunk.get(), str.size());
+		}
+
+		if (chunk_size - used < str.size()) {
+			chunks.emplace_back(std::make_unique_for_overwrite<char[]>(chunk_size));
+			used = 0;
+		}
+
+		char * output = chunks.back().get() + used;
+		std::copy(str.begin(), str.end(), output);
+		used += str.size();
+		return std::string_view(output, str.size());
+	}
+
+public:
+	string_interner() = default;
+	string_interner(string_interner &&) = default;
+	string_interner(const string_interner &) = delete;
+	string_interner & operator=(string_interner &&) = default;
+
+	uint32_t intern(std::string_view str) {
+		if (const auto it = ids.find(str); it != ids.end()) {
+			return it->second;
+		}
+
+		const auto id = static_cast<uint32_t>(strings.size());
+		const auto stored = strings.emplace_back(store(str));
+		ids.emplace(stored, id);
+		return id;
+	}
+
+	std::string_view get(uint32_t id) const noexcept {
+		assert(id < strings.size());
+		return strings[id];
+	}
+
+	size_t size() const noexcept {
+		return strings.size();
+	}
+
+	auto all() const noexcept -> std::span<const std::string_view> {
+		return strings;
+	}
+};
+
+} // namespace crawler
+
+#endif
@@ -0,0 +1,283 @@
+#include "intersection.hpp"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define CRAWLER_HAS_AVX2_KERNEL 1
+#include <immintrin.h>
+#else
+#define CRAWLER_HAS_AVX2_KERNEL 0
+#endif
+
+using crawler::occurence_t;
+
+// (id, position) as one number, so ordering is a single comparison
+static constexpr uint64_t key_of(occurence_t occ) noexcept {
+	return (static_cast<uint64_t>(occ.id) << 32u) | occ.position.n;
+}
+
+static constexpr bool reached(const std::vector<occurence_t> & output, size_t limit) noexcept {
+	return limit != 0 && output.size() >= limit;
+}
+
+static void merge_intersection_into(crawler::occurences_view lhs, crawler::occurences_view rhs, std::vector<occurence_t> & output, size_t limit) {
+	auto l = lhs.begin();
+	auto r = rhs.begin();
+
+	while (l != lhs.end() && r != rhs.end()) {
+		const auto lk = key_of(*l);
+		const auto rk = key_of(*r);
+
+		if (lk == rk) {
+			output.push_back(*l);
+			if (reached(output, limit)) {
+				return;
+			}
+		}
+
+		l += (lk <= rk);
+		r += (rk <= lk);
+	}
+}
+
+// first element in [it, end) which is not smaller than needle (exponential then binary search)
+static auto gallop(crawler::occurences_view::iterator it, crawler::occurences_view::iterator end, uint64_t needle) noexcept {
+	size_t step = 1;
+	auto low = it;
+
+	while (it != end && key_of(*it) < needle) {
+		low = it + 1;
+		if (static_cast<size_t>(end - it) <= step) {
+			it = end;
+			break;
+		}
+		it += static_cast<std::ptrdiff_t>(step);
+		step *= 2u;
+	}
+
+	return std::partition_point(low, it, [needle](occurence_t occ) { return key_of(occ) < needle; });
+}
+
+static void galloping_intersection_into(crawler::occurences_view small, crawler::occurences_view big, std::vector<occurence_t> & output, size_t limit) {
+	auto it = big.begin();
+
+	for (const occurence_t occ: small) {
+		const auto needle = key_of(occ);
+		it = gallop(it, big.end(), needle);
+
+		if (it == big.end()) {
+			return;
+		}
+
+		if (key_of(*it) == needle) {
+			output.push_back(occ);
+			if (reached(output, limit)) {
+				return;
+			}
+		}
+	}
+}
+
+#if CRAWLER_HAS_AVX2_KERNEL
+static_assert(sizeof(occurence_t) == sizeof(uint64_t), "AVX2 kernel compares occurences as 64bit lanes");
+
+// compare 4 occurences from each side all-to-all (equality is bitwise, so memory layout doesn't matter)
+// and then move forward the side which has smaller last element
+__attribute__((target("avx2"))) static void avx2_intersection_into(crawler::occurences_view lhs, crawler::occurences_view rhs, std::vector<occurence_t> & output, size_t limit) {
+	size_t i = 0;
+	size_t j = 0;
+
+	const size_t lhs_blocks = lhs.size() & ~size_t{3};
+	const size_t rhs_blocks = rhs.size() & ~size_t{3};
+
+	while (i < lhs_blocks && j < rhs_blocks) {
+		const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(lhs.data() + i));
+		const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rhs.data() + j));
+
+		const __m256i b1 = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(0, 3, 2, 1));
+		const __m256i b2 = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(1, 0, 3, 2));
+		const __m256i b3 = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(2, 1, 0, 3));
+
+		const __m256i eq = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi64(a, b), _mm256_cmpeq_epi64(a, b1)), _mm256_or_si256(_mm256_cmpeq_epi64(a, b2), _mm256_cmpeq_epi64(a, b3)));
+
+		auto mask = static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(eq)));
+
+		while (mask != 0u) {
+			output.push_back(lhs[i + static_cast<size_t>(std::countr_zero(mask))]);
+			if (reached(output, limit)) {
+				return;
+			}
+			mask &= mask - 1u;
+		}
+
+		const auto a_last = key_of(lhs[i + 3]);
+		const auto b_last = key_of(rhs[j + 3]);
+
+		i += (a_last <= b_last) ? 4u : 0u;
+		j += (b_last <= a_last) ? 4u : 0u;
+	}
+
+	// rest which doesn't fit into a whole block
+	merge_intersection_into(lhs.subspan(i), rhs.subspan(j), output, limit);
+}
+
+static bool cpu_supports_avx2() noexcept {
+	return __builtin_cpu_supports("avx2");
+}
+#else
+static bool cpu_supports_avx2() noexcept {
+	return false;
+}
+#endif
+
+crawler::intersection_kernel crawler::selected_intersection_kernel() noexcept {
+	static const auto kernel = cpu_supports_avx2() ? intersection_kernel::avx2 : intersection_kernel::scalar;
+	return kernel;
+}
+
+std::string_view crawler::kernel_name(intersection_kernel kernel) noexcept {
+	switch (kernel) {
+		case intersection_kernel::avx2: return "avx2";
+		case intersection_kernel::scalar: return "scalar";
+	}
+	return "unknown";
+}
+
+std::vector<occurence_t> crawler::merge_intersection(occurences_view lhs, occurences_view rhs, size_t limit) {
+	std::vector<occurence_t> output;
+	output.reserve(std::min(lhs.size(), rhs.size()));
+	merge_intersection_into(lhs, rhs, output, limit);
+	return output;
+}
+
+std::vector<occurence_t> crawler::simd_intersection(occurences_view lhs, occurences_view rhs, size_t limit) {
+	std::vector<occurence_t> output;
+	output.reserve(std::min(lhs.size(), rhs.size()));
+#if CRAWLER_HAS_AVX2_KERNEL
+	if (selected_intersection_kernel() == intersection_kernel::avx2) {
+		avx2_intersection_into(lhs, rhs, output, limit);
+		return output;
+	}
+#endif
+	merge_intersection_into(lhs, rhs, output, limit);
+	return output;
+}
+
+std::vector<occurence_t> crawler::galloping_intersection(occurences_view lhs, occurences_view rhs, size_t limit) {
+	if (lhs.size() > rhs.size()) {
+		std::swap(lhs, rhs);
+	}
+
+	std::vector<occurence_t> output;
+	output.reserve(lhs.size());
+	galloping_intersection_into(lhs, rhs, output, limit);
+	return output;
+}
+
+static bool prefer_galloping(size_t small, size_t big) noexcept {
+	// in case we are comparing small set with really big set O(n * log m) is better than O(n + m)
+	return small * static_cast<size_t>(std::bit_width(big)) < small + big;
+}
+
+std::vector<occurence_t> crawler::intersection(occurences_view lhs, occurences_view rhs, size_t limit) {
+	if (prefer_galloping(std::min(lhs.size(), rhs.size()), std::max(lhs.size(), rhs.size()))) {
+		return galloping_intersection(lhs, rhs, limit);
+	}
+
+	return simd_intersection(lhs, rhs, limit);
+}
+
+std::vector<occurence_t> crawler::intersection(std::span<const occurences_view> sets, size_t limit) {
+	if (sets.empty()) {
+		return {};
+	}
+
+	auto sorted = std::vector<occurences_view>(sets.begin(), sets.end());
+	std::ranges::sort(sorted, std::less<>{}, &occurences_view::size);
+
+	if (limit == 0) {
+		// smallest first, so every intermediate result is as small as possible
+		auto result = std::vector<occurence_t>(sorted.front().begin(), sorted.front().end());
+		for (const auto & next: sorted | std::views::drop(1)) {
+			if (result.empty()) {
+				break;
+			}
+			result = intersection(result, next, 0);
+		}
+		return result;
+	}
+
+	// with limit we can't cut intermediate results, so candidates from the smallest set are checked against all others
+	auto cursors = std::vector<occurences_view::iterator>{};
+	cursors.reserve(sorted.size());
+	for (const auto & set: sorted) {
+		cursors.push_back(set.begin());
+	}
+
+	std::vector<occurence_t> output;
+
+	for (const occurence_t candidate: sorted.front()) {
+		const auto needle = key_of(candidate);
+		bool found = true;
+
+		for (size_t i = 1; i != sorted.size(); ++i) {
+			cursors[i] = gallop(cursors[i], sorted[i].end(), needle);
+
+			if (cursors[i] == sorted[i].end()) {
+				// nothing bigger is there, so nothing else can match
+				return output;
+			}
+
+			if (key_of(*cursors[i]) != needle) {
+				found = false;
+				break;
+			}
+		}
+
+		if (found) {
+			output.push_back(candidate);
+			if (reached(output, limit)) {
+				break;
+			}
+		}
+	}
+
+	return output;
+}
+
+std::vector<occurence_t> crawler::subtraction(occurences_view lhs, occurences_view rhs) {
+	std::vector<occurence_t> output;
+	output.reserve(lhs.size());
+
+	auto r = rhs.begin();
+
+	if (prefer_galloping(lhs.size(), rhs.size())) {
+		for (const occurence_t occ: lhs) {
+			r = gallop(r, rhs.end(), key_of(occ));
+			if (r == rhs.end() || key_of(*r) != key_of(occ)) {
+				output.push_back(occ);
+			}
+		}
+		return output;
+	}
+
+	auto l = lhs.begin();
+
+	while (l != lhs.end() && r != rhs.end()) {
+		const auto lk = key_of(*l);
+		const auto rk = key_of(*r);
+
+		if (lk < rk) {
+			output.push_back(*l++);
+		} else {
+			l += (lk == rk);
+			++r;
+		}
+	}
+
+	// copy rest of left side
+	output.insert(output.end(), l, lhs.end());
+
+	return output;
+}
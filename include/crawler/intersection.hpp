@@ -0,0 +1,49 @@
+#ifndef CRAWLER_INTERSECTION_HPP
+#define CRAWLER_INTERSECTION_HPP
+
+#include "index.hpp"
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace crawler {
+
+// all inputs must be sorted by (id, position) and unique, the same way `leaf_t::save_to` writes them
+// `limit = 0` means no limit (same as `intersection_helper` in web/index.html)
+
+using occurences_view = std::span<const occurence_t>;
+
+enum class intersection_kernel {
+	scalar,
+	avx2
+};
+
+// AVX2 if CPU supports it, otherwise scalar (decided once at runtime)
+intersection_kernel selected_intersection_kernel() noexcept;
+std::string_view kernel_name(intersection_kernel kernel) noexcept;
+
+// reference implementation, walks both sides
+std::vector<occurence_t> merge_intersection(occurences_view lhs, occurences_view rhs, size_t limit = 0);
+
+// block-wise 4x4 compare of both sides (falls back to merge_intersection without AVX2)
+std::vector<occurence_t> simd_intersection(occurences_view lhs, occurences_view rhs, size_t limit = 0);
+
+// for each element of smaller side do exponential search in bigger one, good for really different sizes
+std::vector<occurence_t> galloping_intersection(occurences_view lhs, occurences_view rhs, size_t limit = 0);
+
+// picks galloping or SIMD merge based on relative sizes
+std::vector<occurence_t> intersection(occurences_view lhs, occurences_view rhs, size_t limit = 0);
+
+// Nothing outside of tests calls these two yet: `find_substring` intersects pairwise while it
+// loads postings (so it can stop before loading the rest) and negated words exclude whole documents
+// by id in `top_k`, not occurences.
+
+// intersection of all sets (smallest first), stops as soon as candidate set is empty or limit is reached
+std::vector<occurence_t> intersection(std::span<const occurences_view> sets, size_t limit = 0);
+
+// everything from lhs which is not in rhs
+std::vector<occurence_t> subtraction(occurences_view lhs, occurences_view rhs);
+
+} // namespace crawler
+
+#endif
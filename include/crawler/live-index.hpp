@@ -0,0 +1,553 @@
+#ifndef CRAWLER_LIVE_INDEX_HPP
+#define CRAWLER_LIVE_INDEX_HPP
+
+#include "document-store.hpp"
+#include "index.hpp"
+#include "reader.hpp"
+#include "segment.hpp"
+#include "target-table.hpp"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+namespace crawler {
+
+// Index which takes new pages while it's searched (LSM style):
+//
+// base      index on disk (with its delta), it's not changed here
+// segments  immutable index_t, each one also in `prefix/live/NUMBER.segment`
+// memtable  index_t where new pages go, it's searchable right away
+//
+// Memtable is frozen into a segment when it's big or old enough, small segments are merged
+// into one by the merge thread. Ids of documents are base, segments and memtable one after
+// another. When a page comes again, its previous version (in any part) is hidden from queries
+// and dropped by the next merge. Segments are loaded back by `open`, pages in memtable are lost
+// when the process ends before it's flushed.
+
+struct live_options_t {
+	size_t flush_documents{1000};							   // memtable is frozen when it has this many documents
+	std::chrono::seconds flush_interval{std::chrono::seconds{10}}; // or when its oldest document is this old
+	size_t merge_segments{4};								   // newest segments are merged when there are more of them
+};
+
+template <size_t N> struct memory_segment {
+	index_t<N> index{};
+	std::filesystem::path file{};
+};
+
+template <size_t N> class live_view;
+
+template <size_t N> class live_index {
+public:
+	using ngram_type = ngram_t<N>;
+	using segment_ptr = std::shared_ptr<memory_segment<N>>;
+
+private:
+	friend class live_view<N>;
+
+	std::filesystem::path directory;
+	live_options_t options;
+	layered_reader<N> base;
+	std::unordered_map<std::string, uint32_t> base_ids{};
+
+	// everything below is guarded by `mutex` (merge thread and writers take it only for short moments)
+	mutable std::shared_mutex mutex{};
+	std::vector<segment_ptr> segments{};
+	std::vector<uint32_t> first_id{}; // of every segment
+	index_t<N> memtable{};
+	uint32_t memtable_first_id{0};
+	std::chrono::steady_clock::time_point memtable_since{};
+	uint64_t next_sequence{0};
+
+	std::unordered_map<std::string, uint32_t> live_ids{}; // newest version of pages of segments and memtable
+	std::vector<uint8_t> dead{};						  // replaced documents (or tombstoned in base)
+	documents_lengths_t lengths{};
+	uint64_t total_length{0};
+
+	// serializes flushes and merges
+	std::mutex maintenance{};
+
+	std::mutex wake_mutex{};
+	std::condition_variable_any wake{};
+	bool flush_requested{false};
+
+	std::jthread merger{}; // last, so it's stopped before anything it uses is destroyed
+
+	live_index(std::filesystem::path prefix, live_options_t opts, layered_reader<N> && reader): directory{prefix / "live"}, options{opts}, base{std::move(reader)} { }
+
+	uint32_t base_documents() const noexcept {
+		return static_cast<uint32_t>(base.lengths.lengths.size());
+	}
+
+	// new document `id` (next one), its previous version is hidden
+	void push_document(std::string_view url, uint32_t id, size_t ngrams) {
+		if (const auto it = live_ids.find(std::string(url)); it != live_ids.end()) {
+			dead[it->second] = 1;
+			it->second = id;
+		} else {
+			if (const auto b = base_ids.find(std::string(url)); b != base_ids.end()) {
+				dead[b->second] = 1;
+			}
+			live_ids.emplace(url, id);
+		}
+
+		dead.push_back(0);
+		lengths.lengths.push_back(static_cast<uint32_t>(ngrams));
+		total_length += ngrams;
+		lengths.average = static_cast<double>(total_length) / static_cast<double>(lengths.lengths.size());
+	}
+
+	// all ids again after segments changed (under unique lock)
+	void rebuild() {
+		const uint32_t base_count = base_documents();
+
+		dead.assign(base_count, 0);
+		for (uint32_t id = 0; id != base_count; ++id) {
+			dead[id] = base.alive(id) ? 0 : 1;
+		}
+
+		lengths = base.lengths;
+		total_length = 0;
+		for (uint32_t length: lengths.lengths) {
+			total_length += length;
+		}
+
+		live_ids.clear();
+		first_id.clear();
+
+		auto id = base_count;
+
+		for (const auto & segment: segments) {
+			first_id.push_back(id);
+			for (const document_info & doc: segment->index.documents) {
+				push_document(doc.url, id++, doc.ngrams);
+			}
+		}
+
+		memtable_first_id = id;
+
+		for (const document_info & doc: memtable.documents) {
+			push_document(doc.url, id++, doc.ngrams);
+		}
+	}
+
+	auto segment_name(uint64_t sequence) const -> std::filesystem::path {
+		auto name = std::to_string(sequence);
+		name.insert(0, (name.size() < 8u) ? 8u - name.size() : 0u, '0');
+		return directory / (name + ".segment");
+	}
+
+	// index which has the document and id of the document in it (under lock)
+	auto locate(uint32_t id) const noexcept -> std::pair<const index_t<N> *, uint32_t> {
+		if (id >= memtable_first_id) {
+			return {&memtable, id - memtable_first_id};
+		}
+
+		const auto it = std::ranges::upper_bound(first_id, id);
+
+		if (it == first_id.begin()) {
+			return {nullptr, 0u};
+		}
+
+		const auto i = static_cast<size_t>(std::distance(first_id.begin(), it) - 1);
+		return {&segments[i]->index, id - *std::prev(it)};
+	}
+
+	void merge_loop(std::stop_token stop) {
+		while (!stop.stop_requested()) {
+			{
+				auto lock = std::unique_lock{wake_mutex};
+				wake.wait_for(lock, stop, options.flush_interval, [&] { return flush_requested; });
+				flush_requested = false;
+			}
+
+			if (stop.stop_requested()) {
+				break;
+			}
+
+			bool old_enough = false;
+			{
+				auto lock = std::shared_lock{mutex};
+				old_enough = !memtable.documents.empty() && (std::chrono::steady_clock::now() - memtable_since) >= options.flush_interval;
+			}
+
+			if (old_enough || memtable_documents() >= options.flush_documents) {
+				flush();
+			}
+
+			merge();
+		}
+	}
+
+public:
+	// base index in `prefix` (as written by build-index) and segments of previous run in `prefix/live`
+	static auto open(const std::filesystem::path & prefix, live_options_t options = {}) -> std::unique_ptr<live_index> {
+		auto reader = layered_reader<N>::open(prefix);
+
+		if (!reader) {
+			return nullptr;
+		}
+
+		auto output = std::unique_ptr<live_index>(new live_index(prefix, options, std::move(*reader)));
+
+		for (uint32_t id = 0; id != output->base_documents(); ++id) {
+			if (auto url = output->base.url(id)) {
+				output->base_ids.insert_or_assign(std::move(*url), id);
+			}
+		}
+
+		auto ec = std::error_code{};
+		std::filesystem::create_directories(output->directory, ec);
+
+		std::vector<std::pair<uint64_t, std::filesystem::path>> files;
+
+		for (const auto & entry: std::filesystem::directory_iterator(output->directory, ec)) {
+			const auto name = entry.path().filename().string();
+			uint64_t sequence = 0;
+
+			if (entry.path().extension() != ".segment" || std::from_chars(name.data(), name.data() + name.size(), sequence).ec != std::errc{}) {
+				continue;
+			}
+
+			files.emplace_back(sequence, entry.path());
+		}
+
+		// order matters, newer versions of pages are in later segments
+		std::ranges::sort(files);
+
+		for (const auto & [sequence, file]: files) {
+			auto segment = std::make_shared<memory_segment<N>>();
+			segment->file = file;
+
+			if (!load_segment(file, segment->index)) {
+				return nullptr;
+			}
+
+			output->segments.push_back(std::move(segment));
+			output->next_sequence = sequence + 1u;
+		}
+
+		output->rebuild();
+		output->merger = std::jthread{[ptr = output.get()](std::stop_token stop) { ptr->merge_loop(stop); }};
+
+		return output;
+	}
+
+	live_index(const live_index &) = delete;
+	live_index & operator=(const live_index &) = delete;
+
+	// tokenizes plain text of the page into memtable, returns its id
+	uint32_t add(std::string_view url, std::string_view text, std::span<const target_hit_t> targets) {
+		// the work is done without the lock, memtable only gets a copy
+		auto single = index_t<N>{};
+		auto & doc = single.insert_document(std::string(url));
+
+		for (const target_hit_t & target: targets) {
+			single.add_target(doc, position_t{target.position}, target.target);
+		}
+		doc.finalize_targets();
+
+		auto builder = ngram_builder_t<N>{};
+		for (char c: text) {
+			if (builder.push(static_cast<char8_t>(c))) {
+				single.insert_ngram(builder, doc);
+			}
+		}
+
+		single.insert_words(text, doc);
+
+		doc.text = compress_text(text);
+
+		const uint32_t zero = 0;
+		uint32_t id = 0;
+		size_t count = 0;
+
+		{
+			auto lock = std::unique_lock{mutex};
+
+			if (memtable.documents.empty()) {
+				memtable_since = std::chrono::steady_clock::now();
+			}
+
+			memtable.append_documents(single, std::span(&zero, 1u));
+			id = static_cast<uint32_t>(lengths.lengths.size());
+			push_document(url, id, doc.ngrams);
+			count = memtable.documents.size();
+		}
+
+		if (count >= options.flush_documents) {
+			{
+				auto lock = std::unique_lock{wake_mutex};
+				flush_requested = true;
+			}
+			wake.notify_one();
+		}
+
+		return id;
+	}
+
+	// freezes memtable into a segment and saves it (false if it can't be written, it's still searched)
+	bool flush() {
+		auto guard = std::unique_lock{maintenance};
+
+		segment_ptr frozen;
+
+		{
+			auto lock = std::unique_lock{mutex};
+
+			if (memtable.documents.empty()) {
+				return true;
+			}
+
+			frozen = std::make_shared<memory_segment<N>>(memory_segment<N>{.index = std::move(memtable), .file = segment_name(next_sequence++)});
+			memtable = index_t<N>{};
+
+			// ids stay the same, memtable is just the last segment now
+			segments.push_back(frozen);
+			first_id.push_back(memtable_first_id);
+			memtable_first_id = static_cast<uint32_t>(lengths.lengths.size());
+		}
+
+		// postings are already sorted (pages were added one after another), so readers aren't disturbed
+		return save_segment(frozen->file, frozen->index);
+	}
+
+	// merges newest segments when there are too many of them (false if it can't be written)
+	bool merge() {
+		auto guard = std::unique_lock{maintenance};
+
+		size_t from = 0;
+		std::vector<segment_ptr> inputs;
+		std::vector<std::vector<uint32_t>> alive;
+
+		{
+			auto lock = std::shared_lock{mutex};
+
+			if (segments.size() <= options.merge_segments) {
+				return true;
+			}
+
+			// newest segments together with older ones of similar size, so sizes grow geometrically
+			// and every document is rewritten only a few times
+			from = segments.size() - 1u;
+			size_t documents = segments[from]->index.documents.size();
+
+			while (from > 0 && (segments[from - 1u]->index.documents.size() <= 2u * documents || segments.size() - from < 2u)) {
+				--from;
+				documents += segments[from]->index.documents.size();
+			}
+
+			inputs.assign(segments.begin() + static_cast<std::ptrdiff_t>(from), segments.end());
+
+			for (size_t i = 0; i != inputs.size(); ++i) {
+				auto & ids = alive.emplace_back();
+				for (uint32_t local = 0; local != inputs[i]->index.documents.size(); ++local) {
+					if (!dead[first_id[from + i] + local]) {
+						ids.push_back(local);
+					}
+				}
+			}
+		}
+
+		// pages replaced while we are merging are found again by `rebuild`
+		auto merged = std::make_shared<memory_segment<N>>();
+		merged->file = inputs.back()->file;
+
+		for (size_t i = 0; i != inputs.size(); ++i) {
+			merged->index.append_documents(inputs[i]->index, alive[i]);
+		}
+
+		// it takes place of the last input, so newer segments are still after it when loaded again
+		if (!save_segment(merged->file, merged->index)) {
+			return false;
+		}
+
+		{
+			auto lock = std::unique_lock{mutex};
+
+			// only flush adds segments, and it's not running now
+			segments.erase(segments.begin() + static_cast<std::ptrdiff_t>(from), segments.end());
+			segments.push_back(std::move(merged));
+			rebuild();
+		}
+
+		auto ec = std::error_code{};
+		for (const auto & input: inputs | std::views::take(inputs.size() - 1u)) {
+			std::filesystem::remove(input->file, ec);
+		}
+
+		return true;
+	}
+
+	// queries hold shared lock of the index for their whole duration
+	auto view() const -> live_view<N> {
+		return live_view<N>{*this};
+	}
+
+	size_t segments_count() const {
+		auto lock = std::shared_lock{mutex};
+		return segments.size();
+	}
+
+	size_t memtable_documents() const {
+		auto lock = std::shared_lock{mutex};
+		return memtable.documents.size();
+	}
+
+	size_t documents() const {
+		auto lock = std::shared_lock{mutex};
+		return lengths.lengths.size();
+	}
+};
+
+// everything the query side needs (see crawler/search.hpp) over all parts of `live_index`
+template <size_t N> class live_view {
+	friend class live_index<N>;
+
+	const live_index<N> * live;
+	std::shared_lock<std::shared_mutex> lock;
+
+	explicit live_view(const live_index<N> & index): live{&index}, lock{index.mutex}, lengths{index.lengths} { }
+
+	// `Leaves` is `&index_t<N>::leaves` (key is ngram) or `&index_t<N>::words` (key is word)
+	template <auto Leaves, typename Key, typename Callback> void each_part(const Key & key, Callback && callback) const {
+		for (size_t i = 0; i != live->segments.size(); ++i) {
+			const auto & leaves = live->segments[i]->index.*Leaves;
+			if (const auto it = leaves.find(key); it != leaves.end()) {
+				callback(it->second, live->first_id[i]);
+			}
+		}
+
+		const auto & leaves = live->memtable.*Leaves;
+		if (const auto it = leaves.find(key); it != leaves.end()) {
+			callback(it->second, live->memtable_first_id);
+		}
+	}
+
+public:
+	using ngram_type = ngram_t<N>;
+	static constexpr size_t ngram_size = N;
+
+	const documents_lengths_t & lengths;
+
+	// counts are only estimates for planning and scoring (hidden documents are included)
+	auto lookup(ngram_type ngram) const noexcept -> std::optional<dictionary_entry_t> {
+		auto result = live->base.lookup(ngram);
+
+		each_part<&index_t<N>::leaves>(ngram, [&](const leaf_t & leaf, uint32_t) {
+			const auto postings = static_cast<uint32_t>(leaf.unsorted_data.size());
+			if (!result) {
+				result = dictionary_entry_t{.postings = 0, .bytes = 0, .documents = 0};
+			}
+			result->postings += postings;
+			result->documents += postings; // upper bound, counting them would be more expensive than the estimate is worth
+		});
+
+		return result;
+	}
+
+	auto postings(ngram_type ngram) const -> std::vector<occurence_t> {
+		auto output = live->base.postings(ngram);
+
+		std::erase_if(output, [&](occurence_t occ) { return live->dead[occ.id] != 0; });
+
+		// parts are in order of ids, and postings of each one are sorted
+		each_part<&index_t<N>::leaves>(ngram, [&](const leaf_t & leaf, uint32_t first) {
+			for (occurence_t occ: leaf.unsorted_data) {
+				if (live->dead[first + occ.id] == 0) {
+					output.push_back(occurence_t{.id = first + occ.id, .position = occ.position});
+				}
+			}
+		});
+
+		return output;
+	}
+
+	// pages added here always have words, but base without word table means ngrams for everything
+	auto word_postings(std::string_view word) const -> std::optional<std::vector<occurence_t>> {
+		if (!live->base.has_words()) {
+			return std::nullopt;
+		}
+
+		auto output = live->base.word_postings(word);
+		std::erase_if(*output, [&](occurence_t occ) { return live->dead[occ.id] != 0; });
+
+		each_part<&index_t<N>::words>(word, [&](const leaf_t & leaf, uint32_t first) {
+			for (occurence_t occ: leaf.unsorted_data) {
+				if (live->dead[first + occ.id] == 0) {
+					output->push_back(occurence_t{.id = first + occ.id, .position = occ.position});
+				}
+			}
+		});
+
+		return output;
+	}
+
+	auto url(uint32_t id) const -> std::optional<std::string> {
+		if (id < live->base_documents()) {
+			return live->base.url(id);
+		}
+
+		const auto [index, local] = live->locate(id);
+
+		if (index == nullptr || local >= index->documents.size()) {
+			return std::nullopt;
+		}
+
+		return index->documents[local].url;
+	}
+
+	auto nearest_target(uint32_t id, uint32_t position) const noexcept -> std::optional<target_hit_t> {
+		if (id < live->base_documents()) {
+			return live->base.nearest_target(id, position);
+		}
+
+		const auto [index, local] = live->locate(id);
+
+		if (index == nullptr || local >= index->documents.size()) {
+			return std::nullopt;
+		}
+
+		// sorted by `finalize_targets` when the page was added
+		const auto & targets = index->documents[local].targets;
+		const auto it = std::ranges::upper_bound(targets, position, {}, [](const link_target & target) { return target.position.n; });
+
+		if (it == targets.begin()) {
+			return std::nullopt;
+		}
+
+		return target_hit_t{.position = std::prev(it)->position.n, .target = index->target_strings.get(std::prev(it)->string)};
+	}
+
+	auto snippet(uint32_t id, uint32_t position, uint32_t length) const -> std::optional<snippet_t> {
+		if (id < live->base_documents()) {
+			return live->base.snippet(id, position, length);
+		}
+
+		const auto [index, local] = live->locate(id);
+
+		if (index == nullptr || local >= index->documents.size()) {
+			return std::nullopt;
+		}
+
+		return snippet_of(index->documents[local].text, position, length);
+	}
+};
+
+} // namespace crawler
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef CRAWLER_MAPPED_FILE_HPP
+#define CRAWLER_MAPPED_FILE_HPP
+
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace crawler {
+
+// read-only mmap of whole file, pages are loaded only when touched
+class mapped_file {
+	const char * ptr{nullptr};
+	size_t length{0};
+
+	constexpr mapped_file(const char * p, size_t l) noexcept: ptr{p}, length{l} { }
+
+public:
+	constexpr mapped_file() noexcept = default;
+	mapped_file(const mapped_file &) = delete;
+	mapped_file & operator=(const mapped_file &) = delete;
+
+	constexpr mapped_file(mapped_file && other) noexcept: ptr{std::exchange(other.ptr, nullptr)}, length{std::exchange(other.length, 0)} { }
+
+	mapped_file & operator=(mapped_file && other) noexcept {
+		std::swap(ptr, other.ptr);
+		std::swap(length, other.length);
+		return *this;
+	}
+
+	~mapped_file() noexcept {
+		if (ptr != nullptr) {
+			munmap(const_cast<char *>(ptr), length);
+		}
+	}
+
+	static auto open(const std::filesystem::path & name) -> std::optional<mapped_file> {
+		const int fd = ::open(name.c_str(), O_RDONLY);
+
+		if (fd < 0) {
+			return std::nullopt;
+		}
+
+		struct stat info {};
+		if (fstat(fd, &info) != 0) {
+			::close(fd);
+			return std::nullopt;
+		}
+
+		const auto size = static_cast<size_t>(info.st_size);
+
+		if (size == 0) {
+			::close(fd);
+			return mapped_file{};
+		}
+
+		void * mem = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd);
+
+		if (mem == MAP_FAILED) {
+			return std::nullopt;
+		}
+
+		return mapped_file{static_cast<const char *>(mem), size};
+	}
+
+	// ask kernel to read everything ahead (used when warming new index)
+	void will_need() const noexcept {
+		if (ptr != nullptr) {
+			madvise(const_cast<char *>(ptr), length, MADV_WILLNEED);
+		}
+	}
+
+	constexpr auto data() const noexcept -> std::span<const char> {
+		return {ptr, length};
+	}
+
+	constexpr size_t size() const noexcept {
+		return length;
+	}
+};
+
+// same for a file which is read without mmap (packs of leaves)
+inline void will_need_file(const std::filesystem::path & name) noexcept {
+	const int fd = ::open(name.c_str(), O_RDONLY);
+
+	if (fd >= 0) {
+		posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+		::close(fd);
+	}
+}
+
+} // namespace crawler
+
+#endif
@@ -0,0 +1,252 @@
+#ifndef CRAWLER_NGRAM_SIZES_HPP
+#define CRAWLER_NGRAM_SIZES_HPP
+
+#include "binary.hpp"
+#include "document-store.hpp"
+#include "index.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <cassert>
+#include <cstdint>
+
+namespace crawler {
+
+// Index can have ngrams of several sizes (`build-index --ngram=2,3,4`). Everything working with
+// ngrams has their size fixed at compile time (index_t<N>, readers, planner), so every supported
+// size is its own instantiation and size of the index picks one of them at runtime.
+//
+// First size is the main one: it's in the index directory with documents, words and everything
+// else. Other sizes have only their ngrams (dictionary with leaves or packs) in `ngrams-<N>/`,
+// they are made from text of documents after crawl. Query side searches every word by ngrams
+// of size which needs fewest postings: bigrams find 2 character words, 4-grams are rarer, so
+// long words read less of them.
+//
+// manifest ngram-sizes.bin: "SIZE" u32(version) u32(count) [u32(N) u32(ngrams) u64(postings)]*count (main one first)
+
+static constexpr std::array<size_t, 3> supported_ngram_sizes = {2, 3, 4};
+
+constexpr bool is_supported_ngram_size(size_t n) noexcept {
+	return std::ranges::find(supported_ngram_sizes, n) != supported_ngram_sizes.end();
+}
+
+// calls `f(std::integral_constant<size_t, N>{})` for every supported size
+template <typename F> constexpr void for_each_ngram_size(F && f) {
+	f(std::integral_constant<size_t, 2>{});
+	f(std::integral_constant<size_t, 3>{});
+	f(std::integral_constant<size_t, 4>{});
+}
+
+// `f(std::integral_constant<size_t, N>{})` with N of the size (it must be a supported one)
+template <typename F> decltype(auto) with_ngram_size(size_t n, F && f) {
+	switch (n) {
+	case 2: return f(std::integral_constant<size_t, 2>{});
+	case 4: return f(std::integral_constant<size_t, 4>{});
+	default: assert(n == 3); return f(std::integral_constant<size_t, 3>{});
+	}
+}
+
+// "2,3,4" (first one is the main one), std::nullopt if some of them is not supported
+inline auto parse_ngram_sizes(std::string_view list) -> std::optional<std::vector<size_t>> {
+	std::vector<size_t> output;
+
+	while (!list.empty()) {
+		const auto item = list.substr(0, list.find(','));
+		list.remove_prefix(std::min(list.size(), item.size() + 1u));
+
+		size_t n = 0;
+		if (std::from_chars(item.data(), item.data() + item.size(), n).ec != std::errc{} || !is_supported_ngram_size(n)) {
+			return std::nullopt;
+		}
+
+		if (std::ranges::find(output, n) == output.end()) {
+			output.push_back(n);
+		}
+	}
+
+	if (output.empty()) {
+		return std::nullopt;
+	}
+
+	return output;
+}
+
+inline auto ngram_size_directory(const std::filesystem::path & prefix, size_t n) -> std::filesystem::path {
+	return prefix / ("ngrams-" + std::to_string(n));
+}
+
+// size of ngrams in a dictionary (ngrams.bin) without loading all of it
+inline auto dictionary_ngram_size(const std::filesystem::path & name) -> std::optional<size_t> {
+	const auto header = read_file_range(name, 0, 12);
+
+	if (!header) {
+		std::cerr << "can't open file: " << name << "\n";
+		return std::nullopt;
+	}
+
+	auto in = binary_reader{*header};
+
+	if (!in.expect_magic("NGRM") || in.read_u32() != dictionary_version) {
+		std::cerr << "unsupported dictionary: " << name << "\n";
+		return std::nullopt;
+	}
+
+	const uint32_t n = in.read_u32();
+
+	if (in.failed || !is_supported_ngram_size(n)) {
+		std::cerr << "unsupported size of ngrams (" << n << "): " << name << "\n";
+		return std::nullopt;
+	}
+
+	return n;
+}
+
+struct ngram_size_info_t {
+	uint32_t size;
+	uint32_t ngrams;
+	uint64_t postings;
+};
+
+inline void save_ngram_sizes(const std::filesystem::path & name, std::span<const ngram_size_info_t> sizes) {
+	auto of = std::ofstream{name, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc};
+
+	if (!of) {
+		std::cerr << "can't open file: " << name << "\n";
+		return;
+	}
+
+	write_magic(of, "SIZE");
+	write_u32(of, 1);
+	write_u32(of, static_cast<uint32_t>(sizes.size()));
+
+	for (const ngram_size_info_t & info: sizes) {
+		write_u32(of, info.size);
+		write_u32(of, info.ngrams);
+		write_u64(of, info.postings);
+	}
+}
+
+inline auto load_ngram_sizes(const std::filesystem::path & name) -> std::optional<std::vector<ngram_size_info_t>> {
+	const auto content = read_whole_file(name);
+
+	if (!content) {
+		std::cerr << "can't open file: " << name << "\n";
+		return std::nullopt;
+	}
+
+	auto in = binary_reader{*content};
+
+	if (!in.expect_magic("SIZE") || in.read_u32() != 1) {
+		std::cerr << "unsupported ngram sizes: " << name << "\n";
+		return std::nullopt;
+	}
+
+	const uint32_t count = in.read_u32();
+
+	std::vector<ngram_size_info_t> output;
+
+	for (uint32_t i = 0; i != count && !in.failed; ++i) {
+		auto & info = output.emplace_back();
+		info.size = in.read_u32();
+		info.ngrams = in.read_u32();
+		info.postings = in.read_u64();
+	}
+
+	if (in.failed) {
+		std::cerr << "truncated ngram sizes: " << name << "\n";
+		return std::nullopt;
+	}
+
+	return output;
+}
+
+// sizes of ngrams of the index in `prefix` (main one first), an index without manifest has only one
+inline auto ngram_sizes_of(const std::filesystem::path & prefix) -> std::optional<std::vector<size_t>> {
+	if (std::filesystem::exists(prefix / "ngram-sizes.bin")) {
+		return load_ngram_sizes(prefix / "ngram-sizes.bin").transform([](const std::vector<ngram_size_info_t> & sizes) {
+			return sizes | std::views::transform([](const ngram_size_info_t & info) { return size_t{info.size}; }) | std::ranges::to<std::vector>();
+		});
+	}
+
+	return dictionary_ngram_size(prefix / "ngrams.bin").transform([](size_t n) { return std::vector<size_t>{n}; });
+}
+
+template <size_t N> auto ngram_size_info(const index_t<N> & index) -> ngram_size_info_t {
+	const uint64_t postings = std::accumulate(index.leaves.begin(), index.leaves.end(), uint64_t{0}, [](uint64_t sum, const auto & item) { return sum + item.second.unsorted_data.size(); });
+	return ngram_size_info_t{.size = static_cast<uint32_t>(N), .ngrams = static_cast<uint32_t>(index.leaves.size()), .postings = postings};
+}
+
+// ngrams of size M of all documents of the index (from their kept text), with same ids
+template <size_t M, size_t N> auto ngrams_of_size(const index_t<N> & index) -> index_t<M> {
+	index_t<M> output{};
+	output.documents.reserve(index.documents.size());
+
+	for (const document_info & source: index.documents) {
+		auto & doc = output.insert_document(source.url);
+		const auto text = extract_text(source.text, 0, source.text.size);
+
+		if (!text) {
+			continue;
+		}
+
+		auto builder = ngram_builder_t<M>{};
+
+		for (char c: *text) {
+			if (builder.push(static_cast<char8_t>(c))) {
+				output.insert_ngram(builder, doc);
+			}
+		}
+	}
+
+	return output;
+}
+
+// ngrams of other sizes than N into their directories and manifest of all of them, directories
+// of sizes which are not in `sizes` anymore are removed (`sizes` starts with N, `main` is what
+// was saved for N, index-merge doesn't have its leaves in memory)
+template <size_t N> void save_other_ngram_sizes(const index_t<N> & index, ngram_size_info_t main, std::span<const size_t> sizes, const std::filesystem::path & prefix, leaves_layout layout) {
+	assert(!sizes.empty() && sizes.front() == N && main.size == N);
+
+	std::vector<ngram_size_info_t> infos{main};
+
+	for_each_ngram_size([&](auto m) {
+		constexpr size_t M = decltype(m)::value;
+
+		if constexpr (M != N) {
+			const auto directory = ngram_size_directory(prefix, M);
+			auto ec = std::error_code{};
+			std::filesystem::remove_all(directory, ec);
+
+			if (std::ranges::find(sizes, M) == sizes.end()) {
+				return;
+			}
+
+			auto other = ngrams_of_size<M>(index);
+
+			if (other.save_ngrams_into(directory, layout)) {
+				infos.push_back(ngram_size_info(other));
+				std::cout << "ngrams of size " << M << " = " << other.leaves.size() << "\n";
+			}
+		}
+	});
+
+	// in order as they were asked for
+	std::ranges::sort(infos.begin() + 1, infos.end(), std::less<>{}, [&](const ngram_size_info_t & info) { return std::ranges::find(sizes, info.size) - sizes.begin(); });
+
+	save_ngram_sizes(prefix / "ngram-sizes.bin", infos);
+}
+
+} // namespace crawler
+
+#endif
@@ -0,0 +1,164 @@
+#include "page-meta.hpp"
+#include "binary.hpp"
+#include "mapped-file.hpp"
+#include "varint.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+void crawler::save_page_meta(const std::filesystem::path & name, std::span<const page_meta_t> pages) {
+	auto of = std::ofstream{name, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc};
+
+	if (!of) {
+		std::cerr << "can't open file: " << name << "\n";
+		return;
+	}
+
+	write_magic(of, "META");
+	write_u32(of, 2);
+	write_u32(of, static_cast<uint32_t>(pages.size()));
+
+	std::string buffer;
+
+	for (const page_meta_t & page: pages) {
+		for (std::string_view str: {std::string_view(page.url), std::string_view(page.etag), std::string_view(page.last_modified)}) {
+			write_varint(buffer, str.size());
+			buffer.append(str);
+		}
+		of.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+		write_u64(of, page.content_hash);
+		buffer.clear();
+
+		write_varint(buffer, page.links.size());
+		for (const std::string & link: page.links) {
+			write_varint(buffer, link.size());
+			buffer.append(link);
+		}
+		of.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+		buffer.clear();
+	}
+}
+
+auto crawler::load_page_meta(const std::filesystem::path & name) -> std::optional<std::vector<page_meta_t>> {
+	const auto file = mapped_file::open(name);
+
+	if (!file) {
+		std::cerr << "can't open file: " << name << "\n";
+		return std::nullopt;
+	}
+
+	auto in = binary_reader{file->data()};
+
+	if (!in.expect_magic("META")) {
+		std::cerr << "unsupported page metadata: " << name << "\n";
+		return std::nullopt;
+	}
+
+	const uint32_t version = in.read_u32();
+
+	if (version != 1u && version != 2u) {
+		std::cerr << "unsupported page metadata: " << name << "\n";
+		return std::nullopt;
+	}
+
+	const uint32_t count = in.read_u32();
+
+	std::vector<page_meta_t> output;
+	output.reserve(count);
+
+	const auto read_length = [&]() -> size_t {
+		auto rest = std::string_view(file->data().data() + in.offset, file->size() - in.offset);
+		const auto length = read_varint(rest);
+		in.seek(file->size() - rest.size());
+		if (!length || *length > rest.size()) {
+			in.failed = true;
+			return 0u;
+		}
+		return static_cast<size_t>(*length);
+	};
+
+	const auto read_string = [&](std::string & out) {
+		const size_t length = read_length();
+		if (!in.failed) {
+			out = std::string(in.read_bytes(length));
+		}
+	};
+
+	for (uint32_t i = 0; i != count && !in.failed; ++i) {
+		auto & page = output.emplace_back();
+		read_string(page.url);
+		read_string(page.etag);
+		read_string(page.last_modified);
+		page.content_hash = in.read_u64();
+
+		if (version == 2u) {
+			// every link takes at least one byte, bigger count is a broken file
+			const size_t links = read_length();
+			page.links.resize(links);
+			for (std::string & link: page.links) {
+				read_string(link);
+			}
+		}
+	}
+
+	if (in.failed) {
+		std::cerr << "truncated page metadata: " << name << "\n";
+		return std::nullopt;
+	}
+
+	return output;
+}
+
+bool crawler::tombstones_t::contains(uint32_t id) const noexcept {
+	return std::ranges::binary_search(ids, id);
+}
+
+void crawler::save_tombstones(const std::filesystem::path & name, const tombstones_t & tombstones) {
+	auto of = std::ofstream{name, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc};
+
+	if (!of) {
+		std::cerr << "can't open file: " << name << "\n";
+		return;
+	}
+
+	write_magic(of, "TOMB");
+	write_u32(of, 1);
+	write_u32(of, tombstones.base_documents);
+	write_u32(of, static_cast<uint32_t>(tombstones.ids.size()));
+
+	for (uint32_t id: tombstones.ids) {
+		write_u32(of, id);
+	}
+}
+
+auto crawler::load_tombstones(const std::filesystem::path & name) -> std::optional<tombstones_t> {
+	const auto content = read_whole_file(name);
+
+	if (!content) {
+		std::cerr << "can't open file: " << name << "\n";
+		return std::nullopt;
+	}
+
+	auto in = binary_reader{*content};
+
+	if (!in.expect_magic("TOMB") || in.read_u32() != 1) {
+		std::cerr << "unsupported tombstones: " << name << "\n";
+		return std::nullopt;
+	}
+
+	tombstones_t output{};
+	output.base_documents = in.read_u32();
+	const uint32_t count = in.read_u32();
+
+	output.ids.reserve(count);
+	for (uint32_t i = 0; i != count && !in.failed; ++i) {
+		output.ids.push_back(in.read_u32());
+	}
+
+	if (in.failed || !std::ranges::is_sorted(output.ids)) {
+		std::cerr << "broken tombstones: " << name << "\n";
+		return std::nullopt;
+	}
+
+	return output;
+}
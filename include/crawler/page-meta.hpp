@@ -0,0 +1,57 @@
+#ifndef CRAWLER_PAGE_META_HPP
+#define CRAWLER_PAGE_META_HPP
+
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace crawler {
+
+// What we know about a downloaded page, so next crawl can ask only for changes
+// (If-None-Match / If-Modified-Since) and recognize unchanged body without tokenizing it.
+
+struct page_meta_t {
+	std::string url{};
+	std::string etag{};
+	std::string last_modified{};
+	uint64_t content_hash{0};
+	// outgoing links which were followed, unchanged page isn't parsed again so they are taken from here
+	std::vector<std::string> links{};
+};
+
+// FNV-1a of the downloaded body
+constexpr uint64_t content_hash(std::string_view content) noexcept {
+	uint64_t hash = 0xcbf29ce484222325u;
+	for (char c: content) {
+		hash ^= static_cast<unsigned char>(c);
+		hash *= 0x100000001b3u;
+	}
+	return hash;
+}
+
+// meta.bin, one record per document (in order of ids):
+// "META" u32(version) u32(count) [varint(length) url varint(length) etag varint(length) last-modified u64(hash)
+//                                  varint(link count) [varint(length) link]*]*count
+// version 1 has no links
+void save_page_meta(const std::filesystem::path & name, std::span<const page_meta_t> pages);
+auto load_page_meta(const std::filesystem::path & name) -> std::optional<std::vector<page_meta_t>>;
+
+// tombstones.bin of a delta, ids of base documents which were replaced or removed:
+// "TOMB" u32(version) u32(base document count) u32(count) u32(id)[count] (sorted)
+struct tombstones_t {
+	uint32_t base_documents{0};
+	std::vector<uint32_t> ids{};
+
+	bool contains(uint32_t id) const noexcept;
+};
+
+void save_tombstones(const std::filesystem::path & name, const tombstones_t & tombstones);
+auto load_tombstones(const std::filesystem::path & name) -> std::optional<tombstones_t>;
+
+} // namespace crawler
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef CRAWLER_PLANNER_HPP
+#define CRAWLER_PLANNER_HPP
+
+#include "index.hpp"
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace crawler {
+
+template <size_t N> struct planned_ngram_t {
+	ngram_t<N> ngram;
+	uint32_t offset;
+	uint64_t cost;
+};
+
+template <size_t N> auto ngrams_of(std::string_view word) -> std::vector<ngram_t<N>> {
+	std::vector<ngram_t<N>> output;
+	auto builder = ngram_builder_t<N>{};
+
+	for (char c: word) {
+		if (builder.push(static_cast<char8_t>(c))) {
+			output.push_back(builder.ngram());
+		}
+	}
+
+	return output;
+}
+
+// Picks cheapest set of ngrams which together cover every character of the word,
+// so matching all of them at aligned positions means the whole word matches.
+// Ngram at offset `i` covers characters [i, i + N), chosen offsets must start at 0,
+// end at the last ngram and never leave a gap bigger than N (exact, O(len * N)).
+// `cost_of(ngram)` returns std::nullopt when the ngram is not in the index, which
+// means the word can't be found at all and there is nothing to plan.
+template <size_t N> auto plan_word(std::string_view word, auto && cost_of) -> std::optional<std::vector<planned_ngram_t<N>>> {
+	const auto ngrams = ngrams_of<N>(word);
+
+	if (ngrams.empty()) {
+		return std::vector<planned_ngram_t<N>>{};
+	}
+
+	std::vector<uint64_t> costs;
+	costs.reserve(ngrams.size());
+
+	for (const auto & ngram: ngrams) {
+		const std::optional<uint64_t> cost = cost_of(ngram);
+		if (!cost) {
+			return std::nullopt;
+		}
+		costs.push_back(*cost);
+	}
+
+	constexpr auto infinity = std::numeric_limits<uint64_t>::max();
+
+	// best[i] = cheapest cover of characters [0, i + N) which uses ngram at offset i
+	std::vector<uint64_t> best(ngrams.size(), infinity);
+	std::vector<size_t> previous(ngrams.size(), 0);
+
+	best[0] = costs[0];
+
+	for (size_t i = 1; i != ngrams.size(); ++i) {
+		const size_t first = (i > N) ? (i - N) : 0;
+		for (size_t j = first; j != i; ++j) {
+			if (best[j] != infinity && best[j] + costs[i] < best[i]) {
+				best[i] = best[j] + costs[i];
+				previous[i] = j;
+			}
+		}
+	}
+
+	std::vector<planned_ngram_t<N>> output;
+
+	for (size_t i = ngrams.size() - 1;; i = previous[i]) {
+		output.push_back(planned_ngram_t<N>{.ngram = ngrams[i], .offset = static_cast<uint32_t>(i), .cost = costs[i]});
+		if (i == 0) {
+			break;
+		}
+	}
+
+	// smallest first, so intersection can stop early (stable, same order as plan_ngrams in web/index.html)
+	std::ranges::stable_sort(output, std::less<>{}, &planned_ngram_t<N>::cost);
+
+	return output;
+}
+
+} // namespace crawler
+
+#endif
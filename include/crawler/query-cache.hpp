@@ -0,0 +1,278 @@
+#ifndef CRAWLER_QUERY_CACHE_HPP
+#define CRAWLER_QUERY_CACHE_HPP
+
+#include "index.hpp"
+#include "search.hpp"
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+namespace crawler {
+
+// Caches of the query server. Queries are heavily skewed (`vector`, `std::string`, `constexpr`...),
+// so most of them can be answered without reading and parsing leaves again:
+//
+// posting_cache  parsed postings of hot ngrams, bounded by bytes, an ngram gets in only if it's
+//                asked for more often than what it would evict (TinyLFU-like admission)
+// result_cache   final results keyed by normalized query
+//
+// Both belong to one snapshot of the index, so a swapped index starts with empty caches.
+
+struct cache_counters {
+	std::atomic<uint64_t> posting_hits{0};
+	std::atomic<uint64_t> posting_misses{0};
+	std::atomic<uint64_t> posting_rejected{0}; // not admitted into the cache
+	std::atomic<uint64_t> result_hits{0};
+	std::atomic<uint64_t> result_misses{0};
+};
+
+// same query written differently (case, spaces, quotes) gives the same key, order of words
+// is kept (it changes order of hits with same score)
+inline auto normalize_query(std::string_view query) -> std::string {
+	std::string output;
+
+	for (const query_word_t & word: split_to_words(query)) {
+		if (!output.empty()) {
+			output += ' ';
+		}
+		if (word.negative) {
+			output += '-';
+		}
+		if (word.anywhere || word.text.find(' ') != std::string::npos) {
+			output.append("\"").append(word.text).append("\"");
+		} else {
+			output.append(word.text);
+		}
+		if (word.fuzzy) {
+			output += '~';
+		}
+	}
+
+	return output;
+}
+
+template <size_t N> struct ngram_hash {
+	size_t operator()(const ngram_t<N> & ngram) const noexcept {
+		uint64_t hash = 14695981039346656037ull;
+		for (char8_t c: ngram) {
+			hash = (hash ^ c) * 1099511628211ull;
+		}
+		return static_cast<size_t>(hash);
+	}
+};
+
+template <size_t N> class posting_cache {
+	using postings_ptr = std::shared_ptr<const std::vector<occurence_t>>;
+
+	struct entry_t {
+		ngram_t<N> ngram;
+		postings_ptr postings;
+		size_t bytes;
+	};
+
+	std::mutex mutex{};
+	std::list<entry_t> lru{}; // most recent first
+	std::unordered_map<ngram_t<N>, typename std::list<entry_t>::iterator, ngram_hash<N>> entries{};
+	size_t capacity;
+	size_t used{0};
+
+	// approximate recent frequency of asking for each ngram, halved every `sample_size` accesses
+	std::unordered_map<ngram_t<N>, uint32_t, ngram_hash<N>> frequency{};
+	size_t accesses{0};
+	size_t sample_size;
+
+	cache_counters & counters;
+
+	static size_t bytes_of(const std::vector<occurence_t> & postings) noexcept {
+		return postings.size() * sizeof(occurence_t) + sizeof(entry_t) + 64u; // with bookkeeping
+	}
+
+	uint32_t frequency_of(const ngram_t<N> & ngram) const noexcept {
+		const auto it = frequency.find(ngram);
+		return (it != frequency.end()) ? it->second : 0u;
+	}
+
+	void record_access(const ngram_t<N> & ngram) {
+		++frequency[ngram];
+
+		if (++accesses < sample_size) {
+			return;
+		}
+
+		// old popularity fades out
+		accesses = 0;
+		for (auto it = frequency.begin(); it != frequency.end();) {
+			it->second /= 2u;
+			it = (it->second == 0u) ? frequency.erase(it) : std::next(it);
+		}
+	}
+
+public:
+	explicit posting_cache(size_t capacity_bytes, cache_counters & c) noexcept: capacity{capacity_bytes}, sample_size{std::max<size_t>(1024u, capacity_bytes / 1024u)}, counters{c} { }
+
+	posting_cache(const posting_cache &) = delete;
+	posting_cache & operator=(const posting_cache &) = delete;
+
+	auto find(const ngram_t<N> & ngram) -> postings_ptr {
+		auto lock = std::unique_lock{mutex};
+
+		record_access(ngram);
+
+		const auto it = entries.find(ngram);
+
+		if (it == entries.end()) {
+			counters.posting_misses.fetch_add(1u, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		counters.posting_hits.fetch_add(1u, std::memory_order_relaxed);
+		lru.splice(lru.begin(), lru, it->second);
+		return it->second->postings;
+	}
+
+	// copy of `postings` is kept only when the ngram is wanted more than those it would push out
+	void insert(const ngram_t<N> & ngram, const std::vector<occurence_t> & postings) {
+		const size_t bytes = bytes_of(postings);
+
+		auto lock = std::unique_lock{mutex};
+
+		if (bytes > capacity || entries.contains(ngram)) {
+			return;
+		}
+
+		const uint32_t wanted = frequency_of(ngram);
+
+		// victims are checked first, nothing is evicted for a rejected ngram
+		size_t freed = 0;
+		auto victim = lru.end();
+
+		while (used - freed + bytes > capacity && victim != lru.begin()) {
+			--victim;
+			if (frequency_of(victim->ngram) >= wanted) {
+				counters.posting_rejected.fetch_add(1u, std::memory_order_relaxed);
+				return;
+			}
+			freed += victim->bytes;
+		}
+
+		for (auto it = victim; it != lru.end(); ++it) {
+			entries.erase(it->ngram);
+		}
+		lru.erase(victim, lru.end());
+		used -= freed;
+
+		lru.push_front(entry_t{.ngram = ngram, .postings = std::make_shared<const std::vector<occurence_t>>(postings), .bytes = bytes});
+		entries.emplace(ngram, lru.begin());
+		used += bytes;
+	}
+
+	size_t size_in_bytes() {
+		auto lock = std::unique_lock{mutex};
+		return used;
+	}
+};
+
+// least recently used results, `limit` entries at most
+template <typename T> class result_cache {
+	struct entry_t {
+		std::string key;
+		std::shared_ptr<const T> value;
+	};
+
+	std::mutex mutex{};
+	std::list<entry_t> lru{};
+	std::unordered_map<std::string_view, typename std::list<entry_t>::iterator> entries{}; // keys point into `lru`
+	size_t limit;
+	cache_counters & counters;
+
+public:
+	explicit result_cache(size_t max_entries, cache_counters & c) noexcept: limit{max_entries}, counters{c} { }
+
+	result_cache(const result_cache &) = delete;
+	result_cache & operator=(const result_cache &) = delete;
+
+	auto find(std::string_view key) -> std::shared_ptr<const T> {
+		auto lock = std::unique_lock{mutex};
+
+		const auto it = entries.find(key);
+
+		if (it == entries.end()) {
+			counters.result_misses.fetch_add(1u, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		counters.result_hits.fetch_add(1u, std::memory_order_relaxed);
+		lru.splice(lru.begin(), lru, it->second);
+		return it->second->value;
+	}
+
+	void insert(std::string key, std::shared_ptr<const T> value) {
+		auto lock = std::unique_lock{mutex};
+
+		if (limit == 0 || entries.contains(key)) {
+			return;
+		}
+
+		if (entries.size() >= limit) {
+			entries.erase(lru.back().key);
+			lru.pop_back();
+		}
+
+		lru.push_front(entry_t{.key = std::move(key), .value = std::move(value)});
+		entries.emplace(lru.front().key, lru.begin());
+	}
+};
+
+// index which takes parsed postings from the cache (and puts them there)
+template <typename Index> class cached_reader {
+	const Index & index;
+	posting_cache<Index::ngram_size> & cache;
+
+public:
+	using ngram_type = typename Index::ngram_type;
+	static constexpr size_t ngram_size = Index::ngram_size;
+
+	const decltype(Index::lengths) & lengths;
+
+	cached_reader(const Index & i, posting_cache<ngram_size> & c) noexcept: index{i}, cache{c}, lengths{i.lengths} { }
+
+	auto lookup(ngram_type ngram) const noexcept -> std::optional<dictionary_entry_t> {
+		return index.lookup(ngram);
+	}
+
+	// a copy, query side changes them
+	auto postings(ngram_type ngram) const -> std::vector<occurence_t> {
+		if (const auto cached = cache.find(ngram)) {
+			return *cached;
+		}
+
+		auto output = index.postings(ngram);
+		cache.insert(ngram, output);
+		return output;
+	}
+
+	// whole words are read straight from the mapped word table, there is nothing to parse
+	auto word_postings(std::string_view word) const -> std::optional<std::vector<occurence_t>>
+		requires requires(const Index & i) { i.word_postings(word); }
+	{
+		return index.word_postings(word);
+	}
+
+	// ngrams of other sizes are not cached, they are used only for words where they are cheaper
+	template <size_t M> auto with_size() const
+		requires requires(const Index & i) { i.template with_size<M>(); }
+	{
+		return index.template with_size<M>();
+	}
+};
+
+} // namespace crawler
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef CRAWLER_RANKING_HPP
+#define CRAWLER_RANKING_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <span>
+#include <vector>
+#include <cstdint>
+
+namespace crawler {
+
+struct document_hit_t {
+	uint32_t id;
+	uint32_t count;
+	double score;
+	// first occurence of the first query term (for snippets)
+	uint32_t position{0};
+	uint32_t length{0};
+};
+
+// one document in term's postings (tf = how many times the term is there)
+struct scored_posting_t {
+	uint32_t id;
+	uint32_t tf;
+	uint32_t first_position{0};
+	double weight{1.0}; // less than 1 for documents which have only something similar (typo tolerant search)
+};
+
+// postings of one query term
+struct term_postings_t {
+	std::vector<scored_posting_t> postings{};
+	double idf{0.0};
+	uint32_t length{0}; // of the term in bytes
+};
+
+struct bm25_scorer {
+	double k1{1.2};
+	double b{0.75};
+	size_t documents{0};
+	double average_length{1.0};
+	std::span<const uint32_t> lengths{};
+
+	double idf(size_t document_frequency) const noexcept {
+		const auto n = static_cast<double>(documents);
+		const auto df = static_cast<double>(document_frequency);
+		return std::log(1.0 + (n - df + 0.5) / (df + 0.5));
+	}
+
+	double score(double idf_value, uint32_t tf, uint32_t length) const noexcept {
+		const auto f = static_cast<double>(tf);
+		const auto norm = k1 * (1.0 - b + b * static_cast<double>(length) / std::max(average_length, 1.0));
+		return idf_value * (f * (k1 + 1.0)) / (f + norm);
+	}
+
+	uint32_t length_of(uint32_t id) const noexcept {
+		return (id < lengths.size()) ? lengths[id] : 0u;
+	}
+
+	// idf is from documents which really have the term (postings are one per document)
+	term_postings_t prepare(std::vector<scored_posting_t> postings, uint32_t term_length = 0) const {
+		auto output = term_postings_t{};
+		output.idf = idf(postings.size());
+		output.length = term_length;
+		output.postings = std::move(postings);
+		return output;
+	}
+};
+
+// first posting at or after `cursor` with id >= needle
+inline size_t advance_to(std::span<const scored_posting_t> postings, size_t cursor, uint64_t needle) noexcept {
+	size_t step = 1;
+	size_t low = cursor;
+	size_t high = cursor;
+
+	while (high < postings.size() && postings[high].id < needle) {
+		low = high + 1u;
+		high = std::min(high + step, postings.size());
+		step *= 2u;
+	}
+
+	const auto it = std::partition_point(postings.begin() + static_cast<std::ptrdiff_t>(low), postings.begin() + static_cast<std::ptrdiff_t>(high), [needle](scored_posting_t p) { return p.id < needle; });
+	return static_cast<size_t>(it - postings.begin());
+}
+
+// Best `limit` documents which contain all `terms` and none of `excluded` (sorted ids).
+// A term is a substring assembled from intersection of ngram postings (or similar words), so its
+// postings are all read and decoded before this anyway: documents are aligned across all terms
+// by galloping from the shortest one, every match is scored and `partial_sort` keeps the best.
+inline auto top_k(std::span<const term_postings_t> terms, std::span<const std::vector<uint32_t>> excluded, const bm25_scorer & scorer, size_t limit) -> std::vector<document_hit_t> {
+	if (terms.empty() || limit == 0) {
+		return {};
+	}
+
+	std::vector<const term_postings_t *> order;
+	order.reserve(terms.size());
+	for (const auto & term: terms) {
+		if (term.postings.empty()) {
+			return {};
+		}
+		order.push_back(&term);
+	}
+
+	// shortest drives the traversal
+	std::ranges::sort(order, std::less<>{}, [](const term_postings_t * t) { return t->postings.size(); });
+
+	// first term in query order gives position for snippet
+	const size_t first_term = static_cast<size_t>(std::ranges::find(order, &terms.front()) - order.begin());
+
+	std::vector<size_t> cursors(order.size(), 0);
+	std::vector<size_t> excluded_cursors(excluded.size(), 0);
+
+	const auto is_excluded = [&](uint32_t id) {
+		for (size_t i = 0; i != excluded.size(); ++i) {
+			auto & c = excluded_cursors[i];
+			const auto & list = excluded[i];
+			c = static_cast<size_t>(std::lower_bound(list.begin() + static_cast<std::ptrdiff_t>(c), list.end(), id) - list.begin());
+			if (c != list.size() && list[c] == id) {
+				return true;
+			}
+		}
+		return false;
+	};
+
+	std::vector<document_hit_t> output;
+
+	for (cursors[0] = 0; cursors[0] != order.front()->postings.size(); ++cursors[0]) {
+		const uint32_t id = order.front()->postings[cursors[0]].id;
+		bool everywhere = true;
+
+		for (size_t i = 1; i != order.size() && everywhere; ++i) {
+			cursors[i] = advance_to(order[i]->postings, cursors[i], id);
+			everywhere = cursors[i] != order[i]->postings.size() && order[i]->postings[cursors[i]].id == id;
+		}
+
+		if (!everywhere || is_excluded(id)) {
+			continue;
+		}
+
+		const auto & first = order[first_term]->postings[cursors[first_term]];
+		auto hit = document_hit_t{.id = id, .count = 0, .score = 0.0, .position = first.first_position, .length = order[first_term]->length};
+		const uint32_t length = scorer.length_of(id);
+
+		for (size_t i = 0; i != order.size(); ++i) {
+			const auto & posting = order[i]->postings[cursors[i]];
+			hit.count += posting.tf;
+			hit.score += scorer.score(order[i]->idf, posting.tf, length) * posting.weight;
+		}
+
+		output.push_back(hit);
+	}
+
+	// same score is ordered by id, so results don't depend on the sort
+	constexpr auto better = [](const document_hit_t & lhs, const document_hit_t & rhs) { return lhs.score > rhs.score || (lhs.score == rhs.score && lhs.id < rhs.id); };
+
+	const size_t kept = std::min(limit, output.size());
+	std::ranges::partial_sort(output, output.begin() + static_cast<std::ptrdiff_t>(kept), better);
+	output.resize(kept);
+
+	return output;
+}
+
+} // namespace crawler
+
+#endif
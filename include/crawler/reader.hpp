@@ -0,0 +1,708 @@
+#ifndef CRAWLER_READER_HPP
+#define CRAWLER_READER_HPP
+
+#include "binary.hpp"
+#include "completion-table.hpp"
+#include "document-store.hpp"
+#include "index.hpp"
+#include "mapped-file.hpp"
+#include "ngram-sizes.hpp"
+#include "page-meta.hpp"
+#include "target-table.hpp"
+#include "url-dictionary.hpp"
+#include "word-table.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace crawler {
+
+// read side of `index_t::save_into`
+
+template <size_t N> struct dictionary_t {
+	using ngram_type = ngram_t<N>;
+
+	struct entry_t {
+		ngram_type ngram;
+		dictionary_entry_t info;
+	};
+
+	std::vector<entry_t> entries{};
+
+	static auto load(const std::filesystem::path & name) -> std::optional<dictionary_t> {
+		const auto content = read_whole_file(name);
+
+		if (!content) {
+			std::cerr << "can't open file: " << name << "\n";
+			return std::nullopt;
+		}
+
+		auto in = binary_reader{*content};
+
+		if (!in.expect_magic("NGRM") || in.read_u32() != dictionary_version || in.read_u32() != N) {
+			std::cerr << "unsupported dictionary: " << name << "\n";
+			return std::nullopt;
+		}
+
+		const uint32_t count = in.read_u32();
+
+		auto output = dictionary_t{};
+		output.entries.reserve(count);
+
+		for (uint32_t i = 0; i != count; ++i) {
+			auto & entry = output.entries.emplace_back();
+			std::ranges::copy(in.read_bytes(N), entry.ngram.begin());
+			entry.info.postings = in.read_u32();
+			entry.info.bytes = in.read_u32();
+			entry.info.documents = in.read_u32();
+		}
+
+		if (in.failed) {
+			std::cerr << "truncated dictionary: " << name << "\n";
+			return std::nullopt;
+		}
+
+		return output;
+	}
+
+	// position of the record in ngrams.bin
+	auto index_of(ngram_type ngram) const noexcept -> std::optional<size_t> {
+		const auto it = std::ranges::lower_bound(entries, ngram, std::less<>{}, &entry_t::ngram);
+
+		if (it == entries.end() || it->ngram != ngram) {
+			return std::nullopt;
+		}
+
+		return static_cast<size_t>(std::distance(entries.begin(), it));
+	}
+
+	auto find(ngram_type ngram) const noexcept -> std::optional<dictionary_entry_t> {
+		if (const auto index = index_of(ngram)) {
+			return entries[*index].info;
+		}
+		return std::nullopt;
+	}
+};
+
+// parses `[[id,position],...]` as written by `leaf_t::save_to`
+inline auto parse_leaf(std::string_view content) -> std::vector<occurence_t> {
+	std::vector<occurence_t> output;
+
+	uint32_t numbers[2] = {0, 0};
+	unsigned index = 0;
+	bool in_number = false;
+
+	for (char c: content) {
+		if (c >= '0' && c <= '9') {
+			numbers[index] = numbers[index] * 10u + static_cast<uint32_t>(c - '0');
+			in_number = true;
+		} else if (in_number) {
+			in_number = false;
+			if (++index == 2) {
+				output.push_back(occurence_t{.id = numbers[0], .position = position_t{numbers[1]}});
+				numbers[0] = 0;
+				numbers[1] = 0;
+				index = 0;
+			}
+		}
+	}
+
+	return output;
+}
+
+struct documents_lengths_t {
+	std::vector<uint32_t> lengths{};
+	double average{0.0};
+
+	static auto load(const std::filesystem::path & name) -> std::optional<documents_lengths_t> {
+		const auto content = read_whole_file(name);
+
+		if (!content) {
+			std::cerr << "can't open file: " << name << "\n";
+			return std::nullopt;
+		}
+
+		auto in = binary_reader{*content};
+
+		if (!in.expect_magic("DOCS") || in.read_u32() != 1) {
+			std::cerr << "unsupported documents file: " << name << "\n";
+			return std::nullopt;
+		}
+
+		const uint32_t count = in.read_u32();
+		const uint64_t total = in.read_u64();
+
+		auto output = documents_lengths_t{};
+		output.lengths.reserve(count);
+
+		for (uint32_t i = 0; i != count; ++i) {
+			output.lengths.push_back(in.read_u32());
+		}
+
+		if (in.failed) {
+			std::cerr << "truncated documents file: " << name << "\n";
+			return std::nullopt;
+		}
+
+		output.average = (count != 0) ? static_cast<double>(total) / static_cast<double>(count) : 0.0;
+
+		return output;
+	}
+};
+
+// packs.bin written by `index_t::save_packs`, with offsets of all leaves resolved from the dictionary
+struct pack_manifest_t {
+	struct location_t {
+		uint32_t pack;
+		uint64_t offset;
+		uint32_t bytes;
+	};
+
+	std::vector<uint32_t> first_ngram{};
+	std::vector<uint64_t> offsets{}; // of each dictionary record inside its pack
+
+	template <size_t N> static auto load(const std::filesystem::path & name, const dictionary_t<N> & dictionary) -> std::optional<pack_manifest_t> {
+		const auto content = read_whole_file(name);
+
+		if (!content) {
+			std::cerr << "can't open file: " << name << "\n";
+			return std::nullopt;
+		}
+
+		auto in = binary_reader{*content};
+
+		if (!in.expect_magic("PACK") || in.read_u32() != 1) {
+			std::cerr << "unsupported pack manifest: " << name << "\n";
+			return std::nullopt;
+		}
+
+		const uint32_t count = in.read_u32();
+
+		if (in.failed || (content->size() - in.offset) / sizeof(uint32_t) < size_t{count} + 1u) {
+			std::cerr << "truncated pack manifest: " << name << "\n";
+			return std::nullopt;
+		}
+
+		auto output = pack_manifest_t{};
+		output.first_ngram.reserve(size_t{count} + 1u);
+
+		for (size_t i = 0; i != size_t{count} + 1u; ++i) {
+			output.first_ngram.push_back(in.read_u32());
+		}
+
+		// packs cover the whole dictionary in order, otherwise offsets wouldn't match entries
+		if (in.failed || output.first_ngram.front() != 0u || !std::ranges::is_sorted(output.first_ngram) || output.first_ngram.back() != dictionary.entries.size()) {
+			std::cerr << "pack manifest doesn't match dictionary: " << name << "\n";
+			return std::nullopt;
+		}
+
+		output.offsets.reserve(dictionary.entries.size());
+
+		for (uint32_t pack = 0; pack != count; ++pack) {
+			uint64_t offset = 0;
+			for (uint32_t i = output.first_ngram[pack]; i != output.first_ngram[pack + 1u]; ++i) {
+				output.offsets.push_back(offset);
+				offset += dictionary.entries[i].info.bytes;
+			}
+		}
+
+		return output;
+	}
+
+	location_t locate(size_t index, uint32_t bytes) const noexcept {
+		const auto it = std::ranges::upper_bound(first_ngram, index);
+		const auto pack = static_cast<uint32_t>(std::distance(first_ngram.begin(), it) - 1);
+		return location_t{.pack = pack, .offset = offsets[index], .bytes = bytes};
+	}
+
+	// leaves in separate files are left to the page cache, there are too many of them
+	void will_need(const std::filesystem::path & prefix) const noexcept {
+		for (size_t pack = 0; pack + 1u < first_ngram.size(); ++pack) {
+			will_need_file(prefix / "packs" / (std::to_string(pack) + ".pack"));
+		}
+	}
+};
+
+// content of ngram's leaf, from its own file or from a pack when there is a manifest
+template <size_t N> auto read_leaf(const std::filesystem::path & prefix, const dictionary_t<N> & dictionary, const std::optional<pack_manifest_t> & packs, ngram_t<N> ngram) -> std::optional<std::string> {
+	if (!packs) {
+		return read_whole_file(prefix / "leaves" / ngram);
+	}
+
+	const auto index = dictionary.index_of(ngram);
+
+	if (!index) {
+		return std::nullopt;
+	}
+
+	const auto location = packs->locate(*index, dictionary.entries[*index].info.bytes);
+	return read_file_range(prefix / "packs" / (std::to_string(location.pack) + ".pack"), location.offset, location.bytes);
+}
+
+// ngrams of another size than the main one in `ngrams-<N>/` (see crawler/ngram-sizes.hpp)
+template <size_t N> struct ngram_reader {
+	using ngram_type = ngram_t<N>;
+	static constexpr size_t ngram_size = N;
+
+	std::filesystem::path prefix;
+	dictionary_t<N> dictionary;
+	std::optional<pack_manifest_t> packs{};
+
+	static auto open(const std::filesystem::path & prefix) -> std::optional<ngram_reader> {
+		auto dictionary = dictionary_t<N>::load(prefix / "ngrams.bin");
+		if (!dictionary) {
+			return std::nullopt;
+		}
+
+		auto packs = std::filesystem::exists(prefix / "packs.bin") ? pack_manifest_t::load(prefix / "packs.bin", *dictionary) : std::nullopt;
+
+		return ngram_reader{.prefix = prefix, .dictionary = std::move(*dictionary), .packs = std::move(packs)};
+	}
+
+	auto lookup(ngram_type ngram) const noexcept -> std::optional<dictionary_entry_t> {
+		return dictionary.find(ngram);
+	}
+
+	auto postings(ngram_type ngram) const -> std::vector<occurence_t> {
+		const auto content = read_leaf(prefix, dictionary, packs, ngram);
+
+		if (!content) {
+			return {};
+		}
+
+		return parse_leaf(*content);
+	}
+
+	void will_need() const noexcept {
+		if (packs) {
+			packs->will_need(prefix);
+		}
+	}
+};
+
+template <size_t N> struct index_reader {
+	using ngram_type = ngram_t<N>;
+	static constexpr size_t ngram_size = N;
+
+	std::filesystem::path prefix;
+	dictionary_t<N> dictionary;
+	url_dictionary urls;
+	documents_lengths_t lengths;
+	std::optional<document_store> text{};
+	std::optional<target_table> targets{};
+	std::optional<pack_manifest_t> packs{};
+	std::optional<word_table> words{};
+	std::optional<completion_table> completions{};
+
+	static auto open(const std::filesystem::path & prefix) -> std::optional<index_reader> {
+		auto dictionary = dictionary_t<N>::load(prefix / "ngrams.bin");
+		if (!dictionary) {
+			return std::nullopt;
+		}
+
+		auto urls = url_dictionary::open(prefix / "urls.bin");
+		if (!urls) {
+			return std::nullopt;
+		}
+
+		auto lengths = documents_lengths_t::load(prefix / "documents.bin");
+		if (!lengths) {
+			return std::nullopt;
+		}
+
+		// older indices don't have it, then there are no snippets
+		auto text = std::filesystem::exists(prefix / "text.bin") ? document_store::open(prefix / "text.bin") : std::nullopt;
+		auto targets = std::filesystem::exists(prefix / "targets.bin") ? target_table::open(prefix / "targets.bin") : std::nullopt;
+
+		// without manifest leaves are in separate files
+		auto packs = std::filesystem::exists(prefix / "packs.bin") ? pack_manifest_t::load(prefix / "packs.bin", *dictionary) : std::nullopt;
+
+		// without word table every word is searched by its ngrams
+		auto words = std::filesystem::exists(prefix / "words.bin") ? word_table::open(prefix / "words.bin") : std::nullopt;
+
+		// without it there is nothing to offer while typing
+		auto completions = std::filesystem::exists(prefix / "completions.bin") ? completion_table::open(prefix / "completions.bin") : std::nullopt;
+
+		return index_reader{.prefix = prefix, .dictionary = std::move(*dictionary), .urls = std::move(*urls), .lengths = std::move(*lengths), .text = std::move(text), .targets = std::move(targets), .packs = std::move(packs), .words = std::move(words), .completions = std::move(completions)};
+	}
+
+	auto lookup(ngram_type ngram) const noexcept -> std::optional<dictionary_entry_t> {
+		return dictionary.find(ngram);
+	}
+
+	// starts reading of everything mapped (and packs) in background, so first queries don't wait for disk
+	void will_need() const noexcept {
+		urls.will_need();
+
+		if (text) {
+			text->will_need();
+		}
+
+		if (targets) {
+			targets->will_need();
+		}
+
+		if (words) {
+			words->will_need();
+		}
+
+		if (completions) {
+			completions->will_need();
+		}
+
+		if (packs) {
+			packs->will_need(prefix);
+		}
+	}
+
+	auto postings(ngram_type ngram) const -> std::vector<occurence_t> {
+		const auto content = read_leaf(prefix, dictionary, packs, ngram);
+
+		if (!content) {
+			return {};
+		}
+
+		return parse_leaf(*content);
+	}
+
+	// occurences of the whole word (none if it's not a word of any document), std::nullopt if there
+	// is no word table
+	auto word_postings(std::string_view word) const -> std::optional<std::vector<occurence_t>> {
+		if (!words) {
+			return std::nullopt;
+		}
+
+		return words->postings(word).value_or(std::vector<occurence_t>{});
+	}
+
+	auto complete(std::string_view typed, size_t limit) const -> std::vector<completion_t> {
+		if (!completions) {
+			return {};
+		}
+
+		return completions->complete(typed, limit);
+	}
+};
+
+// postings of delta after those of base without replaced base documents (ids of delta
+// documents follow base ones, so result is still sorted)
+inline void append_delta(std::vector<occurence_t> & output, std::span<const occurence_t> added, const tombstones_t & tombstones, uint32_t base_documents) {
+	if (!tombstones.ids.empty()) {
+		std::erase_if(output, [&](occurence_t occ) { return tombstones.contains(occ.id); });
+	}
+
+	for (occurence_t occ: added) {
+		output.push_back(occurence_t{.id = occ.id + base_documents, .position = occ.position});
+	}
+}
+
+// ngrams of another size of base and delta
+template <size_t N> struct other_ngram_size_t {
+	std::optional<ngram_reader<N>> base{};
+	std::optional<ngram_reader<N>> delta{};
+};
+
+// same as layered_reader for ngrams of another size, what's needed to find substrings by them
+template <size_t N> struct layered_ngrams {
+	using ngram_type = ngram_t<N>;
+	static constexpr size_t ngram_size = N;
+
+	const ngram_reader<N> & base;
+	const ngram_reader<N> * delta;
+	const tombstones_t & tombstones;
+	uint32_t base_documents;
+
+	auto lookup(ngram_type ngram) const noexcept -> std::optional<dictionary_entry_t> {
+		auto result = base.lookup(ngram);
+		const auto other = delta ? delta->lookup(ngram) : std::nullopt;
+
+		if (!result || !other) {
+			return result ? result : other;
+		}
+
+		return dictionary_entry_t{.postings = result->postings + other->postings, .bytes = result->bytes + other->bytes, .documents = result->documents + other->documents};
+	}
+
+	auto postings(ngram_type ngram) const -> std::vector<occurence_t> {
+		auto output = base.postings(ngram);
+
+		if (delta) {
+			append_delta(output, delta->postings(ngram), tombstones, base_documents);
+		}
+
+		return output;
+	}
+};
+
+// base index with optional delta of `build-index --update` in `prefix/delta`: ids of delta documents
+// follow base ones, replaced and removed base documents (tombstones) are filtered out of postings
+template <size_t N> struct layered_reader {
+	using ngram_type = ngram_t<N>;
+	static constexpr size_t ngram_size = N;
+
+	index_reader<N> base;
+	std::optional<index_reader<N>> delta{};
+	tombstones_t tombstones{};
+	documents_lengths_t lengths{}; // base and delta together
+
+	// ngrams of other sizes (`build-index --ngram=...`), the one of N is always empty
+	std::tuple<other_ngram_size_t<2>, other_ngram_size_t<3>, other_ngram_size_t<4>> other_sizes{};
+
+	// index is usable without them, words are then searched by ngrams of size N
+	void open_other_sizes(const std::filesystem::path & prefix) {
+		const bool has_delta = delta.has_value();
+
+		const auto sizes = std::filesystem::exists(prefix / "ngram-sizes.bin") ? ngram_sizes_of(prefix) : std::nullopt;
+		const auto delta_sizes = (has_delta && std::filesystem::exists(prefix / "delta" / "ngram-sizes.bin")) ? ngram_sizes_of(prefix / "delta") : std::nullopt;
+
+		if (!sizes) {
+			return;
+		}
+
+		for_each_ngram_size([&](auto m) {
+			constexpr size_t M = decltype(m)::value;
+
+			if constexpr (M != N) {
+				if (std::ranges::find(*sizes, M) == sizes->end()) {
+					return;
+				}
+
+				// without them in delta new documents wouldn't be found by them
+				if (has_delta && (!delta_sizes || std::ranges::find(*delta_sizes, M) == delta_sizes->end())) {
+					return;
+				}
+
+				auto & other = std::get<other_ngram_size_t<M>>(other_sizes);
+				other.base = ngram_reader<M>::open(ngram_size_directory(prefix, M));
+
+				if (has_delta) {
+					other.delta = ngram_reader<M>::open(ngram_size_directory(prefix / "delta", M));
+				}
+			}
+		});
+	}
+
+	static auto open(const std::filesystem::path & prefix) -> std::optional<layered_reader> {
+		auto base = index_reader<N>::open(prefix);
+		if (!base) {
+			return std::nullopt;
+		}
+
+		auto output = layered_reader{.base = std::move(*base)};
+		output.lengths = output.base.lengths;
+
+		if (!std::filesystem::exists(prefix / "delta" / "tombstones.bin")) {
+			output.open_other_sizes(prefix);
+			return output;
+		}
+
+		auto delta = index_reader<N>::open(prefix / "delta");
+		auto tombstones = load_tombstones(prefix / "delta" / "tombstones.bin");
+
+		if (!delta || !tombstones) {
+			return std::nullopt;
+		}
+
+		if (tombstones->base_documents != output.base.lengths.lengths.size()) {
+			std::cerr << "delta doesn't belong to the index: " << prefix << "\n";
+			return std::nullopt;
+		}
+
+		const double base_total = output.base.lengths.average * static_cast<double>(output.base.lengths.lengths.size());
+		const double delta_total = delta->lengths.average * static_cast<double>(delta->lengths.lengths.size());
+
+		output.lengths.lengths.insert(output.lengths.lengths.end(), delta->lengths.lengths.begin(), delta->lengths.lengths.end());
+		output.lengths.average = output.lengths.lengths.empty() ? 0.0 : (base_total + delta_total) / static_cast<double>(output.lengths.lengths.size());
+
+		output.delta = std::move(delta);
+		output.tombstones = std::move(*tombstones);
+
+		output.open_other_sizes(prefix);
+
+		return output;
+	}
+
+	// ngrams of size M, std::nullopt if the index doesn't have them
+	template <size_t M> auto with_size() const -> std::optional<layered_ngrams<M>> {
+		const auto & other = std::get<other_ngram_size_t<M>>(other_sizes);
+
+		if (!other.base || (delta && !other.delta)) {
+			return std::nullopt;
+		}
+
+		return layered_ngrams<M>{.base = *other.base, .delta = other.delta ? &*other.delta : nullptr, .tombstones = tombstones, .base_documents = base_documents()};
+	}
+
+	uint32_t base_documents() const noexcept {
+		return static_cast<uint32_t>(base.lengths.lengths.size());
+	}
+
+	// counts are only estimates for planning and scoring (tombstones are included)
+	auto lookup(ngram_type ngram) const noexcept -> std::optional<dictionary_entry_t> {
+		auto result = base.lookup(ngram);
+
+		if (!delta) {
+			return result;
+		}
+
+		const auto other = delta->lookup(ngram);
+
+		if (!result || !other) {
+			return result ? result : other;
+		}
+
+		return dictionary_entry_t{.postings = result->postings + other->postings, .bytes = result->bytes + other->bytes, .documents = result->documents + other->documents};
+	}
+
+	auto postings(ngram_type ngram) const -> std::vector<occurence_t> {
+		auto output = base.postings(ngram);
+
+		if (delta) {
+			append_delta(output, delta->postings(ngram), tombstones, base_documents());
+		}
+
+		return output;
+	}
+
+	// both parts need the word table, otherwise words of the other one would be missing
+	bool has_words() const noexcept {
+		return base.words && (!delta || delta->words);
+	}
+
+	auto word_postings(std::string_view word) const -> std::optional<std::vector<occurence_t>> {
+		if (!has_words()) {
+			return std::nullopt;
+		}
+
+		auto output = base.word_postings(word);
+
+		if (!delta) {
+			return output;
+		}
+
+		const auto added = delta->word_postings(word);
+
+		append_delta(*output, *added, tombstones, base_documents());
+
+		return output;
+	}
+
+	// all words of base and delta (sorted)
+	auto words() const -> std::vector<std::string_view> {
+		auto output = base.words ? base.words->words() : std::vector<std::string_view>{};
+
+		if (delta && delta->words) {
+			const auto middle = output.size();
+			std::ranges::copy(delta->words->words(), std::back_inserter(output));
+			std::ranges::inplace_merge(output, output.begin() + static_cast<std::ptrdiff_t>(middle));
+			const auto duplicates = std::ranges::unique(output);
+			output.erase(duplicates.begin(), duplicates.end());
+		}
+
+		return output;
+	}
+
+	// best completions of both parts, scores of a term in both are added (replaced documents
+	// are still counted, it's only an estimate)
+	auto complete(std::string_view typed, size_t limit) const -> std::vector<completion_t> {
+		auto output = base.complete(typed, limit);
+
+		if (!delta) {
+			return output;
+		}
+
+		for (const completion_t & item: delta->complete(typed, limit)) {
+			const auto it = std::ranges::find(output, item.term, &completion_t::term);
+			if (it != output.end()) {
+				it->score += item.score;
+			} else {
+				output.push_back(item);
+			}
+		}
+
+		std::ranges::sort(output, better_completion);
+
+		if (output.size() > limit) {
+			output.resize(limit);
+		}
+
+		return output;
+	}
+
+	auto url(uint32_t id) const -> std::optional<std::string> {
+		if (id < base_documents()) {
+			return base.urls.get(id);
+		}
+		return delta ? delta->urls.get(id - base_documents()) : std::nullopt;
+	}
+
+	// reader which has the document and id of the document in it
+	auto locate(uint32_t id) const noexcept -> std::pair<const index_reader<N> *, uint32_t> {
+		if (id < base_documents()) {
+			return {&base, id};
+		}
+		return {delta ? &*delta : nullptr, id - base_documents()};
+	}
+
+	auto nearest_target(uint32_t id, uint32_t position) const noexcept -> std::optional<target_hit_t> {
+		const auto [part, local] = locate(id);
+
+		if (part == nullptr || !part->targets) {
+			return std::nullopt;
+		}
+
+		return part->targets->nearest_target(local, position);
+	}
+
+	auto snippet(uint32_t id, uint32_t position, uint32_t length) const -> std::optional<snippet_t> {
+		const auto [part, local] = locate(id);
+
+		if (part == nullptr || !part->text) {
+			return std::nullopt;
+		}
+
+		return part->text->snippet(local, position, length);
+	}
+
+	void will_need() const noexcept {
+		base.will_need();
+
+		if (delta) {
+			delta->will_need();
+		}
+
+		std::apply([](const auto &... other) {
+			((other.base ? other.base->will_need() : void()), ...);
+			((other.delta ? other.delta->will_need() : void()), ...);
+		}, other_sizes);
+	}
+
+	// documents which are not replaced by delta
+	bool alive(uint32_t id) const noexcept {
+		return id >= base_documents() || !delta || !tombstones.contains(id);
+	}
+
+	// all ngrams of base and delta (sorted)
+	auto ngrams() const -> std::vector<ngram_type> {
+		auto output = base.dictionary.entries | std::views::transform(&dictionary_t<N>::entry_t::ngram) | std::ranges::to<std::vector>();
+
+		if (delta) {
+			const auto middle = output.size();
+			std::ranges::copy(delta->dictionary.entries | std::views::transform(&dictionary_t<N>::entry_t::ngram), std::back_inserter(output));
+			std::ranges::inplace_merge(output, output.begin() + static_cast<std::ptrdiff_t>(middle));
+			const auto duplicates = std::ranges::unique(output);
+			output.erase(duplicates.begin(), duplicates.end());
+		}
+
+		return output;
+	}
+};
+
+} // namespace crawler
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef CRAWLER_REORDER_HPP
+#define CRAWLER_REORDER_HPP
+
+#include "index.hpp"
+#include "varint.hpp"
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace crawler {
+
+// Documents are inserted in order of finished downloads, so similar documents are spread
+// all over id space. Renumbering them so similar ones are neighbours makes gaps in postings
+// (and so compressed postings) smaller and intersections more cache friendly.
+
+enum class reorder_strategy {
+	none,
+	url,
+	ngrams
+};
+
+inline auto parse_reorder_strategy(std::string_view name) noexcept -> std::optional<reorder_strategy> {
+	if (name == "none") {
+		return reorder_strategy::none;
+	} else if (name == "url") {
+		return reorder_strategy::url;
+	} else if (name == "ngrams") {
+		return reorder_strategy::ngrams;
+	}
+	return std::nullopt;
+}
+
+// result is list of old ids in their new order
+inline auto order_by_url(const std::vector<document_info> & documents) -> std::vector<uint32_t> {
+	std::vector<uint32_t> order(documents.size());
+	std::iota(order.begin(), order.end(), uint32_t{0});
+
+	// same directory => same prefix => neighbours
+	std::ranges::stable_sort(order, std::less<>{}, [&](uint32_t id) -> std::string_view { return documents[id].url; });
+
+	return order;
+}
+
+// Cluster documents by their content: each document gets a small min-hash signature of the set
+// of its ngrams, documents with similar sets have same signature prefix with high probability,
+// sorting by signature puts them next to each other (URL breaks ties).
+template <size_t N> auto order_by_ngrams(const index_t<N> & index) -> std::vector<uint32_t> {
+	constexpr size_t signature_size = 4;
+	using signature_t = std::array<uint64_t, signature_size>;
+
+	constexpr auto hash = [](const ngram_t<N> & ngram, uint64_t seed) {
+		// FNV-1a with different seeds is enough here
+		uint64_t h = 0xcbf29ce484222325ull ^ (seed * 0x9e3779b97f4a7c15ull);
+		for (char8_t c: ngram) {
+			h = (h ^ static_cast<uint64_t>(c)) * 0x100000001b3ull;
+		}
+		return h ^ (h >> 29u);
+	};
+
+	std::vector<signature_t> signatures(index.documents.size());
+	for (auto & signature: signatures) {
+		signature.fill(std::numeric_limits<uint64_t>::max());
+	}
+
+	for (const auto & [ngram, leaf]: index.leaves) {
+		signature_t hashes;
+		for (size_t i = 0; i != signature_size; ++i) {
+			hashes[i] = hash(ngram, i);
+		}
+
+		for (const occurence_t & occ: leaf.unsorted_data) {
+			auto & signature = signatures[occ.id];
+			for (size_t i = 0; i != signature_size; ++i) {
+				signature[i] = std::min(signature[i], hashes[i]);
+			}
+		}
+	}
+
+	std::vector<uint32_t> order(index.documents.size());
+	std::iota(order.begin(), order.end(), uint32_t{0});
+
+	std::ranges::stable_sort(order, [&](uint32_t lhs, uint32_t rhs) {
+		if (signatures[lhs] != signatures[rhs]) {
+			return signatures[lhs] < signatures[rhs];
+		}
+		return index.documents[lhs].url < index.documents[rhs].url;
+	});
+
+	return order;
+}
+
+template <size_t N> auto order_documents(const index_t<N> & index, reorder_strategy strategy) -> std::vector<uint32_t> {
+	switch (strategy) {
+		case reorder_strategy::url: return order_by_url(index.documents);
+		case reorder_strategy::ngrams: return order_by_ngrams(index);
+		case reorder_strategy::none: break;
+	}
+
+	std::vector<uint32_t> order(index.documents.size());
+	std::iota(order.begin(), order.end(), uint32_t{0});
+	return order;
+}
+
+// size of all postings if they were delta+varint encoded
+template <size_t N> size_t compressed_postings_size(index_t<N> & index) {
+	size_t output = 0;
+	std::string buffer;
+
+	for (auto & [ngram, leaf]: index.leaves) {
+		std::ranges::sort(leaf.unsorted_data);
+		buffer.clear();
+		encode_postings(leaf.unsorted_data, buffer);
+		output += buffer.size();
+	}
+
+	return output;
+}
+
+} // namespace crawler
+
+#endif
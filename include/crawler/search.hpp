@@ -0,0 +1,322 @@
+#ifndef CRAWLER_SEARCH_HPP
+#define CRAWLER_SEARCH_HPP
+
+#include "fuzzy.hpp"
+#include "intersection.hpp"
+#include "ngram-sizes.hpp"
+#include "planner.hpp"
+#include "ranking.hpp"
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace crawler {
+
+// query side, works with anything which looks like `index_reader` (lookup, postings, documents,
+// optionally word_postings)
+
+struct query_word_t {
+	std::string text;
+	bool negative{false};
+	bool fuzzy{false};
+	bool anywhere{false}; // quoted, found also inside of longer words
+};
+
+// same rules as `split_to_words` in web/string.js (quotes keep spaces, leading '-' negates),
+// trailing '~' asks for similar words too (typo tolerant, only here, not in browser)
+inline auto split_to_words(std::string_view query) -> std::vector<query_word_t> {
+	enum class state_t {
+		text,
+		quotes,
+		double_quotes
+	} state{state_t::text};
+
+	std::vector<query_word_t> output;
+	std::string word;
+	bool quoted = false;
+
+	const auto flush = [&] {
+		if (word.empty()) {
+			return;
+		}
+		const bool negative = word.starts_with('-');
+		const bool fuzzy = word.size() > 1u && word.ends_with('~');
+		if (fuzzy) {
+			word.pop_back();
+		}
+		output.push_back(query_word_t{.text = negative ? word.substr(1) : word, .negative = negative, .fuzzy = fuzzy, .anywhere = quoted});
+		word.clear();
+		quoted = false;
+	};
+
+	for (char c: query) {
+		if (c >= 'A' && c <= 'Z') {
+			// index is lowercase only
+			c = static_cast<char>((c - 'A') + 'a');
+		}
+
+		if (state == state_t::text) {
+			if (c == ' ') {
+				flush();
+			} else if (c == '"' && (word.empty() || word == "-")) {
+				state = state_t::double_quotes;
+				quoted = true;
+			} else if (c == '\'' && (word.empty() || word == "-")) {
+				state = state_t::quotes;
+				quoted = true;
+			} else {
+				word += c;
+			}
+		} else if ((state == state_t::quotes && c == '\'') || (state == state_t::double_quotes && c == '"')) {
+			state = state_t::text;
+		} else {
+			word += c;
+		}
+	}
+
+	flush();
+
+	return output;
+}
+
+template <typename Index> auto plan_substring(const Index & index, std::string_view word) {
+	constexpr size_t N = Index::ngram_size;
+
+	return plan_word<N>(word, [&](ngram_t<N> ngram) -> std::optional<uint64_t> {
+		return index.lookup(ngram).transform([](dictionary_entry_t info) { return uint64_t{info.postings}; });
+	});
+}
+
+// all occurences of the text anywhere (also inside of other words), assembled from its ngrams
+template <typename Index> auto find_substring(const Index & index, std::string_view word) -> std::vector<occurence_t> {
+	const auto plan = plan_substring(index, word);
+
+	if (!plan || plan->empty()) {
+		return {};
+	}
+
+	std::vector<occurence_t> result;
+	bool first = true;
+
+	for (const auto & item: *plan) {
+		auto hits = index.postings(item.ngram);
+
+		// move all positions to the beginning of the word, and drop those which can't be there
+		std::erase_if(hits, [&](occurence_t occ) { return occ.position.n < item.offset; });
+		for (occurence_t & occ: hits) {
+			occ.position.n -= item.offset;
+		}
+
+		if (first) {
+			result = std::move(hits);
+			first = false;
+		} else {
+			result = intersection(result, hits);
+		}
+
+		if (result.empty()) {
+			// nothing to intersect anymore, rest of ngrams doesn't need to be loaded
+			break;
+		}
+	}
+
+	return result;
+}
+
+// postings read by `find_substring`, std::nullopt if the word is shorter than ngrams of the index
+template <typename Index> auto substring_cost(const Index & index, std::string_view word) -> std::optional<uint64_t> {
+	if (word.size() < Index::ngram_size) {
+		return std::nullopt;
+	}
+
+	const auto plan = plan_substring(index, word);
+
+	if (!plan) {
+		// some of its ngrams is nowhere, nothing is read
+		return 0;
+	}
+
+	uint64_t output = 0;
+	for (const auto & item: *plan) {
+		output += item.cost;
+	}
+
+	return output;
+}
+
+// index with ngrams of other sizes (`layered_reader::with_size`)
+template <typename Index> concept with_other_ngram_sizes = requires(const Index & index) { index.template with_size<2>(); };
+
+// same as `find_substring` by ngrams of size which needs fewest postings for the word (the main
+// one when they are same)
+template <typename Index> auto find_substring_by_best_size(const Index & index, std::string_view word) -> std::vector<occurence_t> {
+	if constexpr (with_other_ngram_sizes<Index>) {
+		constexpr size_t N = Index::ngram_size;
+
+		std::optional<uint64_t> best = substring_cost(index, word);
+		size_t best_size = N;
+
+		for_each_ngram_size([&](auto m) {
+			constexpr size_t M = decltype(m)::value;
+
+			if constexpr (M != N) {
+				if (const auto other = index.template with_size<M>()) {
+					const auto cost = substring_cost(*other, word);
+					if (cost && (!best || *cost < *best)) {
+						best = cost;
+						best_size = M;
+					}
+				}
+			}
+		});
+
+		if (best_size != N) {
+			return with_ngram_size(best_size, [&](auto m) {
+				constexpr size_t M = decltype(m)::value;
+
+				if constexpr (M != N) {
+					return find_substring(*index.template with_size<M>(), word);
+				} else {
+					return find_substring(index, word);
+				}
+			});
+		}
+	}
+
+	return find_substring(index, word);
+}
+
+// shortest word which can be searched for
+template <typename Index> auto shortest_searchable_word(const Index & index) -> size_t {
+	if constexpr (with_other_ngram_sizes<Index>) {
+		size_t output = Index::ngram_size;
+
+		for_each_ngram_size([&](auto m) {
+			constexpr size_t M = decltype(m)::value;
+
+			if constexpr (M < Index::ngram_size) {
+				if (index.template with_size<M>()) {
+					output = std::min(output, M);
+				}
+			}
+		});
+
+		return output;
+	} else {
+		return Index::ngram_size;
+	}
+}
+
+// substring occurences which are not a part of a longer word (character before and after it
+// is not a word character), kept as they are if the index has no text to check it
+template <typename Index> auto whole_words_only(const Index & index, std::vector<occurence_t> occurences, size_t length) -> std::vector<occurence_t> {
+	if constexpr (requires { index.snippet(uint32_t{0}, uint32_t{0}, uint32_t{0}); }) {
+		std::erase_if(occurences, [&](occurence_t occ) {
+			const auto snippet = index.snippet(occ.id, occ.position.n, static_cast<uint32_t>(length));
+			if (!snippet) {
+				return false;
+			}
+			return (!snippet->before.empty() && is_word_character(snippet->before.back())) || (!snippet->after.empty() && is_word_character(snippet->after.front()));
+		});
+	}
+
+	return occurences;
+}
+
+// occurences of a whole word (`vector` not in `vectors`), taken from the word index without
+// assembling it from ngrams, index without word table finds it by ngrams and checks it's whole
+template <typename Index> auto find_whole_word(const Index & index, std::string_view word) -> std::vector<occurence_t> {
+	if constexpr (requires { index.word_postings(word); }) {
+		if (auto occurences = index.word_postings(word)) {
+			return std::move(*occurences);
+		}
+	}
+
+	return whole_words_only(index, find_substring_by_best_size(index, word), word.size());
+}
+
+// all occurences of the query word (position is position of its first character): a word which
+// can be in the word index is searched as whole word, quoted one (`"vector"` in `inplace_vector`),
+// substrings with symbols (`operator<=>`) or phrases anywhere in text by ngrams like in browser
+template <typename Index> auto find_word(const Index & index, std::string_view word, bool anywhere = false) -> std::vector<occurence_t> {
+	if (!anywhere && is_indexed_word(word)) {
+		return find_whole_word(index, word);
+	}
+
+	return find_substring_by_best_size(index, word);
+}
+
+// occurences (sorted by id) grouped into one posting per document
+inline auto group_by_document(std::span<const occurence_t> occurences) -> std::vector<scored_posting_t> {
+	std::vector<scored_posting_t> output;
+
+	for (const occurence_t occ: occurences) {
+		if (output.empty() || output.back().id != occ.id) {
+			output.push_back(scored_posting_t{.id = occ.id, .tf = 0, .first_position = occ.position.n});
+		}
+		++output.back().tf;
+	}
+
+	return output;
+}
+
+// same for places similar to the word, documents where it's closer to the word are scored higher
+inline auto group_by_document(std::span<const similar_occurence_t> occurences) -> std::vector<scored_posting_t> {
+	std::vector<scored_posting_t> output;
+
+	for (const similar_occurence_t & item: occurences) {
+		const occurence_t occ = item.occurence;
+		if (output.empty() || output.back().id != occ.id) {
+			output.push_back(scored_posting_t{.id = occ.id, .tf = 0, .first_position = occ.position.n, .weight = 0.0});
+		}
+		++output.back().tf;
+		if (item.similarity() > output.back().weight) {
+			output.back().weight = item.similarity();
+			output.back().first_position = occ.position.n;
+		}
+	}
+
+	return output;
+}
+
+template <typename Index> auto make_scorer(const Index & index) -> bm25_scorer {
+	return bm25_scorer{.documents = index.lengths.lengths.size(), .average_length = index.lengths.average, .lengths = index.lengths.lengths};
+}
+
+// BM25 ranked documents which contain all positive words and none of negative ones
+template <typename Index> auto search(const Index & index, std::string_view query, size_t limit = 100) -> std::vector<document_hit_t> {
+	const auto scorer = make_scorer(index);
+
+	std::vector<term_postings_t> terms;
+	std::vector<std::vector<uint32_t>> excluded;
+
+	const size_t shortest = shortest_searchable_word(index);
+
+	for (const auto & word: split_to_words(query)) {
+		if (word.text.size() < shortest && (word.anywhere || !is_indexed_word(word.text))) {
+			// we are interested in words of certain size only (whole words are not found by ngrams)
+			continue;
+		}
+
+		// words shorter than main ngrams (found by smaller ones) are searched exactly
+		const bool fuzzy = word.fuzzy && word.text.size() >= Index::ngram_size;
+
+		auto documents = fuzzy ? group_by_document(find_similar(index, word.text)) : group_by_document(find_word(index, word.text, word.anywhere));
+
+		if (word.negative) {
+			excluded.push_back(documents | std::views::transform(&scored_posting_t::id) | std::ranges::to<std::vector>());
+		} else if (documents.empty()) {
+			// all positive words must be there
+			return {};
+		} else {
+			terms.push_back(scorer.prepare(std::move(documents), static_cast<uint32_t>(word.text.size())));
+		}
+	}
+
+	return top_k(terms, excluded, scorer, limit);
+}
+
+} // namespace crawler
+
+#endif
@@ -0,0 +1,389 @@
+#ifndef CRAWLER_SEGMENT_HPP
+#define CRAWLER_SEGMENT_HPP
+
+#include "binary.hpp"
+#include "index.hpp"
+#include "mapped-file.hpp"
+#include "varint.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace crawler {
+
+// Whole in-memory index_t (documents with their text and targets, and all postings) in one
+// compact file, so it can be loaded back and continued. Unlike `save_into` output it's not
+// meant for queries, it's a building block: crawl checkpoints, delta segments, merging.
+//
+// "SGMT" u32(version) u32(N) u32(document count) u32(target string count) u32(leaf count) u32(word count)
+// document: varint(url length) url varint(ngrams) varint(text size) varint(block count)
+//           varint(block end)[block count] varint(data length) data
+//           varint(target count) [varint(position gap) varint(string id)]*
+//           varint(length) etag varint(length) last-modified u64(content hash)
+//           varint(link count) [varint(length) link]*
+// string:   varint(length) bytes
+// leaf:     ngram[N] varint(postings) varint(bytes) postings (see encode_postings)
+// word:     varint(length) word varint(postings) varint(bytes) postings
+//
+// version 2 has no word count and words, they are tokenized again from the text when it's read,
+// version 3 has no links
+
+static constexpr uint32_t segment_version = 4;
+
+inline void write_string(std::string & output, std::string_view str) {
+	write_varint(output, str.size());
+	output.append(str);
+}
+
+inline auto read_string(std::string_view & input) noexcept -> std::optional<std::string_view> {
+	const auto length = read_varint(input);
+
+	if (!length || *length > input.size()) {
+		return std::nullopt;
+	}
+
+	const auto result = input.substr(0, static_cast<size_t>(*length));
+	input.remove_prefix(static_cast<size_t>(*length));
+	return result;
+}
+
+// postings are sorted in place (same as when saving leaves) if they are not sorted already
+template <size_t N> void write_segment(std::ostream & out, index_t<N> & index) {
+	write_magic(out, "SGMT");
+	write_u32(out, segment_version);
+	write_u32(out, static_cast<uint32_t>(N));
+	write_u32(out, static_cast<uint32_t>(index.documents.size()));
+	write_u32(out, static_cast<uint32_t>(index.target_strings.size()));
+	write_u32(out, static_cast<uint32_t>(index.leaves.size()));
+	write_u32(out, static_cast<uint32_t>(index.words.size()));
+
+	std::string buffer;
+
+	const auto flush = [&] {
+		out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+		buffer.clear();
+	};
+
+	for (const document_info & doc: index.documents) {
+		write_string(buffer, doc.url);
+		write_varint(buffer, doc.ngrams);
+		write_varint(buffer, doc.text.size);
+		write_varint(buffer, doc.text.blocks());
+		for (size_t i = 1; i != doc.text.block_offsets.size(); ++i) {
+			write_varint(buffer, doc.text.block_offsets[i]);
+		}
+		write_string(buffer, doc.text.data);
+
+		write_varint(buffer, doc.targets.size());
+		uint32_t previous = 0;
+		for (const link_target & target: doc.targets) {
+			write_varint(buffer, target.position.n - previous);
+			write_varint(buffer, target.string);
+			previous = target.position.n;
+		}
+
+		write_string(buffer, doc.etag);
+		write_string(buffer, doc.last_modified);
+		flush();
+		write_u64(out, doc.content_hash);
+
+		write_varint(buffer, doc.links.size());
+		for (const std::string & link: doc.links) {
+			write_string(buffer, link);
+		}
+	}
+
+	for (std::string_view str: index.target_strings.all()) {
+		write_string(buffer, str);
+	}
+
+	flush();
+
+	std::string postings;
+
+	for (auto & [ngram, leaf]: index.leaves) {
+		// sorted leaves are left untouched, so a segment which is already searched can be written
+		if (!std::ranges::is_sorted(leaf.unsorted_data)) {
+			std::ranges::sort(leaf.unsorted_data);
+		}
+
+		postings.clear();
+		encode_postings(leaf.unsorted_data, postings);
+
+		buffer.append(reinterpret_cast<const char *>(ngram.data()), N);
+		write_varint(buffer, leaf.unsorted_data.size());
+		write_string(buffer, postings);
+
+		if (buffer.size() >= 64u * 1024u) {
+			flush();
+		}
+	}
+
+	for (auto & [word, leaf]: index.words) {
+		if (!std::ranges::is_sorted(leaf.unsorted_data)) {
+			std::ranges::sort(leaf.unsorted_data);
+		}
+
+		postings.clear();
+		encode_postings(leaf.unsorted_data, postings);
+
+		write_string(buffer, word);
+		write_varint(buffer, leaf.unsorted_data.size());
+		write_string(buffer, postings);
+
+		if (buffer.size() >= 64u * 1024u) {
+			flush();
+		}
+	}
+
+	flush();
+}
+
+// decodes postings of a leaf (or word) and appends them with ids shifted by `first_id`
+inline bool read_postings(std::string_view & input, uint32_t document_count, uint32_t first_id, std::vector<occurence_t> & data) {
+	const auto count = read_varint(input);
+	const auto postings = read_string(input);
+
+	if (!count || !postings) {
+		return false;
+	}
+
+	auto decoded = decode_postings(*postings, static_cast<size_t>(*count));
+
+	if (!decoded || decoded->size() != *count) {
+		return false;
+	}
+
+	data.reserve(data.size() + decoded->size());
+
+	for (occurence_t occ: *decoded) {
+		if (occ.id >= document_count) {
+			return false;
+		}
+		data.push_back(occurence_t{.id = first_id + occ.id, .position = occ.position});
+	}
+
+	return true;
+}
+
+// appends content of the segment to `index` (ids of its documents and target strings are shifted
+// after those already there), returns false if the segment is broken (index is then incomplete)
+template <size_t N> bool read_segment(std::string_view & input, index_t<N> & index) {
+	auto header = binary_reader{std::span<const char>(input.data(), input.size())};
+
+	if (!header.expect_magic("SGMT")) {
+		return false;
+	}
+
+	const uint32_t version = header.read_u32();
+
+	if ((version < 2u || version > segment_version) || header.read_u32() != N) {
+		return false;
+	}
+
+	const uint32_t document_count = header.read_u32();
+	const uint32_t string_count = header.read_u32();
+	const uint32_t leaf_count = header.read_u32();
+	const uint32_t word_count = (version >= 3u) ? header.read_u32() : 0u;
+
+	if (header.failed) {
+		return false;
+	}
+
+	input.remove_prefix(header.offset);
+
+	const auto first_id = static_cast<uint32_t>(index.documents.size());
+	index.documents.reserve(index.documents.size() + document_count);
+
+	for (uint32_t i = 0; i != document_count; ++i) {
+		const auto url = read_string(input);
+		const auto ngrams = read_varint(input);
+		const auto text_size = read_varint(input);
+		const auto blocks = read_varint(input);
+
+		if (!url || !ngrams || !text_size || !blocks || *blocks > input.size()) {
+			return false;
+		}
+
+		auto & doc = index.insert_document(std::string(*url));
+		doc.ngrams = static_cast<size_t>(*ngrams);
+		doc.text.size = static_cast<uint32_t>(*text_size);
+		doc.text.block_offsets.reserve(static_cast<size_t>(*blocks) + 1u);
+
+		for (uint64_t b = 0; b != *blocks; ++b) {
+			const auto end = read_varint(input);
+			if (!end) {
+				return false;
+			}
+			doc.text.block_offsets.push_back(static_cast<uint32_t>(*end));
+		}
+
+		const auto data = read_string(input);
+		const auto targets = read_varint(input);
+
+		if (!data || !targets || *targets > input.size()) {
+			return false;
+		}
+
+		doc.text.data = std::string(*data);
+		doc.targets.reserve(static_cast<size_t>(*targets));
+
+		uint32_t position = 0;
+		for (uint64_t t = 0; t != *targets; ++t) {
+			const auto gap = read_varint(input);
+			const auto string = read_varint(input);
+			if (!gap || !string || *string >= string_count) {
+				return false;
+			}
+			position += static_cast<uint32_t>(*gap);
+			doc.add_target(position_t{position}, static_cast<uint32_t>(*string));
+		}
+
+		const auto etag = read_string(input);
+		const auto last_modified = read_string(input);
+
+		if (!etag || !last_modified || input.size() < sizeof(uint64_t)) {
+			return false;
+		}
+
+		doc.etag = std::string(*etag);
+		doc.last_modified = std::string(*last_modified);
+		doc.content_hash = binary_reader{std::span<const char>(input.data(), sizeof(uint64_t))}.read_u64();
+		input.remove_prefix(sizeof(uint64_t));
+
+		if (version >= 4u) {
+			const auto links = read_varint(input);
+
+			if (!links || *links > input.size()) {
+				return false;
+			}
+
+			doc.links.reserve(static_cast<size_t>(*links));
+
+			for (uint64_t l = 0; l != *links; ++l) {
+				const auto link = read_string(input);
+				if (!link) {
+					return false;
+				}
+				doc.links.emplace_back(*link);
+			}
+		}
+	}
+
+	// target strings are interned again, the index can have some of them already
+	std::vector<uint32_t> string_id(string_count);
+
+	for (uint32_t & id: string_id) {
+		const auto str = read_string(input);
+		if (!str) {
+			return false;
+		}
+		id = index.target_strings.intern(*str);
+	}
+
+	for (auto & doc: index.documents | std::views::drop(first_id)) {
+		for (link_target & target: doc.targets) {
+			target.string = string_id[target.string];
+		}
+	}
+
+	for (uint32_t i = 0; i != leaf_count; ++i) {
+		if (input.size() < N) {
+			return false;
+		}
+
+		ngram_t<N> ngram;
+		std::copy_n(reinterpret_cast<const char8_t *>(input.data()), N, ngram.begin());
+		input.remove_prefix(N);
+
+		if (!read_postings(input, document_count, first_id, index.leaves[ngram].unsorted_data)) {
+			return false;
+		}
+	}
+
+	for (uint32_t i = 0; i != word_count; ++i) {
+		const auto word = read_string(input);
+
+		if (!word) {
+			return false;
+		}
+
+		auto it = index.words.find(*word);
+		if (it == index.words.end()) {
+			it = index.words.emplace(std::string(*word), leaf_t{}).first;
+		}
+
+		if (!read_postings(input, document_count, first_id, it->second.unsorted_data)) {
+			return false;
+		}
+	}
+
+	if (version == 2u) {
+		for (auto & doc: index.documents | std::views::drop(first_id)) {
+			if (const auto text = extract_text(doc.text, 0, doc.text.size)) {
+				index.insert_words(*text, doc);
+			}
+		}
+	}
+
+	return true;
+}
+
+// written into a temporary file first and renamed, so there is always a complete old or new one
+template <size_t N> bool save_segment(const std::filesystem::path & name, index_t<N> & index) {
+	auto tmp = name;
+	tmp += ".tmp";
+
+	{
+		auto of = std::ofstream{tmp, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc};
+
+		if (!of) {
+			std::cerr << "can't open file: " << tmp << "\n";
+			return false;
+		}
+
+		write_segment(of, index);
+
+		if (!of.flush()) {
+			std::cerr << "can't write file: " << tmp << "\n";
+			return false;
+		}
+	}
+
+	auto ec = std::error_code{};
+	std::filesystem::rename(tmp, name, ec);
+
+	if (ec) {
+		std::cerr << "can't rename " << tmp << " to " << name << "\n";
+		return false;
+	}
+
+	return true;
+}
+
+template <size_t N> bool load_segment(const std::filesystem::path & name, index_t<N> & index) {
+	const auto file = mapped_file::open(name);
+
+	if (!file) {
+		std::cerr << "can't open file: " << name << "\n";
+		return false;
+	}
+
+	auto input = std::string_view(file->data().data(), file->size());
+
+	if (!read_segment(input, index)) {
+		std::cerr << "broken segment: " << name << "\n";
+		return false;
+	}
+
+	return true;
+}
+
+} // namespace crawler
+
+#endif
@@ -0,0 +1,579 @@
+#include "shard.hpp"
+#include "binary.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <iostream>
+#include <limits>
+#include <thread>
+#include <tuple>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+template <typename T> static void append_le(std::string & output, T value) {
+	for (size_t i = 0; i != sizeof(T); ++i) {
+		output.push_back(static_cast<char>(value & 0xFFu));
+		value = static_cast<T>(value >> 8u);
+	}
+}
+
+static void append_string(std::string & output, std::string_view str) {
+	append_le(output, static_cast<uint32_t>(str.size()));
+	output.append(str);
+}
+
+static auto read_sized(crawler::binary_reader & in) -> std::string {
+	const uint32_t length = in.read_u32();
+	return std::string(in.read_bytes(length));
+}
+
+auto crawler::encode_request(const shard_request_t & request) -> std::string {
+	std::string output = "QURY";
+	append_le(output, request.limit);
+	append_string(output, request.query);
+	return output;
+}
+
+auto crawler::decode_request(std::string_view payload) -> std::optional<shard_request_t> {
+	auto in = binary_reader{payload};
+
+	if (!in.expect_magic("QURY")) {
+		return std::nullopt;
+	}
+
+	shard_request_t output{};
+	output.limit = in.read_u32();
+	output.query = read_sized(in);
+
+	if (in.failed) {
+		return std::nullopt;
+	}
+
+	return output;
+}
+
+auto crawler::encode_response(const shard_response_t & response) -> std::string {
+	std::string output = "HITS";
+	append_le(output, static_cast<uint32_t>(response.search_time.count()));
+	append_le(output, static_cast<uint32_t>(response.hits.size()));
+
+	for (const shard_hit_t & hit: response.hits) {
+		append_le(output, std::bit_cast<uint64_t>(hit.score));
+		append_string(output, hit.url);
+		append_string(output, hit.anchor);
+		append_string(output, hit.snippet.before);
+		append_string(output, hit.snippet.match);
+		append_string(output, hit.snippet.after);
+	}
+
+	return output;
+}
+
+auto crawler::decode_response(std::string_view payload) -> std::optional<shard_response_t> {
+	auto in = binary_reader{payload};
+
+	if (!in.expect_magic("HITS")) {
+		return std::nullopt;
+	}
+
+	shard_response_t output{};
+	output.search_time = std::chrono::microseconds{in.read_u32()};
+	const uint32_t count = in.read_u32();
+
+	for (uint32_t i = 0; i != count && !in.failed; ++i) {
+		auto & hit = output.hits.emplace_back();
+		hit.score = std::bit_cast<double>(in.read_u64());
+		hit.url = read_sized(in);
+		hit.anchor = read_sized(in);
+		hit.snippet.before = read_sized(in);
+		hit.snippet.match = read_sized(in);
+		hit.snippet.after = read_sized(in);
+	}
+
+	if (in.failed) {
+		return std::nullopt;
+	}
+
+	return output;
+}
+
+auto crawler::encode_page(const shard_page_t & page) -> std::string {
+	std::string output = "PAGE";
+	append_string(output, page.url);
+	append_string(output, page.text);
+	append_le(output, static_cast<uint32_t>(page.targets.size()));
+
+	for (const shard_target_t & target: page.targets) {
+		append_le(output, target.position);
+		append_string(output, target.name);
+	}
+
+	return output;
+}
+
+auto crawler::decode_page(std::string_view payload) -> std::optional<shard_page_t> {
+	auto in = binary_reader{payload};
+
+	if (!in.expect_magic("PAGE")) {
+		return std::nullopt;
+	}
+
+	shard_page_t output{};
+	output.url = read_sized(in);
+	output.text = read_sized(in);
+	const uint32_t count = in.read_u32();
+
+	for (uint32_t i = 0; i != count && !in.failed; ++i) {
+		auto & target = output.targets.emplace_back();
+		target.position = in.read_u32();
+		target.name = read_sized(in);
+	}
+
+	if (in.failed) {
+		return std::nullopt;
+	}
+
+	return output;
+}
+
+auto crawler::encode_stats(const shard_stats_t & stats) -> std::string {
+	std::string output = "STAT";
+	append_le(output, static_cast<uint32_t>(stats.size()));
+
+	for (const auto & [name, value]: stats) {
+		append_string(output, name);
+		append_le(output, value);
+	}
+
+	return output;
+}
+
+auto crawler::decode_stats(std::string_view payload) -> std::optional<shard_stats_t> {
+	auto in = binary_reader{payload};
+
+	if (!in.expect_magic("STAT")) {
+		return std::nullopt;
+	}
+
+	shard_stats_t output{};
+	const uint32_t count = in.read_u32();
+
+	for (uint32_t i = 0; i != count && !in.failed; ++i) {
+		auto name = read_sized(in);
+		output.emplace_back(std::move(name), in.read_u64());
+	}
+
+	if (in.failed) {
+		return std::nullopt;
+	}
+
+	return output;
+}
+
+auto crawler::encode_completion_request(const shard_request_t & request) -> std::string {
+	std::string output = "CMPL";
+	append_le(output, request.limit);
+	append_string(output, request.query);
+	return output;
+}
+
+auto crawler::decode_completion_request(std::string_view payload) -> std::optional<shard_request_t> {
+	auto in = binary_reader{payload};
+
+	if (!in.expect_magic("CMPL")) {
+		return std::nullopt;
+	}
+
+	shard_request_t output{};
+	output.limit = in.read_u32();
+	output.query = read_sized(in);
+
+	if (in.failed) {
+		return std::nullopt;
+	}
+
+	return output;
+}
+
+auto crawler::encode_completions(const shard_completions_t & completions) -> std::string {
+	std::string output = "SUGG";
+	append_le(output, static_cast<uint32_t>(completions.size()));
+
+	for (const auto & [term, score]: completions) {
+		append_string(output, term);
+		append_le(output, score);
+	}
+
+	return output;
+}
+
+auto crawler::decode_completions(std::string_view payload) -> std::optional<shard_completions_t> {
+	auto in = binary_reader{payload};
+
+	if (!in.expect_magic("SUGG")) {
+		return std::nullopt;
+	}
+
+	shard_completions_t output{};
+	const uint32_t count = in.read_u32();
+
+	for (uint32_t i = 0; i != count && !in.failed; ++i) {
+		auto term = read_sized(in);
+		output.emplace_back(std::move(term), in.read_u32());
+	}
+
+	if (in.failed) {
+		return std::nullopt;
+	}
+
+	return output;
+}
+
+// until `fd` is ready for `events` (errno is ETIMEDOUT when the deadline passes first)
+static bool wait_for(int fd, short events, crawler::deadline_t deadline) {
+	if (!deadline) {
+		return true;
+	}
+
+	for (;;) {
+		const auto left = std::chrono::ceil<std::chrono::milliseconds>(*deadline - std::chrono::steady_clock::now());
+
+		if (left.count() <= 0) {
+			errno = ETIMEDOUT;
+			return false;
+		}
+
+		pollfd item{.fd = fd, .events = events, .revents = 0};
+		const int ready = ::poll(&item, 1, static_cast<int>(std::min<std::chrono::milliseconds::rep>(left.count(), std::numeric_limits<int>::max())));
+
+		if (ready > 0) {
+			return true;
+		}
+		if (ready < 0 && errno != EINTR) {
+			return false;
+		}
+	}
+}
+
+static bool write_all(int fd, const char * data, size_t size, crawler::deadline_t deadline) {
+	while (size > 0) {
+		if (!wait_for(fd, POLLOUT, deadline)) {
+			return false;
+		}
+		const ssize_t written = ::send(fd, data, size, MSG_NOSIGNAL);
+		if (written < 0 && errno == EINTR) {
+			continue;
+		}
+		if (written <= 0) {
+			return false;
+		}
+		data += written;
+		size -= static_cast<size_t>(written);
+	}
+	return true;
+}
+
+static bool read_all(int fd, char * data, size_t size, crawler::deadline_t deadline) {
+	while (size > 0) {
+		if (!wait_for(fd, POLLIN, deadline)) {
+			return false;
+		}
+		const ssize_t got = ::recv(fd, data, size, 0);
+		if (got < 0 && errno == EINTR) {
+			continue;
+		}
+		if (got <= 0) {
+			return false;
+		}
+		data += got;
+		size -= static_cast<size_t>(got);
+	}
+	return true;
+}
+
+bool crawler::send_message(int fd, std::string_view payload, deadline_t deadline) {
+	if (payload.size() > max_message_size) {
+		errno = EMSGSIZE;
+		return false;
+	}
+
+	std::string header;
+	append_le(header, static_cast<uint32_t>(payload.size()));
+	return write_all(fd, header.data(), header.size(), deadline) && write_all(fd, payload.data(), payload.size(), deadline);
+}
+
+auto crawler::receive_message(int fd, deadline_t deadline) -> std::optional<std::string> {
+	std::array<char, 4> header;
+
+	if (!read_all(fd, header.data(), header.size(), deadline)) {
+		return std::nullopt;
+	}
+
+	const uint32_t length = binary_reader{header}.read_u32();
+
+	if (length > max_message_size) {
+		errno = EMSGSIZE;
+		return std::nullopt;
+	}
+
+	std::string output;
+	output.resize(length);
+
+	if (!read_all(fd, output.data(), output.size(), deadline)) {
+		return std::nullopt;
+	}
+
+	return output;
+}
+
+static auto make_address(const std::filesystem::path & path) -> std::optional<sockaddr_un> {
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+
+	const auto & name = path.native();
+
+	if (name.size() >= sizeof(address.sun_path)) {
+		std::cerr << "socket path is too long: " << path << "\n";
+		return std::nullopt;
+	}
+
+	std::ranges::copy(name, address.sun_path);
+	return address;
+}
+
+int crawler::listen_unix(const std::filesystem::path & path) {
+	const auto address = make_address(path);
+
+	if (!address) {
+		return -1;
+	}
+
+	const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+	if (fd < 0) {
+		std::cerr << "can't create socket: " << std::strerror(errno) << "\n";
+		return -1;
+	}
+
+	// socket of previous run
+	::unlink(path.c_str());
+
+	if (::bind(fd, reinterpret_cast<const sockaddr *>(&*address), sizeof(sockaddr_un)) != 0 || ::listen(fd, 64) != 0) {
+		std::cerr << "can't listen on " << path << ": " << std::strerror(errno) << "\n";
+		::close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+int crawler::connect_unix(const std::filesystem::path & path, deadline_t deadline) {
+	const auto address = make_address(path);
+
+	if (!address) {
+		return -1;
+	}
+
+	const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+	if (fd < 0) {
+		std::cerr << "can't create socket: " << std::strerror(errno) << "\n";
+		return -1;
+	}
+
+	// connect to a unix socket waits only when the backlog of the listener is full, for at most SO_SNDTIMEO
+	if (deadline) {
+		const auto left = std::chrono::ceil<std::chrono::microseconds>(*deadline - std::chrono::steady_clock::now());
+		const auto wait = std::max(left, std::chrono::microseconds{1});
+		const timeval timeout{.tv_sec = static_cast<time_t>(wait.count() / 1'000'000), .tv_usec = static_cast<suseconds_t>(wait.count() % 1'000'000)};
+		::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+	}
+
+	if (::connect(fd, reinterpret_cast<const sockaddr *>(&*address), sizeof(sockaddr_un)) != 0) {
+		if (errno == EAGAIN) {
+			errno = ETIMEDOUT;
+		}
+		std::cerr << "can't connect to " << path << ": " << std::strerror(errno) << "\n";
+		const int error = errno;
+		::close(fd);
+		errno = error;
+		return -1;
+	}
+
+	return fd;
+}
+
+static auto ask_shard(const std::filesystem::path & shard, std::string_view request, std::chrono::milliseconds timeout) -> crawler::shard_result_t {
+	crawler::shard_result_t output{.shard = shard};
+
+	const auto start = std::chrono::steady_clock::now();
+	const auto deadline = start + timeout;
+	const int fd = crawler::connect_unix(shard, deadline);
+
+	if (fd >= 0) {
+		if (crawler::send_message(fd, request, deadline)) {
+			if (const auto payload = crawler::receive_message(fd, deadline)) {
+				output.response = crawler::decode_response(*payload);
+			}
+		}
+		output.timed_out = !output.response && errno == ETIMEDOUT;
+		::close(fd);
+	} else {
+		output.timed_out = (errno == ETIMEDOUT);
+	}
+
+	output.latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+	return output;
+}
+
+auto crawler::scatter(std::span<const std::filesystem::path> shards, const shard_request_t & request, std::chrono::milliseconds timeout) -> std::vector<shard_result_t> {
+	const auto payload = encode_request(request);
+
+	std::vector<shard_result_t> output(shards.size());
+
+	{
+		std::vector<std::jthread> threads;
+		threads.reserve(shards.size());
+
+		for (size_t i = 0; i != shards.size(); ++i) {
+			threads.emplace_back([&, i] { output[i] = ask_shard(shards[i], payload, timeout); });
+		}
+	}
+
+	return output;
+}
+
+auto crawler::collect_stats(std::span<const std::filesystem::path> shards, std::chrono::milliseconds timeout) -> std::vector<std::optional<shard_stats_t>> {
+	std::vector<std::optional<shard_stats_t>> output;
+
+	for (const auto & shard: shards) {
+		auto & stats = output.emplace_back();
+		const auto deadline = std::chrono::steady_clock::now() + timeout;
+		const int fd = connect_unix(shard, deadline);
+
+		if (fd < 0) {
+			continue;
+		}
+
+		if (send_message(fd, "STAT", deadline)) {
+			if (const auto payload = receive_message(fd, deadline)) {
+				stats = decode_stats(*payload);
+			}
+		}
+
+		::close(fd);
+	}
+
+	return output;
+}
+
+auto crawler::collect_completions(std::span<const std::filesystem::path> shards, const shard_request_t & request, std::chrono::milliseconds timeout) -> shard_completions_t {
+	const auto payload = encode_completion_request(request);
+	const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+	std::vector<std::optional<shard_completions_t>> answers(shards.size());
+
+	{
+		std::vector<std::jthread> threads;
+		threads.reserve(shards.size());
+
+		for (size_t i = 0; i != shards.size(); ++i) {
+			threads.emplace_back([&, i] {
+				const int fd = connect_unix(shards[i], deadline);
+
+				if (fd < 0) {
+					return;
+				}
+
+				if (send_message(fd, payload, deadline)) {
+					if (const auto reply = receive_message(fd, deadline)) {
+						answers[i] = decode_completions(*reply);
+					}
+				}
+
+				::close(fd);
+			});
+		}
+	}
+
+	shard_completions_t output;
+
+	for (const auto & answer: answers) {
+		if (!answer) {
+			continue;
+		}
+
+		for (const auto & [term, score]: *answer) {
+			const auto it = std::ranges::find(output, term, [](const auto & item) -> const std::string & { return item.first; });
+			if (it != output.end()) {
+				it->second += score;
+			} else {
+				output.emplace_back(term, score);
+			}
+		}
+	}
+
+	std::ranges::sort(output, [](const auto & lhs, const auto & rhs) { return std::tie(rhs.second, lhs.first) < std::tie(lhs.second, rhs.first); });
+
+	if (output.size() > request.limit) {
+		output.resize(request.limit);
+	}
+
+	return output;
+}
+
+auto crawler::gather(std::span<const shard_result_t> results, size_t limit) -> std::vector<shard_hit_t> {
+	std::vector<shard_hit_t> output;
+
+	for (const shard_result_t & result: results) {
+		if (result.response) {
+			std::ranges::copy(result.response->hits, std::back_inserter(output));
+		}
+	}
+
+	// every shard sends its hits already sorted, but there are only few of them
+	std::ranges::stable_sort(output, std::greater<>{}, &shard_hit_t::score);
+
+	if (output.size() > limit) {
+		output.resize(limit);
+	}
+
+	return output;
+}
+
+auto crawler::page_sink::connect(const std::filesystem::path & path) -> std::optional<page_sink> {
+	const int fd = connect_unix(path);
+
+	if (fd < 0) {
+		return std::nullopt;
+	}
+
+	return page_sink{fd};
+}
+
+crawler::page_sink::~page_sink() noexcept {
+	if (fd >= 0) {
+		::close(fd);
+	}
+}
+
+bool crawler::page_sink::send(const shard_page_t & page) {
+	if (fd < 0) {
+		return false;
+	}
+
+	if (send_message(fd, encode_page(page))) {
+		if (const auto reply = receive_message(fd); reply && *reply == "DONE") {
+			return true;
+		}
+	}
+
+	::close(fd);
+	fd = -1;
+	return false;
+}
@@ -0,0 +1,160 @@
+#ifndef CRAWLER_SHARD_HPP
+#define CRAWLER_SHARD_HPP
+
+#include "document-store.hpp"
+#include <chrono>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <cstdint>
+
+namespace crawler {
+
+// Scatter-gather over local processes: every `search-shard` serves one document-partitioned index
+// on a unix socket, `search --shard=PATH ...` sends the query to all of them at once and merges
+// their top-k. Shards score with their own statistics (idf, average length), which is close
+// enough to global ones when documents are split between shards without bias.
+//
+// every message is u32(length) payload (all numbers little-endian)
+// request:  "QURY" u32(limit) u32(length) query
+// response: "HITS" u32(microseconds spent in search) u32(count)
+//           [u64(score as double bits) u32(length) url u32(length) anchor
+//            u32(length) before u32(length) match u32(length) after]*count
+//
+// `search-shard --live` also takes new pages (see crawler/live-index.hpp) from `build-index --live=PATH`:
+// request:  "PAGE" u32(length) url u32(length) plain text u32(count) [u32(position) u32(length) target]*count
+// response: "DONE"
+//
+// counters of the shard (cache hit rates...):
+// request:  "STAT"
+// response: "STAT" u32(count) [u32(length) name u64(value)]*count
+//
+// completions of a prefix (see crawler/completion-table.hpp):
+// request:  "CMPL" u32(limit) u32(length) prefix
+// response: "SUGG" u32(count) [u32(length) term u32(score)]*count
+
+struct shard_hit_t {
+	double score{0.0};
+	std::string url{};
+	std::string anchor{};
+	snippet_t snippet{};
+};
+
+struct shard_request_t {
+	std::string query{};
+	uint32_t limit{0};
+};
+
+struct shard_target_t {
+	uint32_t position{0};
+	std::string name{};
+};
+
+struct shard_page_t {
+	std::string url{};
+	std::string text{}; // as produced by convert_to_plain_text
+	std::vector<shard_target_t> targets{};
+};
+
+struct shard_response_t {
+	std::vector<shard_hit_t> hits{};
+	std::chrono::microseconds search_time{0};
+};
+
+auto encode_request(const shard_request_t & request) -> std::string;
+auto decode_request(std::string_view payload) -> std::optional<shard_request_t>;
+
+auto encode_response(const shard_response_t & response) -> std::string;
+auto decode_response(std::string_view payload) -> std::optional<shard_response_t>;
+
+auto encode_page(const shard_page_t & page) -> std::string;
+auto decode_page(std::string_view payload) -> std::optional<shard_page_t>;
+
+using shard_stats_t = std::vector<std::pair<std::string, uint64_t>>;
+
+auto encode_stats(const shard_stats_t & stats) -> std::string;
+auto decode_stats(std::string_view payload) -> std::optional<shard_stats_t>;
+
+// `query` of the request is the prefix
+auto encode_completion_request(const shard_request_t & request) -> std::string;
+auto decode_completion_request(std::string_view payload) -> std::optional<shard_request_t>;
+
+using shard_completions_t = std::vector<std::pair<std::string, uint32_t>>;
+
+auto encode_completions(const shard_completions_t & completions) -> std::string;
+auto decode_completions(std::string_view payload) -> std::optional<shard_completions_t>;
+
+// kind of request (its magic)
+inline auto message_kind(std::string_view payload) noexcept -> std::string_view {
+	return payload.substr(0, 4);
+}
+
+// length prefix of anything longer is a broken or hostile peer, not a reason to allocate 4 GiB
+static constexpr uint32_t max_message_size = 64u << 20u;
+
+// no deadline waits as long as the peer is there
+using deadline_t = std::optional<std::chrono::steady_clock::time_point>;
+
+// how long a shard has to answer when `search` doesn't say otherwise
+static constexpr auto default_shard_timeout = std::chrono::milliseconds{2000};
+
+// blocking framing over a stream socket (false / std::nullopt when peer is gone, the message is
+// longer than `max_message_size` (errno is EMSGSIZE) or the deadline passed (errno is ETIMEDOUT))
+bool send_message(int fd, std::string_view payload, deadline_t deadline = std::nullopt);
+auto receive_message(int fd, deadline_t deadline = std::nullopt) -> std::optional<std::string>;
+
+// -1 if it fails (reason is printed)
+int listen_unix(const std::filesystem::path & path);
+int connect_unix(const std::filesystem::path & path, deadline_t deadline = std::nullopt);
+
+struct shard_result_t {
+	std::filesystem::path shard{};
+	std::optional<shard_response_t> response{}; // std::nullopt if the shard didn't answer
+	std::chrono::microseconds latency{0};		 // from connect to the last byte of response
+	bool timed_out{false};						 // shard was too slow, not gone
+};
+
+// sends the request to all shards in parallel and waits for all of them, but at most `timeout`
+auto scatter(std::span<const std::filesystem::path> shards, const shard_request_t & request, std::chrono::milliseconds timeout = default_shard_timeout) -> std::vector<shard_result_t>;
+
+// counters of every shard (std::nullopt for those which didn't answer in `timeout`)
+auto collect_stats(std::span<const std::filesystem::path> shards, std::chrono::milliseconds timeout = default_shard_timeout) -> std::vector<std::optional<shard_stats_t>>;
+
+// best `limit` completions of all shards which answered in `timeout`, scores of same term are added
+auto collect_completions(std::span<const std::filesystem::path> shards, const shard_request_t & request, std::chrono::milliseconds timeout = default_shard_timeout) -> shard_completions_t;
+
+// best `limit` hits of all answered shards
+auto gather(std::span<const shard_result_t> results, size_t limit) -> std::vector<shard_hit_t>;
+
+// connection to `search-shard --live`, pages are sent one by one as they are crawled
+class page_sink {
+	int fd{-1};
+
+	explicit page_sink(int f) noexcept: fd{f} { }
+
+public:
+	static auto connect(const std::filesystem::path & path) -> std::optional<page_sink>;
+
+	page_sink(page_sink && other) noexcept: fd{std::exchange(other.fd, -1)} { }
+	page_sink(const page_sink &) = delete;
+	page_sink & operator=(page_sink && other) noexcept {
+		std::swap(fd, other.fd);
+		return *this;
+	}
+	~page_sink() noexcept;
+
+	explicit operator bool() const noexcept {
+		return fd >= 0;
+	}
+
+	// waits until the page is searchable, false if the shard is gone (then nothing else is sent)
+	bool send(const shard_page_t & page);
+};
+
+} // namespace crawler
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef CRAWLER_SNAPSHOT_HPP
+#define CRAWLER_SNAPSHOT_HPP
+
+#include <atomic>
+#include <memory>
+
+namespace crawler {
+
+// Handle of an immutable index in a long running server. Every query takes the current snapshot
+// (reference counted) and keeps it until it's done, a new index is loaded and warmed next to it
+// and swapped in at once. The old one is released (unmapped) by whichever query ends last with it,
+// so nothing waits for a lock and no query sees half of old and half of new index.
+template <typename T> class snapshot_handle {
+	std::atomic<std::shared_ptr<const T>> current{};
+
+public:
+	snapshot_handle() = default;
+	explicit snapshot_handle(std::shared_ptr<const T> initial) noexcept: current{std::move(initial)} { }
+
+	snapshot_handle(const snapshot_handle &) = delete;
+	snapshot_handle & operator=(const snapshot_handle &) = delete;
+
+	auto get() const noexcept -> std::shared_ptr<const T> {
+		return current.load(std::memory_order_acquire);
+	}
+
+	// returns previous snapshot (it lives while someone still has it)
+	auto replace(std::shared_ptr<const T> next) noexcept -> std::shared_ptr<const T> {
+		return current.exchange(std::move(next), std::memory_order_acq_rel);
+	}
+};
+
+} // namespace crawler
+
+#endif
@@ -138,9 +138,8 @@ bool ignore_tag_content(std::string_view name) {
 		return true;
 	} else if (name == "svg") {
 		return true;
-	} else if (name == "img") {
-		return true;
 	} else {
+		// <img> is a void element, looking for its </img> swallowed rest of the page
 		return false;
 	}
 }
@@ -208,7 +207,9 @@ template <typename Attribute> auto skip_tag_or_comment_inner(std::string_view::i
 
 	constexpr auto is_unqouted_value_char = [&](char c) {
 		// TODO make it table
-		if (c == '"') {
+		if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+			return false;
+		} else if (c == '"') {
 			return false;
 		} else if (c == '\'') {
 			return false;
@@ -231,10 +232,10 @@ template <typename Attribute> auto skip_tag_or_comment_inner(std::string_view::i
 		}
 
 		const char c = *it;
-		++it;
 
 		if (c == '"' || c == '\'') {
-			// unquoted
+			// quoted
+			++it;
 			const auto value_begin = it;
 			while (it != end && *it != c) {
 				++it;
@@ -526,6 +527,14 @@ std::string_view crawler::convert_to_plain_text(std::string_view input, std::spa
 	return std::string_view(output.data(), (size_t)std::distance(output.begin(), out));
 }
 
+constexpr bool is_target_attribute(std::string_view tag, std::string_view key) noexcept {
+	return (tag == "div" || tag == "span" || tag == "li") && key == "id";
+}
+
+constexpr bool is_link_attribute(std::string_view key) noexcept {
+	return key == "href" || key == "src" || key == "data-src" || key == "data-original";
+}
+
 std::string_view crawler::convert_to_plain_text(std::string_view input, std::span<char> output, std::function<void(size_t, std::string_view)> target) {
 	auto out = output.begin();
 
@@ -535,8 +544,31 @@ std::string_view crawler::convert_to_plain_text(std::string_view input, std::spa
 	};
 
 	const auto attribute_callback = [&out, beg = output.begin(), &target](std::string_view tag, std::string_view key, std::string_view value) {
-		if ((tag == "div" || tag == "span" || tag == "li") && key == "id") {
+		if (is_target_attribute(tag, key)) {
+			target(static_cast<size_t>(std::distance(beg, out)), value);
+		}
+	};
+
+	assert(input.size() <= output.size());
+
+	convert_to_plain_text_ex(input, insert_character, attribute_callback);
+
+	return std::string_view(output.data(), (size_t)std::distance(output.begin(), out));
+}
+
+std::string_view crawler::convert_to_plain_text(std::string_view input, std::span<char> output, std::function<void(size_t, std::string_view)> target, std::function<void(std::string_view)> link) {
+	auto out = output.begin();
+
+	const auto insert_character = [&out, end = output.end()](char c) {
+		assert(out < end);
+		*out++ = c;
+	};
+
+	const auto attribute_callback = [&out, beg = output.begin(), &target, &link](std::string_view tag, std::string_view key, std::string_view value) {
+		if (is_target_attribute(tag, key)) {
 			target(static_cast<size_t>(std::distance(beg, out)), value);
+		} else if (is_link_attribute(key)) {
+			link(value);
 		}
 	};
 
@@ -558,7 +590,7 @@ std::vector<crawler::id_and_text> crawler::convert_to_plain_text_by_nearest_anch
 	};
 
 	const auto attribute_callback = [&output](std::string_view tag, std::string_view key, std::string_view value) {
-		if ((tag == "div" || tag == "span" || tag == "li") && key == "id") {
+		if (is_target_attribute(tag, key)) {
 			output.emplace_back(id_and_text{.id = std::string(value), .text = ""});
 		}
 	};
@@ -583,3 +615,11 @@ std::string crawler::convert_to_plain_text(std::string && mutable_input_output,
 	mutable_input_output.resize(result.size());
 	return std::move(mutable_input_output);
 }
+
+std::string crawler::convert_to_plain_text(std::string && mutable_input_output, std::function<void(size_t, std::string_view)> target, std::function<void(std::string_view)> link) {
+	const auto result = convert_to_plain_text(mutable_input_output, mutable_input_output, target, link);
+	// changed output was written into the string, so I can just resize it based on the size
+	assert(result.size() <= mutable_input_output.size());
+	mutable_input_output.resize(result.size());
+	return std::move(mutable_input_output);
+}
@@ -16,6 +16,12 @@ std::string_view convert_to_plain_text(std::string_view input, std::span<char> o
 std::string convert_to_plain_text(std::string && mutable_input_output);
 std::string convert_to_plain_text(std::string && mutable_input_output, std::function<void(size_t, std::string_view)> target);
 
+// one pass for everything crawler needs from html: plain text, anchor targets (as above) and values
+// of href/src/data-src/data-original attributes (in order of appearance)
+// when converting in place the link value is overwritten later, so it's valid only inside the callback
+std::string_view convert_to_plain_text(std::string_view input, std::span<char> output, std::function<void(size_t, std::string_view)> target, std::function<void(std::string_view)> link);
+std::string convert_to_plain_text(std::string && mutable_input_output, std::function<void(size_t, std::string_view)> target, std::function<void(std::string_view)> link);
+
 struct id_and_text {
 	std::string id;
 	std::string text;
@@ -0,0 +1,114 @@
+#include "target-table.hpp"
+#include "binary.hpp"
+#include <iostream>
+
+auto crawler::target_table::open(const std::filesystem::path & name) -> std::optional<target_table> {
+	auto file = mapped_file::open(name);
+
+	if (!file) {
+		std::cerr << "can't open file: " << name << "\n";
+		return std::nullopt;
+	}
+
+	auto in = binary_reader{file->data()};
+
+	if (!in.expect_magic("TRGT") || in.read_u32() != 1) {
+		std::cerr << "unsupported target table: " << name << "\n";
+		return std::nullopt;
+	}
+
+	target_table output{};
+	output.count = in.read_u32();
+	const uint32_t total = in.read_u32();
+	output.strings = in.read_u32();
+
+	output.first_target = in.read_bytes((size_t{output.count} + 1u) * sizeof(uint32_t));
+	output.positions = in.read_bytes(size_t{total} * sizeof(uint32_t));
+	output.string_ids = in.read_bytes(size_t{total} * sizeof(uint32_t));
+	output.string_offsets = in.read_bytes((size_t{output.strings} + 1u) * sizeof(uint32_t));
+
+	if (in.failed || u32_at(output.first_target, output.count) != total) {
+		std::cerr << "truncated target table: " << name << "\n";
+		return std::nullopt;
+	}
+
+	output.pool = file->data().subspan(in.offset);
+
+	if (u32_at(output.string_offsets, output.strings) > output.pool.size()) {
+		std::cerr << "truncated target table: " << name << "\n";
+		return std::nullopt;
+	}
+
+	// checked once here, so lookups can subtract neighbouring offsets
+	if (!monotonic_offsets(output.first_target, output.count) || !monotonic_offsets(output.string_offsets, output.strings)) {
+		std::cerr << "corrupted target table: " << name << "\n";
+		return std::nullopt;
+	}
+
+	output.file = std::move(*file);
+
+	return output;
+}
+
+auto crawler::target_table::string_at(uint32_t id) const noexcept -> std::string_view {
+	if (id >= strings) {
+		return {};
+	}
+
+	const uint32_t from = u32_at(string_offsets, id);
+	const uint32_t to = u32_at(string_offsets, id + 1u);
+
+	return std::string_view(pool.data() + from, to - from);
+}
+
+uint32_t crawler::target_table::targets_of(uint32_t id) const noexcept {
+	if (id >= count) {
+		return 0;
+	}
+	return u32_at(first_target, id + 1u) - u32_at(first_target, id);
+}
+
+auto crawler::target_table::nearest_target(uint32_t id, uint32_t position) const noexcept -> std::optional<target_hit_t> {
+	if (id >= count) {
+		return std::nullopt;
+	}
+
+	// upper bound of `position` in positions[first, last)
+	uint32_t first = u32_at(first_target, id);
+	uint32_t length = u32_at(first_target, id + 1u) - first;
+	const uint32_t begin = first;
+
+	while (length > 0) {
+		const uint32_t half = length / 2u;
+		if (u32_at(positions, first + half) <= position) {
+			first += half + 1u;
+			length -= half + 1u;
+		} else {
+			length = half;
+		}
+	}
+
+	if (first == begin) {
+		return std::nullopt;
+	}
+
+	return target_hit_t{.position = u32_at(positions, first - 1u), .target = string_at(u32_at(string_ids, first - 1u))};
+}
+
+auto crawler::target_table::all_targets(uint32_t id) const -> std::vector<target_hit_t> {
+	if (id >= count) {
+		return {};
+	}
+
+	const uint32_t first = u32_at(first_target, id);
+	const uint32_t last = u32_at(first_target, id + 1u);
+
+	std::vector<target_hit_t> output;
+	output.reserve(last - first);
+
+	for (uint32_t i = first; i != last; ++i) {
+		output.push_back(target_hit_t{.position = u32_at(positions, i), .target = string_at(u32_at(string_ids, i))});
+	}
+
+	return output;
+}
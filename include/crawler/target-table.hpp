@@ -0,0 +1,62 @@
+#ifndef CRAWLER_TARGET_TABLE_HPP
+#define CRAWLER_TARGET_TABLE_HPP
+
+#include "mapped-file.hpp"
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace crawler {
+
+// Link targets (html ids) of all documents in one file written by `index_t::save_documents_targets`.
+// Positions of a document are one sorted slice of the position column, so the anchor a hit
+// belongs to is found by binary search without touching other documents.
+
+struct target_hit_t {
+	uint32_t position;
+	std::string_view target;
+};
+
+class target_table {
+	mapped_file file{};
+	std::span<const char> first_target{};
+	std::span<const char> positions{};
+	std::span<const char> string_ids{};
+	std::span<const char> string_offsets{};
+	std::span<const char> pool{};
+	uint32_t count{0};
+	uint32_t strings{0};
+
+	auto string_at(uint32_t id) const noexcept -> std::string_view;
+
+public:
+	static auto open(const std::filesystem::path & name) -> std::optional<target_table>;
+
+	uint32_t documents() const noexcept {
+		return count;
+	}
+
+	// different names of targets in all documents
+	uint32_t unique_targets() const noexcept {
+		return strings;
+	}
+
+	void will_need() const noexcept {
+		file.will_need();
+	}
+
+	uint32_t targets_of(uint32_t id) const noexcept;
+
+	// all targets of the document (sorted by position)
+	auto all_targets(uint32_t id) const -> std::vector<target_hit_t>;
+
+	// the closest target at or before `position`, std::nullopt if the position is before the first one
+	auto nearest_target(uint32_t id, uint32_t position) const noexcept -> std::optional<target_hit_t>;
+};
+
+} // namespace crawler
+
+#endif
@@ -0,0 +1,135 @@
+#include "url-dictionary.hpp"
+#include "binary.hpp"
+#include "varint.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+void crawler::save_url_dictionary(const std::filesystem::path & name, std::span<const std::string_view> urls) {
+	auto of = std::ofstream{name, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc};
+
+	if (!of) {
+		std::cerr << "can't open file: " << name << "\n";
+		return;
+	}
+
+	std::string data;
+	std::vector<uint32_t> offsets;
+
+	for (size_t i = 0; i != urls.size(); ++i) {
+		const std::string_view url = urls[i];
+
+		if (i % url_block_size == 0) {
+			offsets.push_back(static_cast<uint32_t>(data.size()));
+			write_varint(data, url.size());
+			data.append(url);
+			continue;
+		}
+
+		const std::string_view previous = urls[i - 1u];
+		const auto shared = static_cast<size_t>(std::ranges::mismatch(url, previous).in1 - url.begin());
+
+		write_varint(data, shared);
+		write_varint(data, url.size() - shared);
+		data.append(url.substr(shared));
+	}
+	offsets.push_back(static_cast<uint32_t>(data.size()));
+
+	write_magic(of, "URLS");
+	write_u32(of, 1);
+	write_u32(of, static_cast<uint32_t>(urls.size()));
+	write_u32(of, url_block_size);
+
+	for (uint32_t offset: offsets) {
+		write_u32(of, offset);
+	}
+
+	of.write(data.data(), static_cast<std::streamsize>(data.size()));
+}
+
+auto crawler::url_dictionary::open(const std::filesystem::path & name) -> std::optional<url_dictionary> {
+	auto file = mapped_file::open(name);
+
+	if (!file) {
+		std::cerr << "can't open file: " << name << "\n";
+		return std::nullopt;
+	}
+
+	auto in = binary_reader{file->data()};
+
+	if (!in.expect_magic("URLS") || in.read_u32() != 1) {
+		std::cerr << "unsupported url dictionary: " << name << "\n";
+		return std::nullopt;
+	}
+
+	url_dictionary output{};
+	output.count = in.read_u32();
+	output.block_size = in.read_u32();
+
+	if (in.failed || output.block_size == 0) {
+		std::cerr << "truncated url dictionary: " << name << "\n";
+		return std::nullopt;
+	}
+
+	const size_t blocks = (size_t{output.count} + output.block_size - 1u) / output.block_size;
+	output.block_offset = in.read_bytes((blocks + 1u) * sizeof(uint32_t));
+
+	if (in.failed) {
+		std::cerr << "truncated url dictionary: " << name << "\n";
+		return std::nullopt;
+	}
+
+	output.data = file->data().subspan(in.offset);
+
+	if (u32_at(output.block_offset, blocks) > output.data.size()) {
+		std::cerr << "truncated url dictionary: " << name << "\n";
+		return std::nullopt;
+	}
+
+	// block is a range between neighbouring offsets, so they are checked once here
+	if (!monotonic_offsets(output.block_offset, blocks)) {
+		std::cerr << "corrupted url dictionary: " << name << "\n";
+		return std::nullopt;
+	}
+
+	output.file = std::move(*file);
+
+	return output;
+}
+
+auto crawler::url_dictionary::get(uint32_t id) const -> std::optional<std::string> {
+	if (id >= count) {
+		return std::nullopt;
+	}
+
+	const uint32_t block = id / block_size;
+	const uint32_t from = u32_at(block_offset, block);
+	const uint32_t to = u32_at(block_offset, block + 1u);
+
+	auto input = std::string_view(data.data() + from, to - from);
+
+	const auto first_length = read_varint(input);
+
+	if (!first_length || *first_length > input.size()) {
+		return std::nullopt;
+	}
+
+	std::string url{input.substr(0, *first_length)};
+	input.remove_prefix(*first_length);
+
+	for (uint32_t i = block * block_size; i != id; ++i) {
+		const auto shared = read_varint(input);
+		const auto length = read_varint(input);
+
+		if (!shared || !length || *shared > url.size() || *length > input.size()) {
+			return std::nullopt;
+		}
+
+		url.resize(*shared);
+		url.append(input.substr(0, *length));
+		input.remove_prefix(*length);
+	}
+
+	return url;
+}
@@ -0,0 +1,50 @@
+#ifndef CRAWLER_URL_DICTIONARY_HPP
+#define CRAWLER_URL_DICTIONARY_HPP
+
+#include "mapped-file.hpp"
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+namespace crawler {
+
+// URLs of documents front-coded in blocks: first URL of a block is stored whole, every next one
+// only as length of prefix shared with previous one and the rest. Most of them start with
+// "https://en.cppreference.com/w/cpp/" so it's a fraction of a plain list, and any id is
+// decoded from its block alone.
+
+static constexpr uint32_t url_block_size = 16;
+
+// "URLS" u32(version) u32(count) u32(block size)
+// u32(block offset)[block count + 1] (relative to start of data) data...
+// block: varint(length) url, then [varint(shared) varint(length) suffix]*(block size - 1)
+void save_url_dictionary(const std::filesystem::path & name, std::span<const std::string_view> urls);
+
+class url_dictionary {
+	mapped_file file{};
+	std::span<const char> block_offset{};
+	std::span<const char> data{};
+	uint32_t count{0};
+	uint32_t block_size{url_block_size};
+
+public:
+	static auto open(const std::filesystem::path & name) -> std::optional<url_dictionary>;
+
+	uint32_t size() const noexcept {
+		return count;
+	}
+
+	void will_need() const noexcept {
+		file.will_need();
+	}
+
+	// std::nullopt for unknown id or corrupted block
+	auto get(uint32_t id) const -> std::optional<std::string>;
+};
+
+} // namespace crawler
+
+#endif
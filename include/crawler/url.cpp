@@ -0,0 +1,209 @@
+#include "url.hpp"
+#include <algorithm>
+
+// anything else is escaped or rejected by libcurl, so it's left for it
+static constexpr bool is_plain_url_char(char c) noexcept {
+	if (c <= ' ' || c >= '\x7F') {
+		return false;
+	}
+	switch (c) {
+	case '\\':
+	case '"':
+	case '<':
+	case '>':
+	case '`':
+	case '{':
+	case '}':
+	case '|':
+	case '^': return false;
+	default: return true;
+	}
+}
+
+static constexpr bool is_host_char(char c) noexcept {
+	return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '.' || c == '-';
+}
+
+static constexpr bool equal_ignoring_case(std::string_view lhs, std::string_view rhs) noexcept {
+	return std::ranges::equal(lhs, rhs, [](char l, char r) { return (l | 0x20) == (r | 0x20); });
+}
+
+// scheme of `link` if it has one ("foo:bar" before first '/')
+static constexpr auto scheme_of(std::string_view link) noexcept -> std::optional<std::string_view> {
+	const auto colon = link.find(':');
+
+	if (colon == std::string_view::npos || colon == 0) {
+		return std::nullopt;
+	}
+
+	const auto scheme = link.substr(0, colon);
+
+	const auto is_scheme_char = [](char c) {
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '+' || c == '-' || c == '.';
+	};
+
+	if (!std::ranges::all_of(scheme, is_scheme_char) || !((scheme[0] | 0x20) >= 'a' && (scheme[0] | 0x20) <= 'z')) {
+		return std::nullopt;
+	}
+
+	return scheme;
+}
+
+// "host" or "host:port", returns length of the host part (0 if it isn't simple)
+static constexpr size_t simple_authority(std::string_view authority) noexcept {
+	const auto colon = authority.find(':');
+	const auto host = authority.substr(0, colon);
+
+	if (host.empty() || host.front() == '.' || host.front() == '-' || host.back() == '-' || host.find("..") != std::string_view::npos || !std::ranges::all_of(host, is_host_char)) {
+		return 0;
+	}
+
+	if (colon != std::string_view::npos) {
+		const auto port = authority.substr(colon + 1u);
+		if (port.empty() || port.size() > 5u || !std::ranges::all_of(port, [](char c) { return c >= '0' && c <= '9'; })) {
+			return 0;
+		}
+	}
+
+	return host.size();
+}
+
+// RFC 3986 5.2.4 on path in buffer[start, end) which starts with '/', in place as output is never longer than input
+static void remove_dot_segments(std::string & buffer, size_t start) {
+	const size_t end = buffer.size();
+	size_t read = start;
+	size_t write = start;
+
+	while (read < end) {
+		const size_t next = std::min(buffer.find('/', read + 1u), end);
+		const auto segment = std::string_view(buffer).substr(read + 1u, next - read - 1u);
+		const bool last = (next == end);
+
+		if (segment == ".") {
+			if (last) {
+				buffer[write++] = '/';
+			}
+		} else if (segment == "..") {
+			const auto slash = std::string_view(buffer).substr(start, write - start).rfind('/');
+			write = (slash == std::string_view::npos) ? start : start + slash;
+			if (last) {
+				buffer[write++] = '/';
+			}
+		} else {
+			// write <= read, so copying forward is fine
+			buffer[write++] = '/';
+			std::copy(segment.begin(), segment.end(), buffer.begin() + static_cast<std::ptrdiff_t>(write));
+			write += segment.size();
+		}
+
+		read = next;
+	}
+
+	buffer.resize(write);
+
+	if (buffer.size() == start) {
+		buffer.push_back('/');
+	}
+}
+
+auto crawler::base_url::parse(std::string_view url) -> std::optional<base_url> {
+	url = url.substr(0, url.find_first_of("?#"));
+
+	if (!std::ranges::all_of(url, is_plain_url_char)) {
+		return std::nullopt;
+	}
+
+	const auto scheme = scheme_of(url);
+
+	if (!scheme || !(equal_ignoring_case(*scheme, "http") || equal_ignoring_case(*scheme, "https"))) {
+		return std::nullopt;
+	}
+
+	auto rest = url.substr(scheme->size() + 1u);
+
+	if (!rest.starts_with("//")) {
+		return std::nullopt;
+	}
+
+	rest.remove_prefix(2);
+
+	const auto authority = rest.substr(0, rest.find('/'));
+	const size_t host_length = simple_authority(authority);
+
+	if (host_length == 0) {
+		return std::nullopt;
+	}
+
+	base_url output{};
+	output.scheme = (scheme->size() == 5u) ? "https" : "http";
+	output.authority = authority;
+	output.host_length = host_length;
+	output.path = rest.substr(authority.size());
+	remove_dot_segments(output.path, 0);
+
+	return output;
+}
+
+auto crawler::base_url::resolve(std::string_view link, std::string & buffer) const -> std::pair<resolve_status, url_view> {
+	link = link.substr(0, link.find_first_of("?#"));
+
+	if (!std::ranges::all_of(link, is_plain_url_char)) {
+		return {resolve_status::fallback, {}};
+	}
+
+	std::string_view link_scheme = scheme;
+	std::string_view link_authority = authority;
+	size_t link_host_length = host_length;
+
+	if (const auto other = scheme_of(link)) {
+		if (equal_ignoring_case(*other, "https")) {
+			link_scheme = "https";
+		} else if (equal_ignoring_case(*other, "http")) {
+			link_scheme = (scheme == "https") ? "https" : "http";
+		} else {
+			return {resolve_status::rejected, {}};
+		}
+
+		link.remove_prefix(other->size() + 1u);
+
+		if (!link.starts_with("//")) {
+			return {resolve_status::fallback, {}};
+		}
+	}
+
+	if (link.starts_with("//")) {
+		link.remove_prefix(2);
+		link_authority = link.substr(0, link.find('/'));
+		link_host_length = simple_authority(link_authority);
+
+		if (link_host_length == 0) {
+			return {resolve_status::fallback, {}};
+		}
+
+		link.remove_prefix(link_authority.size());
+
+		if (link.empty()) {
+			link = "/";
+		}
+	}
+
+	buffer.clear();
+	buffer.append(link_scheme).append("://").append(link_authority);
+
+	const size_t path_start = buffer.size();
+
+	if (link.empty()) {
+		buffer.append(path);
+	} else {
+		if (!link.starts_with('/')) {
+			// relative to directory of the base
+			buffer.append(std::string_view(path).substr(0, path.rfind('/') + 1u));
+		}
+		buffer.append(link);
+		remove_dot_segments(buffer, path_start);
+	}
+
+	const auto url = std::string_view(buffer);
+
+	return {resolve_status::resolved, url_view{.url = url, .host = url.substr(link_scheme.size() + 3u, link_host_length), .path = url.substr(path_start)}};
+}
@@ -0,0 +1,43 @@
+#ifndef CRAWLER_URL_HPP
+#define CRAWLER_URL_HPP
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace crawler {
+
+// parts of absolute URL (without query and fragment), all views into one buffer
+struct url_view {
+	std::string_view url;
+	std::string_view host;
+	std::string_view path;
+};
+
+enum class resolve_status {
+	resolved, // result is in the buffer
+	rejected, // not http(s), nothing to crawl there
+	fallback  // unusual form (escaping, userinfo, IDN, ...), use real URL parser
+};
+
+// URL of a page parsed once, so its links (mostly `#frag`, `foo.html`, `../x/`, `/abs`) can be resolved
+// with plain string operations, results are same as from libcurl with query and fragment removed
+class base_url {
+	std::string scheme{};
+	std::string authority{}; // host[:port]
+	std::string path{};
+	size_t host_length{0};
+
+public:
+	// std::nullopt if the URL is not a simple http(s) one
+	static auto parse(std::string_view url) -> std::optional<base_url>;
+
+	// when base is https, http links are upgraded to it (crawler always did that)
+	// result is valid until next call with the same buffer
+	auto resolve(std::string_view link, std::string & buffer) const -> std::pair<resolve_status, url_view>;
+};
+
+} // namespace crawler
+
+#endif
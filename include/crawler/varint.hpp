@@ -0,0 +1,86 @@
+#ifndef CRAWLER_VARINT_HPP
+#define CRAWLER_VARINT_HPP
+
+#include "index.hpp"
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace crawler {
+
+// LEB128 (7 bits per byte, highest bit means "more")
+
+inline void write_varint(std::string & output, uint64_t value) {
+	while (value >= 0x80u) {
+		output.push_back(static_cast<char>((value & 0x7Fu) | 0x80u));
+		value >>= 7u;
+	}
+	output.push_back(static_cast<char>(value));
+}
+
+inline auto read_varint(std::string_view & input) noexcept -> std::optional<uint64_t> {
+	uint64_t value = 0;
+	unsigned shift = 0;
+
+	while (!input.empty() && shift < 64u) {
+		const auto byte = static_cast<unsigned char>(input.front());
+		input.remove_prefix(1);
+		value |= static_cast<uint64_t>(byte & 0x7Fu) << shift;
+		if ((byte & 0x80u) == 0u) {
+			return value;
+		}
+		shift += 7u;
+	}
+
+	return std::nullopt;
+}
+
+// Sorted occurences as pairs of varints: id gap, and position gap inside the same document
+// (or absolute position when document changes). Smaller gaps between ids => smaller output.
+inline void encode_postings(std::span<const occurence_t> input, std::string & output) {
+	uint32_t previous_id = 0;
+	uint32_t previous_position = 0;
+
+	for (const occurence_t occ: input) {
+		const uint32_t id_gap = occ.id - previous_id;
+		write_varint(output, id_gap);
+		write_varint(output, (id_gap == 0u) ? (occ.position.n - previous_position) : occ.position.n);
+		previous_id = occ.id;
+		previous_position = occ.position.n;
+	}
+}
+
+inline auto encode_postings(std::span<const occurence_t> input) -> std::string {
+	std::string output;
+	encode_postings(input, output);
+	return output;
+}
+
+inline auto decode_postings(std::string_view input, size_t expected_count = 0) -> std::optional<std::vector<occurence_t>> {
+	std::vector<occurence_t> output;
+	output.reserve(expected_count);
+
+	uint32_t id = 0;
+	uint32_t position = 0;
+
+	while (!input.empty()) {
+		const auto id_gap = read_varint(input);
+		const auto position_value = read_varint(input);
+
+		if (!id_gap || !position_value) {
+			return std::nullopt;
+		}
+
+		id += static_cast<uint32_t>(*id_gap);
+		position = (*id_gap == 0u) ? (position + static_cast<uint32_t>(*position_value)) : static_cast<uint32_t>(*position_value);
+		output.push_back(occurence_t{.id = id, .position = position_t{position}});
+	}
+
+	return output;
+}
+
+} // namespace crawler
+
+#endif
@@ -0,0 +1,116 @@
+#include "word-table.hpp"
+#include "binary.hpp"
+#include <iostream>
+
+auto crawler::word_table::open(const std::filesystem::path & name) -> std::optional<word_table> {
+	auto file = mapped_file::open(name);
+
+	if (!file) {
+		std::cerr << "can't open file: " << name << "\n";
+		return std::nullopt;
+	}
+
+	auto in = binary_reader{file->data()};
+
+	if (!in.expect_magic("WORD") || in.read_u32() != 1) {
+		std::cerr << "unsupported word table: " << name << "\n";
+		return std::nullopt;
+	}
+
+	word_table output{};
+	output.count = in.read_u32();
+	const uint32_t total = in.read_u32();
+
+	output.string_offsets = in.read_bytes((size_t{output.count} + 1u) * sizeof(uint32_t));
+	output.first_posting = in.read_bytes((size_t{output.count} + 1u) * sizeof(uint32_t));
+	output.documents = in.read_bytes(size_t{output.count} * sizeof(uint32_t));
+	output.data = in.read_bytes(size_t{total} * 2u * sizeof(uint32_t));
+
+	if (in.failed || u32_at(output.first_posting, output.count) != total) {
+		std::cerr << "truncated word table: " << name << "\n";
+		return std::nullopt;
+	}
+
+	output.pool = file->data().subspan(in.offset);
+
+	if (u32_at(output.string_offsets, output.count) > output.pool.size()) {
+		std::cerr << "truncated word table: " << name << "\n";
+		return std::nullopt;
+	}
+
+	output.file = std::move(*file);
+
+	return output;
+}
+
+auto crawler::word_table::word_at(uint32_t index) const noexcept -> std::string_view {
+	const uint32_t from = u32_at(string_offsets, index);
+	const uint32_t to = u32_at(string_offsets, index + 1u);
+
+	return std::string_view(pool.data() + from, to - from);
+}
+
+auto crawler::word_table::find(std::string_view word) const noexcept -> std::optional<uint32_t> {
+	// lower bound of `word` in sorted words
+	uint32_t first = 0;
+	uint32_t length = count;
+
+	while (length > 0) {
+		const uint32_t half = length / 2u;
+		if (word_at(first + half) < word) {
+			first += half + 1u;
+			length -= half + 1u;
+		} else {
+			length = half;
+		}
+	}
+
+	if (first == count || word_at(first) != word) {
+		return std::nullopt;
+	}
+
+	return first;
+}
+
+auto crawler::word_table::lookup(std::string_view word) const noexcept -> std::optional<dictionary_entry_t> {
+	const auto index = find(word);
+
+	if (!index) {
+		return std::nullopt;
+	}
+
+	const uint32_t postings = u32_at(first_posting, *index + 1u) - u32_at(first_posting, *index);
+
+	return dictionary_entry_t{.postings = postings, .bytes = postings * 2u * static_cast<uint32_t>(sizeof(uint32_t)), .documents = u32_at(documents, *index)};
+}
+
+auto crawler::word_table::postings(std::string_view word) const -> std::optional<std::vector<occurence_t>> {
+	const auto index = find(word);
+
+	if (!index) {
+		return std::nullopt;
+	}
+
+	const uint32_t first = u32_at(first_posting, *index);
+	const uint32_t last = u32_at(first_posting, *index + 1u);
+
+	std::vector<occurence_t> output;
+	output.reserve(last - first);
+
+	for (uint32_t i = first; i != last; ++i) {
+		output.push_back(occurence_t{.id = u32_at(data, size_t{i} * 2u), .position = position_t{u32_at(data, size_t{i} * 2u + 1u)}});
+	}
+
+	return output;
+}
+
+auto crawler::word_table::words() const -> std::vector<std::string_view> {
+	std::vector<std::string_view> output;
+	output.reserve(count);
+
+	for (uint32_t i = 0; i != count; ++i) {
+		output.push_back(word_at(i));
+	}
+
+	return output;
+}
@@ -0,0 +1,54 @@
+#ifndef CRAWLER_WORD_TABLE_HPP
+#define CRAWLER_WORD_TABLE_HPP
+
+#include "index.hpp"
+#include "mapped-file.hpp"
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace crawler {
+
+// Word index written by `index_t::save_words`: sorted words and their postings as raw u32 pairs,
+// so a whole word costs one binary search and one copy instead of loading and intersecting
+// all its ngrams.
+
+class word_table {
+	mapped_file file{};
+	std::span<const char> string_offsets{};
+	std::span<const char> first_posting{};
+	std::span<const char> documents{};
+	std::span<const char> data{};
+	std::span<const char> pool{};
+	uint32_t count{0};
+
+	auto word_at(uint32_t index) const noexcept -> std::string_view;
+
+public:
+	static auto open(const std::filesystem::path & name) -> std::optional<word_table>;
+
+	uint32_t size() const noexcept {
+		return count;
+	}
+
+	void will_need() const noexcept {
+		file.will_need();
+	}
+
+	auto find(std::string_view word) const noexcept -> std::optional<uint32_t>;
+
+	auto lookup(std::string_view word) const noexcept -> std::optional<dictionary_entry_t>;
+
+	// std::nullopt if the word is not in any document
+	auto postings(std::string_view word) const -> std::optional<std::vector<occurence_t>>;
+
+	// all words (sorted)
+	auto words() const -> std::vector<std::string_view>;
+};
+
+} // namespace crawler
+
+#endif
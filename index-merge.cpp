@@ -0,0 +1,407 @@
+#include <crawler/index.hpp>
+#include <crawler/ngram-sizes.hpp>
+#include <crawler/page-meta.hpp>
+#include <crawler/reader.hpp>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include <cassert>
+
+// Combines indices built separately (for example by build-index for each server on another
+// machine) into one. Deltas of inputs are folded in and documents replaced by them dropped,
+// so merging a single updated index is also its compaction.
+//
+// Documents of each input get a continuous range of new ids (in order of inputs), so postings of
+// an ngram from all inputs are already ordered after renumbering and their k-way merge is just
+// a concatenation. Ngrams are processed in batches, leaves of a batch are read and encoded by
+// worker threads and written in order by the main thread.
+//
+// All inputs must have ngrams of same size. Other sizes (`build-index --ngram=...`) which all
+// of them have are made again from text of merged documents.
+
+static constexpr uint32_t missing = std::numeric_limits<uint32_t>::max();
+static constexpr size_t batch_size = 4096;
+
+struct options_t {
+	std::vector<std::filesystem::path> inputs{};
+	std::filesystem::path output{};
+	crawler::leaves_layout layout{crawler::leaves_layout::files};
+	unsigned threads{std::max(1u, std::thread::hardware_concurrency())};
+};
+
+static auto parse_arguments(int argc, char ** argv) -> std::optional<options_t> {
+	options_t options{};
+
+	for (int i = 1; i != argc; ++i) {
+		const auto arg = std::string_view{argv[i]};
+
+		if (arg.starts_with("--output=")) {
+			options.output = arg.substr(9);
+		} else if (arg == "--packs") {
+			options.layout = crawler::leaves_layout::packs;
+		} else if (arg.starts_with("--threads=")) {
+			const auto value = arg.substr(10);
+			if (std::from_chars(value.data(), value.data() + value.size(), options.threads).ec != std::errc{} || options.threads == 0) {
+				std::cerr << "invalid number of threads: " << value << "\n";
+				return std::nullopt;
+			}
+		} else {
+			options.inputs.emplace_back(arg);
+		}
+	}
+
+	if (options.inputs.empty() || options.output.empty()) {
+		std::cerr << "usage: index-merge [--packs] [--threads=N] --output=DIRECTORY INDEX...\n";
+		return std::nullopt;
+	}
+
+	const auto output = std::filesystem::weakly_canonical(options.output);
+
+	for (const auto & input: options.inputs) {
+		if (std::filesystem::weakly_canonical(input) == output) {
+			std::cerr << "output can't be one of inputs: " << input << "\n";
+			return std::nullopt;
+		}
+	}
+
+	return options;
+}
+
+template <size_t N> struct input_t {
+	crawler::layered_reader<N> reader;
+	std::vector<crawler::page_meta_t> meta{}; // base + delta (empty if index doesn't have it)
+	std::vector<uint32_t> new_id{};			  // for every document of the reader
+};
+
+template <size_t N> static auto load_meta(const std::filesystem::path & prefix, const crawler::layered_reader<N> & reader) -> std::vector<crawler::page_meta_t> {
+	if (!std::filesystem::exists(prefix / "meta.bin")) {
+		return {};
+	}
+
+	auto meta = crawler::load_page_meta(prefix / "meta.bin");
+
+	if (!meta) {
+		return {};
+	}
+
+	if (reader.delta) {
+		auto delta = crawler::load_page_meta(prefix / "delta" / "meta.bin");
+		if (!delta) {
+			return {};
+		}
+		meta->insert(meta->end(), std::make_move_iterator(delta->begin()), std::make_move_iterator(delta->end()));
+	}
+
+	return (meta->size() == reader.lengths.lengths.size()) ? std::move(*meta) : std::vector<crawler::page_meta_t>{};
+}
+
+// documents of all inputs into `output`, same URL is taken only once (from first input which has it)
+template <size_t N> static void merge_documents(std::vector<input_t<N>> & inputs, crawler::index_t<N> & output) {
+	std::unordered_set<std::string> urls{};
+
+	for (auto & input: inputs) {
+		const auto & reader = input.reader;
+		const auto count = static_cast<uint32_t>(reader.lengths.lengths.size());
+
+		input.new_id.assign(count, missing);
+
+		for (uint32_t id = 0; id != count; ++id) {
+			if (!reader.alive(id)) {
+				continue;
+			}
+
+			auto url = reader.url(id);
+
+			if (!url || !urls.insert(*url).second) {
+				continue;
+			}
+
+			input.new_id[id] = static_cast<uint32_t>(output.documents.size());
+
+			auto & doc = output.insert_document(std::move(*url));
+			doc.ngrams = reader.lengths.lengths[id];
+
+			const auto [part, local] = reader.locate(id);
+
+			if (part->text) {
+				doc.text = part->text->compressed(local).value_or(crawler::compressed_text_t{});
+			}
+
+			if (part->targets) {
+				for (const crawler::target_hit_t & target: part->targets->all_targets(local)) {
+					doc.add_target(crawler::position_t{target.position}, output.target_strings.intern(target.target));
+				}
+			}
+
+			if (!input.meta.empty()) {
+				doc.etag = input.meta[id].etag;
+				doc.last_modified = input.meta[id].last_modified;
+				doc.content_hash = input.meta[id].content_hash;
+				doc.links = input.meta[id].links;
+			}
+		}
+	}
+}
+
+struct encoded_leaf_t {
+	std::string content{};
+	crawler::dictionary_entry_t info{};
+};
+
+template <size_t N> static auto encode_leaf(const std::vector<input_t<N>> & inputs, crawler::ngram_t<N> ngram) -> encoded_leaf_t {
+	std::vector<crawler::occurence_t> postings;
+
+	for (const auto & input: inputs) {
+		for (crawler::occurence_t occ: input.reader.postings(ngram)) {
+			if (const uint32_t id = input.new_id[occ.id]; id != missing) {
+				postings.push_back(crawler::occurence_t{.id = id, .position = occ.position});
+			}
+		}
+	}
+
+	if (postings.empty()) {
+		return {};
+	}
+
+	// renumbering keeps order of ids and inputs are in order of their ranges
+	assert(std::ranges::is_sorted(postings));
+
+	auto out = std::ostringstream{};
+	crawler::write_postings(out, postings);
+
+	encoded_leaf_t output{.content = std::move(out).str()};
+	output.info = crawler::dictionary_entry_t{.postings = static_cast<uint32_t>(postings.size()), .bytes = static_cast<uint32_t>(output.content.size()), .documents = static_cast<uint32_t>(crawler::document_frequency(postings))};
+	return output;
+}
+
+// what was saved (for the manifest of ngram sizes), std::nullopt if leaves can't be written
+template <size_t N> static auto merge_leaves(const std::vector<input_t<N>> & inputs, const options_t & options) -> std::optional<crawler::ngram_size_info_t> {
+	const auto & prefix = options.output;
+
+	std::vector<crawler::ngram_t<N>> all;
+	for (const auto & input: inputs) {
+		std::ranges::copy(input.reader.ngrams(), std::back_inserter(all));
+	}
+	std::ranges::sort(all);
+	const auto duplicates = std::ranges::unique(all);
+	all.erase(duplicates.begin(), duplicates.end());
+
+	auto ec = std::error_code{};
+	std::filesystem::create_directories(prefix / ((options.layout == crawler::leaves_layout::packs) ? "packs" : "leaves"), ec);
+
+	std::vector<crawler::ngram_t<N>> ngrams;
+	std::vector<crawler::dictionary_entry_t> sizes;
+	auto packs = crawler::pack_writer{prefix};
+
+	std::vector<encoded_leaf_t> batch;
+
+	for (size_t start = 0; start < all.size(); start += batch_size) {
+		const auto current = std::span(all).subspan(start, std::min(batch_size, all.size() - start));
+
+		batch.assign(current.size(), encoded_leaf_t{});
+
+		std::atomic<size_t> next{0};
+		std::vector<std::jthread> workers;
+
+		for (unsigned t = 0; t != options.threads; ++t) {
+			workers.emplace_back([&] {
+				for (size_t i = next++; i < current.size(); i = next++) {
+					batch[i] = encode_leaf(inputs, current[i]);
+				}
+			});
+		}
+
+		workers.clear(); // joins
+
+		for (size_t i = 0; i != current.size(); ++i) {
+			const encoded_leaf_t & leaf = batch[i];
+
+			if (leaf.info.postings == 0) {
+				// all its documents were replaced
+				continue;
+			}
+
+			if (options.layout == crawler::leaves_layout::packs) {
+				std::ostream * of = packs.next(current[i][0]);
+				if (of == nullptr) {
+					return std::nullopt;
+				}
+				of->write(leaf.content.data(), static_cast<std::streamsize>(leaf.content.size()));
+				packs.written(leaf.content.size());
+			} else {
+				const auto name = prefix / "leaves" / current[i];
+				auto of = std::ofstream{name, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc};
+				if (!of) {
+					std::cerr << "can't open: " << name << "\n";
+					return std::nullopt;
+				}
+				of.write(leaf.content.data(), static_cast<std::streamsize>(leaf.content.size()));
+			}
+
+			ngrams.push_back(current[i]);
+			sizes.push_back(leaf.info);
+		}
+	}
+
+	if (options.layout == crawler::leaves_layout::packs) {
+		packs.finish();
+	} else {
+		// readers prefer packs when there is a manifest, it can't be a stale one
+		std::filesystem::remove(prefix / "packs.bin", ec);
+	}
+
+	crawler::save_dictionary_file<N>(prefix / "ngrams.bin", ngrams, sizes);
+	crawler::save_outliers_file<N>(prefix / "outliers.json", ngrams, sizes);
+	crawler::save_offenders_file<N>(prefix / "offenders.json", ngrams, sizes);
+
+	std::cout << "ngrams = " << ngrams.size() << "\n";
+
+	const uint64_t postings = std::accumulate(sizes.begin(), sizes.end(), uint64_t{0}, [](uint64_t sum, const crawler::dictionary_entry_t & info) { return sum + info.postings; });
+
+	return crawler::ngram_size_info_t{.size = static_cast<uint32_t>(N), .ngrams = static_cast<uint32_t>(ngrams.size()), .postings = postings};
+}
+
+// word index (and completions made of it) only when every input has one, output without it is searched by ngrams
+template <size_t N> static void merge_words(const std::vector<input_t<N>> & inputs, crawler::index_t<N> & output, const std::filesystem::path & prefix) {
+	auto ec = std::error_code{};
+	std::filesystem::remove(prefix / "words.bin", ec);
+	std::filesystem::remove(prefix / "completions.bin", ec);
+
+	if (!std::ranges::all_of(inputs, [](const input_t<N> & input) { return input.reader.has_words(); })) {
+		std::cout << "some inputs don't have word index, it's not merged\n";
+		return;
+	}
+
+	for (const auto & input: inputs) {
+		for (std::string_view word: input.reader.words()) {
+			const auto postings = input.reader.word_postings(word);
+
+			if (!postings) {
+				continue;
+			}
+
+			crawler::leaf_t * destination = nullptr;
+
+			for (crawler::occurence_t occ: *postings) {
+				if (const uint32_t id = input.new_id[occ.id]; id != missing) {
+					if (destination == nullptr) {
+						destination = &output.words[std::string(word)];
+					}
+					destination->unsorted_data.push_back(crawler::occurence_t{.id = id, .position = occ.position});
+				}
+			}
+		}
+	}
+
+	output.save_words(prefix / "words.bin");
+	output.save_completions(prefix / "completions.bin");
+
+	std::cout << "words = " << output.words.size() << "\n";
+}
+
+// sizes of ngrams of all inputs, main one must be same everywhere and others are kept only when
+// all inputs have them (in order of the first input)
+static auto common_ngram_sizes(std::span<const std::filesystem::path> inputs) -> std::optional<std::vector<size_t>> {
+	std::optional<std::vector<size_t>> output;
+
+	for (const auto & prefix: inputs) {
+		const auto sizes = crawler::ngram_sizes_of(prefix);
+
+		if (!sizes) {
+			std::cerr << "can't open index: " << prefix << "\n";
+			return std::nullopt;
+		}
+
+		if (!output) {
+			output = *sizes;
+			continue;
+		}
+
+		if (sizes->front() != output->front()) {
+			std::cerr << "can't merge ngrams of size " << sizes->front() << " (" << prefix << ") with ngrams of size " << output->front() << "\n";
+			return std::nullopt;
+		}
+
+		std::erase_if(*output, [&](size_t n) { return std::ranges::find(*sizes, n) == sizes->end(); });
+	}
+
+	return output;
+}
+
+template <size_t N> static int merge(const options_t & options, std::span<const size_t> ngram_sizes) {
+	std::vector<input_t<N>> inputs;
+
+	for (const auto & prefix: options.inputs) {
+		auto reader = crawler::layered_reader<N>::open(prefix);
+
+		if (!reader) {
+			std::cerr << "can't open index: " << prefix << "\n";
+			return 1;
+		}
+
+		auto meta = load_meta(prefix, *reader);
+		inputs.push_back(input_t<N>{.reader = std::move(*reader), .meta = std::move(meta)});
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+
+	auto output = crawler::index_t<N>{};
+	merge_documents(inputs, output);
+
+	std::cout << "documents = " << output.documents.size() << "\n";
+
+	auto ec = std::error_code{};
+	std::filesystem::create_directories(options.output, ec);
+	std::filesystem::remove_all(options.output / "delta", ec);
+
+	output.save_documents_urls(options.output / "urls.bin");
+	output.save_documents_lengths(options.output / "documents.bin");
+	output.save_documents_text(options.output / "text.bin");
+	output.save_documents_targets(options.output / "targets.bin");
+	output.save_documents_meta(options.output / "meta.bin");
+
+	const auto merged = merge_leaves(inputs, options);
+
+	if (!merged) {
+		std::cerr << "can't save leaves into: " << options.output << "\n";
+		return 1;
+	}
+
+	merge_words(inputs, output, options.output);
+
+	crawler::save_other_ngram_sizes(output, *merged, ngram_sizes, options.output, options.layout);
+
+	const auto end = std::chrono::steady_clock::now();
+	std::cout << "merged in " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << "ms\n";
+
+	return 0;
+}
+
+int main(int argc, char ** argv) {
+	const auto options = parse_arguments(argc, argv);
+
+	if (!options) {
+		return 1;
+	}
+
+	const auto ngram_sizes = common_ngram_sizes(options->inputs);
+
+	if (!ngram_sizes) {
+		return 1;
+	}
+
+	return crawler::with_ngram_size(ngram_sizes->front(), [&](auto n) {
+		return merge<decltype(n)::value>(*options, *ngram_sizes);
+	});
+}
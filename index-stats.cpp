@@ -0,0 +1,300 @@
+#include <crawler/index.hpp>
+#include <crawler/ngram-sizes.hpp>
+#include <crawler/reader.hpp>
+#include <crawler/varint.hpp>
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Prints what a built index is made of: lengths of posting lists, sizes of leaves and what
+// they would take in other encodings, lengths of documents, link targets, words and the heaviest
+// ngrams. Delta of `build-index --update` is reported separately, ngrams of other sizes (`build-index
+// --ngram=...`) only by their totals.
+//
+// `--offenders` writes offenders.json (percentiles of the biggest leaves) into an index built
+// before build-index wrote it.
+
+struct options_t {
+	std::filesystem::path prefix{"web/index/"};
+	size_t top{20};
+	bool offenders{false};
+};
+
+static auto parse_arguments(int argc, char ** argv) -> std::optional<options_t> {
+	options_t output{};
+
+	for (int i = 1; i != argc; ++i) {
+		const auto arg = std::string_view{argv[i]};
+
+		if (arg.starts_with("--index=")) {
+			output.prefix = arg.substr(8);
+		} else if (arg.starts_with("--top=")) {
+			const auto value = arg.substr(6);
+			if (std::from_chars(value.data(), value.data() + value.size(), output.top).ec != std::errc{}) {
+				std::cerr << "invalid number of ngrams: " << value << "\n";
+				return std::nullopt;
+			}
+		} else if (arg == "--offenders") {
+			output.offenders = true;
+		} else {
+			std::cerr << "unknown argument: " << arg << "\n";
+			std::cerr << "usage: index-stats [--index=DIRECTORY] [--top=N] [--offenders]\n";
+			return std::nullopt;
+		}
+	}
+
+	return output;
+}
+
+static auto percent(uint64_t part, uint64_t total) -> double {
+	return (total != 0) ? 100.0 * static_cast<double>(part) / static_cast<double>(total) : 0.0;
+}
+
+// count, total and percentiles of values
+static void print_distribution(std::string_view name, std::vector<uint64_t> values) {
+	if (values.empty()) {
+		std::cout << name << ": none\n";
+		return;
+	}
+
+	std::ranges::sort(values);
+
+	const auto at = [&](size_t per_mille) {
+		return values[std::min(values.size() - 1u, values.size() * per_mille / 1000u)];
+	};
+
+	const uint64_t total = std::accumulate(values.begin(), values.end(), uint64_t{0});
+
+	std::cout << name << ": count = " << values.size() << ", total = " << total << ", average = " << std::fixed << std::setprecision(1) << static_cast<double>(total) / static_cast<double>(values.size());
+	std::cout << ", min = " << values.front() << ", p50 = " << at(500) << ", p90 = " << at(900) << ", p99 = " << at(990) << ", p99.9 = " << at(999) << ", max = " << values.back() << "\n";
+}
+
+// values in power of two buckets, with their share of count and of the sum
+static void print_histogram(std::span<const uint64_t> values) {
+	std::vector<uint64_t> counts;
+	std::vector<uint64_t> sums;
+
+	for (uint64_t value: values) {
+		const auto bucket = static_cast<size_t>(std::bit_width(value));
+		if (bucket >= counts.size()) {
+			counts.resize(bucket + 1u, 0);
+			sums.resize(bucket + 1u, 0);
+		}
+		++counts[bucket];
+		sums[bucket] += value;
+	}
+
+	const uint64_t total = std::accumulate(sums.begin(), sums.end(), uint64_t{0});
+
+	for (size_t bucket = 0; bucket != counts.size(); ++bucket) {
+		if (counts[bucket] == 0) {
+			continue;
+		}
+
+		const uint64_t from = (bucket != 0) ? (uint64_t{1} << (bucket - 1u)) : 0u;
+		const uint64_t to = (bucket != 0) ? (uint64_t{1} << bucket) - 1u : 0u;
+
+		std::cout << "\t" << std::setw(10) << from << ".." << std::left << std::setw(10) << to << std::right << std::setw(10) << counts[bucket] << " (" << std::setw(5) << percent(counts[bucket], values.size()) << "%)  postings " << std::setw(5) << percent(sums[bucket], total) << "%\n";
+	}
+}
+
+// `abc` or `\xe2\x80\x9c`
+template <size_t N> static auto printable(crawler::ngram_t<N> ngram) -> std::string {
+	std::string output;
+
+	for (char8_t c: ngram) {
+		if (c >= 0x20u && c < 0x7Fu && c != '\\') {
+			output += static_cast<char>(c);
+		} else {
+			output += "\\x";
+			output += crawler::to_hexdec(static_cast<unsigned>(c) >> 4u);
+			output += crawler::to_hexdec(static_cast<unsigned>(c) & 0xFu);
+		}
+	}
+
+	return output;
+}
+
+template <size_t N> static void report(const crawler::index_reader<N> & index, size_t top) {
+	const auto & entries = index.dictionary.entries;
+
+	std::cout << "documents = " << index.lengths.lengths.size() << "\n";
+	print_distribution("ngrams per document", index.lengths.lengths | std::views::transform([](uint32_t v) { return uint64_t{v}; }) | std::ranges::to<std::vector>());
+
+	if (index.targets) {
+		std::vector<uint64_t> targets;
+		for (uint32_t id = 0; id != index.targets->documents(); ++id) {
+			targets.push_back(index.targets->targets_of(id));
+		}
+		std::cout << "unique targets = " << index.targets->unique_targets() << "\n";
+		print_distribution("targets per document", std::move(targets));
+	}
+
+	std::cout << "\nngrams = " << entries.size() << " (size " << N << ")\n";
+
+	const auto postings = entries | std::views::transform([](const auto & entry) { return uint64_t{entry.info.postings}; }) | std::ranges::to<std::vector>();
+
+	print_distribution("postings per ngram", postings);
+	print_histogram(postings);
+	print_distribution("documents per ngram", entries | std::views::transform([](const auto & entry) { return uint64_t{entry.info.documents}; }) | std::ranges::to<std::vector>());
+	print_distribution("bytes per ngram (json)", entries | std::views::transform([](const auto & entry) { return uint64_t{entry.info.bytes}; }) | std::ranges::to<std::vector>());
+
+	// every leaf is read, so the other encodings are measured and not estimated
+	std::vector<uint64_t> varint_bytes;
+	varint_bytes.reserve(entries.size());
+
+	std::string buffer;
+	uint64_t mismatched = 0;
+
+	for (const auto & entry: entries) {
+		const auto data = index.postings(entry.ngram);
+
+		if (data.size() != entry.info.postings) {
+			++mismatched;
+		}
+
+		buffer.clear();
+		crawler::encode_postings(data, buffer);
+		varint_bytes.push_back(buffer.size());
+	}
+
+	print_distribution("bytes per ngram (varint)", varint_bytes);
+
+	const uint64_t total_postings = std::accumulate(postings.begin(), postings.end(), uint64_t{0});
+	const uint64_t json = std::accumulate(entries.begin(), entries.end(), uint64_t{0}, [](uint64_t sum, const auto & entry) { return sum + entry.info.bytes; });
+	const uint64_t varint = std::accumulate(varint_bytes.begin(), varint_bytes.end(), uint64_t{0});
+	const uint64_t raw = total_postings * 2u * sizeof(uint32_t);
+
+	const auto per_posting = [&](uint64_t bytes) {
+		return (total_postings != 0) ? static_cast<double>(bytes) / static_cast<double>(total_postings) : 0.0;
+	};
+
+	const auto ratio = [&](uint64_t bytes) {
+		return (bytes != 0) ? static_cast<double>(raw) / static_cast<double>(bytes) : 0.0;
+	};
+
+	std::cout << std::setprecision(2);
+	std::cout << "encodings of " << total_postings << " postings (compression against raw u32 pairs):\n";
+	std::cout << "\traw u32 pairs = " << raw << " bytes (" << per_posting(raw) << " per posting)\n";
+	std::cout << "\tjson          = " << json << " bytes (" << per_posting(json) << " per posting, " << ratio(json) << "x)\n";
+	std::cout << "\tvarint gaps   = " << varint << " bytes (" << per_posting(varint) << " per posting, " << ratio(varint) << "x)\n";
+
+	if (mismatched != 0) {
+		std::cout << "\t" << mismatched << " leaves don't match the dictionary!\n";
+	}
+
+	std::vector<size_t> order(entries.size());
+	std::iota(order.begin(), order.end(), size_t{0});
+
+	const size_t heaviest = std::min(top, order.size());
+	std::ranges::partial_sort(order, order.begin() + static_cast<std::ptrdiff_t>(heaviest), std::greater<>{}, [&](size_t i) { return entries[i].info.postings; });
+
+	std::cout << "\nheaviest ngrams:\n";
+
+	for (size_t i: order | std::views::take(heaviest)) {
+		const auto & entry = entries[i];
+		std::cout << "\t" << entry.ngram.get_hexdec() << " " << std::left << std::setw(14) << ("`" + printable(entry.ngram) + "`") << std::right << " postings = " << std::setw(9) << entry.info.postings << " (" << std::setw(5) << percent(entry.info.postings, total_postings) << "%), documents = " << std::setw(7) << entry.info.documents << ", json = " << std::setw(10) << entry.info.bytes << ", varint = " << std::setw(9) << varint_bytes[i] << "\n";
+	}
+
+	if (index.words) {
+		std::vector<uint64_t> word_postings;
+		for (std::string_view word: index.words->words()) {
+			word_postings.push_back(index.words->lookup(word)->postings);
+		}
+
+		std::cout << "\nwords = " << index.words->size() << "\n";
+		print_distribution("postings per word", std::move(word_postings));
+	}
+
+	if (index.completions) {
+		std::cout << "completion terms = " << index.completions->size() << "\n";
+	}
+}
+
+template <size_t N> static bool write_offenders(const crawler::index_reader<N> & index, const std::filesystem::path & prefix) {
+	const auto & entries = index.dictionary.entries;
+
+	const auto ngrams = entries | std::views::transform([](const auto & entry) { return entry.ngram; }) | std::ranges::to<std::vector>();
+	const auto sizes = entries | std::views::transform([](const auto & entry) { return entry.info; }) | std::ranges::to<std::vector>();
+
+	crawler::save_offenders_file<N>(prefix / "offenders.json", ngrams, sizes);
+
+	return std::filesystem::exists(prefix / "offenders.json");
+}
+
+// totals of ngrams of other sizes from the manifest
+static void report_other_sizes(const std::filesystem::path & prefix) {
+	if (!std::filesystem::exists(prefix / "ngram-sizes.bin")) {
+		return;
+	}
+
+	const auto sizes = crawler::load_ngram_sizes(prefix / "ngram-sizes.bin");
+
+	if (!sizes || sizes->size() < 2u) {
+		return;
+	}
+
+	std::cout << "\nngram sizes:\n";
+
+	for (const crawler::ngram_size_info_t & info: *sizes) {
+		std::cout << "\t" << info.size << ": ngrams = " << std::setw(9) << info.ngrams << ", postings = " << std::setw(11) << info.postings << ((info.size == sizes->front().size) ? " (main)" : "") << "\n";
+	}
+}
+
+template <size_t N> static int run(const options_t & options) {
+	const auto index = crawler::index_reader<N>::open(options.prefix);
+
+	if (!index) {
+		std::cerr << "can't open index: " << options.prefix << "\n";
+		return 1;
+	}
+
+	report(*index, options.top);
+	report_other_sizes(options.prefix);
+
+	const auto delta_prefix = options.prefix / "delta";
+
+	if (std::filesystem::exists(delta_prefix / "tombstones.bin")) {
+		if (const auto delta = crawler::index_reader<N>::open(delta_prefix)) {
+			std::cout << "\ndelta:\n";
+			report(*delta, options.top);
+			report_other_sizes(delta_prefix);
+		}
+	}
+
+	if (options.offenders) {
+		if (!write_offenders(*index, options.prefix)) {
+			return 1;
+		}
+
+		std::cout << "\nwritten " << (options.prefix / "offenders.json").native() << "\n";
+	}
+
+	return 0;
+}
+
+int main(int argc, char ** argv) {
+	const auto options = parse_arguments(argc, argv);
+
+	if (!options) {
+		return 1;
+	}
+
+	const auto ngram_size = crawler::dictionary_ngram_size(options->prefix / "ngrams.bin");
+
+	if (!ngram_size) {
+		std::cerr << "can't open index: " << options->prefix << "\n";
+		return 1;
+	}
+
+	return crawler::with_ngram_size(*ngram_size, [&](auto n) {
+		return run<decltype(n)::value>(*options);
+	});
+}
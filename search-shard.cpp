@@ -0,0 +1,343 @@
+#include <crawler/live-index.hpp>
+#include <crawler/query-cache.hpp>
+#include <crawler/reader.hpp>
+#include <crawler/search.hpp>
+#include <crawler/shard.hpp>
+#include <crawler/snapshot.hpp>
+#include <charconv>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <cerrno>
+#include <cstring>
+#include <csignal>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Serves one index (a shard of documents) on a unix socket for `search --shard=PATH`.
+// Every connection gets its own thread and can send any number of queries. With `--live`
+// it also takes pages crawled by `build-index --live=PATH`, they are searchable right away.
+//
+// SIGHUP loads the index again (in background) and swaps it in when it's ready, queries which
+// are running finish with the old one. Publish a new index into its own directory and point
+// a symlink (given as --index) to it, every snapshot reads only files of its own directory.
+//
+// Parsed postings of hot ngrams and results of repeated queries are cached (see crawler/query-cache.hpp),
+// `search --stats --shard=PATH` shows hit counters.
+
+struct options_t {
+	std::filesystem::path prefix{"web/index/"};
+	std::filesystem::path socket{};
+	size_t posting_cache_bytes{64u * 1024u * 1024u};
+	size_t result_cache_entries{1024};
+	bool live{false};
+};
+
+static bool parse_size(std::string_view value, size_t & output) {
+	return std::from_chars(value.data(), value.data() + value.size(), output).ec == std::errc{};
+}
+
+static auto parse_arguments(int argc, char ** argv) -> std::optional<options_t> {
+	options_t output{};
+
+	for (int i = 1; i != argc; ++i) {
+		const auto arg = std::string_view{argv[i]};
+
+		if (arg.starts_with("--index=")) {
+			output.prefix = arg.substr(8);
+		} else if (arg.starts_with("--socket=")) {
+			output.socket = arg.substr(9);
+		} else if (arg == "--live") {
+			output.live = true;
+		} else if (arg.starts_with("--cache=")) {
+			size_t megabytes = 0;
+			if (!parse_size(arg.substr(8), megabytes)) {
+				std::cerr << "invalid cache size: " << arg.substr(8) << " (expected megabytes)\n";
+				return std::nullopt;
+			}
+			output.posting_cache_bytes = megabytes * 1024u * 1024u;
+		} else if (arg.starts_with("--results=")) {
+			if (!parse_size(arg.substr(10), output.result_cache_entries)) {
+				std::cerr << "invalid number of cached results: " << arg.substr(10) << "\n";
+				return std::nullopt;
+			}
+		} else {
+			std::cerr << "unknown argument: " << arg << "\n";
+			return std::nullopt;
+		}
+	}
+
+	if (output.socket.empty()) {
+		std::cerr << "usage: search-shard [--index=DIRECTORY] [--live] [--cache=MB] [--results=N] --socket=PATH\n";
+		return std::nullopt;
+	}
+
+	return output;
+}
+
+// `searched` gives postings (maybe from a cache), `index` the rest
+template <typename Searched, typename Index> static auto answer(const Searched & searched, const Index & index, const crawler::shard_request_t & request) -> crawler::shard_response_t {
+	const auto start = std::chrono::steady_clock::now();
+
+	crawler::shard_response_t output{};
+
+	for (const auto & hit: crawler::search(searched, request.query, request.limit)) {
+		auto & item = output.hits.emplace_back();
+		item.score = hit.score;
+		item.url = index.url(hit.id).value_or("?");
+
+		if (const auto anchor = index.nearest_target(hit.id, hit.position)) {
+			item.anchor = anchor->target;
+		}
+
+		if (auto snippet = index.snippet(hit.id, hit.position, hit.length)) {
+			item.snippet = std::move(*snippet);
+		}
+	}
+
+	output.search_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+	return output;
+}
+
+// snapshot of the index with its caches (they are empty again when the index is swapped)
+template <size_t N> struct served_index {
+	crawler::layered_reader<N> reader;
+	mutable crawler::posting_cache<N> postings;
+	mutable crawler::result_cache<crawler::shard_response_t> results;
+
+	served_index(crawler::layered_reader<N> && r, const options_t & options, crawler::cache_counters & counters): reader{std::move(r)}, postings{options.posting_cache_bytes, counters}, results{options.result_cache_entries, counters} { }
+
+	auto answer(const crawler::shard_request_t & request) const -> crawler::shard_response_t {
+		const auto start = std::chrono::steady_clock::now();
+
+		auto key = crawler::normalize_query(request.query);
+		key.append("\n").append(std::to_string(request.limit));
+
+		if (const auto cached = results.find(key)) {
+			auto output = *cached;
+			output.search_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+			return output;
+		}
+
+		auto output = ::answer(crawler::cached_reader{reader, postings}, reader, request);
+		results.insert(std::move(key), std::make_shared<const crawler::shard_response_t>(output));
+		return output;
+	}
+};
+
+// directory behind symlink is resolved, so files of the snapshot don't change under it
+template <size_t N> static auto load_snapshot(const std::filesystem::path & prefix, const options_t & options, crawler::cache_counters & counters) -> std::shared_ptr<const served_index<N>> {
+	auto ec = std::error_code{};
+	const auto directory = std::filesystem::canonical(prefix, ec);
+
+	if (ec) {
+		std::cerr << "can't open index: " << prefix << "\n";
+		return nullptr;
+	}
+
+	// size of ngrams is given by the first snapshot, a new one with other size is not loaded
+	auto reader = crawler::layered_reader<N>::open(directory);
+
+	if (!reader) {
+		std::cerr << "can't open index: " << directory << "\n";
+		return nullptr;
+	}
+
+	reader->will_need();
+
+	return std::make_shared<const served_index<N>>(std::move(*reader), options, counters);
+}
+
+// read only index or live one
+template <size_t N> struct shard_t {
+	crawler::snapshot_handle<served_index<N>> index{};
+	std::unique_ptr<crawler::live_index<N>> live{};
+	mutable crawler::cache_counters counters{};
+
+	auto stats() const -> crawler::shard_stats_t {
+		crawler::shard_stats_t output;
+		output.emplace_back("posting cache hits", counters.posting_hits.load());
+		output.emplace_back("posting cache misses", counters.posting_misses.load());
+		output.emplace_back("posting cache rejected", counters.posting_rejected.load());
+		output.emplace_back("result cache hits", counters.result_hits.load());
+		output.emplace_back("result cache misses", counters.result_misses.load());
+
+		if (live) {
+			output.emplace_back("documents", live->documents());
+		} else {
+			const auto current = index.get();
+			output.emplace_back("documents", current->reader.lengths.lengths.size());
+			output.emplace_back("posting cache bytes", current->postings.size_in_bytes());
+		}
+
+		return output;
+	}
+
+	auto handle(std::string_view payload) const -> std::optional<std::string> {
+		if (crawler::message_kind(payload) == "PAGE") {
+			const auto page = crawler::decode_page(payload);
+
+			if (!page || !live) {
+				return std::nullopt;
+			}
+
+			const auto targets = page->targets | std::views::transform([](const crawler::shard_target_t & target) { return crawler::target_hit_t{.position = target.position, .target = target.name}; }) | std::ranges::to<std::vector>();
+			live->add(page->url, page->text, targets);
+			return "DONE";
+		}
+
+		if (crawler::message_kind(payload) == "STAT") {
+			return crawler::encode_stats(stats());
+		}
+
+		if (crawler::message_kind(payload) == "CMPL") {
+			const auto request = crawler::decode_completion_request(payload);
+
+			if (!request) {
+				return std::nullopt;
+			}
+
+			// completions are built with the index, live one doesn't have them
+			crawler::shard_completions_t output;
+
+			if (!live) {
+				const auto current = index.get();
+				for (const crawler::completion_t & item: current->reader.complete(request->query, request->limit)) {
+					output.emplace_back(std::string(item.term), item.score);
+				}
+			}
+
+			return crawler::encode_completions(output);
+		}
+
+		const auto request = crawler::decode_request(payload);
+
+		if (!request) {
+			return std::nullopt;
+		}
+
+		if (live) {
+			// it changes with every page, there is nothing to cache
+			const auto view = live->view();
+			return crawler::encode_response(answer(view, view, *request));
+		}
+
+		// the snapshot stays alive until we are done with it, even if it's swapped meanwhile
+		const auto current = index.get();
+		return crawler::encode_response(current->answer(*request));
+	}
+};
+
+template <size_t N> static void serve(const shard_t<N> & shard, int fd) {
+	while (const auto payload = crawler::receive_message(fd)) {
+		const auto response = shard.handle(*payload);
+
+		if (!response) {
+			std::cerr << "invalid request\n";
+			break;
+		}
+
+		if (!crawler::send_message(fd, *response)) {
+			break;
+		}
+	}
+
+	::close(fd);
+}
+
+template <size_t N> static int run(const options_t & options) {
+	// SIGHUP is received only by the reloading thread (mask is inherited by all threads)
+	sigset_t reload_signal;
+	sigemptyset(&reload_signal);
+	sigaddset(&reload_signal, SIGHUP);
+	pthread_sigmask(SIG_BLOCK, &reload_signal, nullptr);
+
+	auto shard = shard_t<N>{};
+
+	if (options.live) {
+		shard.live = crawler::live_index<N>::open(options.prefix);
+
+		if (!shard.live) {
+			std::cerr << "can't open index: " << options.prefix << "\n";
+			return 1;
+		}
+	} else {
+		auto snapshot = load_snapshot<N>(options.prefix, options, shard.counters);
+
+		if (!snapshot) {
+			return 1;
+		}
+
+		shard.index.replace(std::move(snapshot));
+	}
+
+	const int listener = crawler::listen_unix(options.socket);
+
+	if (listener < 0) {
+		return 1;
+	}
+
+	const size_t documents = shard.live ? shard.live->documents() : shard.index.get()->reader.lengths.lengths.size();
+	std::cerr << "serving " << options.prefix << " (" << documents << " documents" << (shard.live ? ", live" : "") << ") on " << options.socket << "\n";
+
+	if (!shard.live) {
+		std::thread{[&] {
+			for (;;) {
+				int signal = 0;
+
+				if (sigwait(&reload_signal, &signal) != 0) {
+					continue;
+				}
+
+				const auto start = std::chrono::steady_clock::now();
+
+				// old index keeps serving when the new one can't be loaded
+				if (auto snapshot = load_snapshot<N>(options.prefix, options, shard.counters)) {
+					const size_t count = snapshot->reader.lengths.lengths.size();
+					shard.index.replace(std::move(snapshot));
+					const auto end = std::chrono::steady_clock::now();
+					std::cerr << "reloaded " << options.prefix << " (" << count << " documents) in " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << "ms\n";
+				}
+			}
+		}}.detach();
+	}
+
+	for (;;) {
+		const int fd = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) {
+				continue;
+			}
+			std::cerr << "can't accept: " << std::strerror(errno) << "\n";
+			return 1;
+		}
+
+		// index is only read (live one is synchronized inside), connections can share it
+		std::thread{[&shard, fd] { serve(shard, fd); }}.detach();
+	}
+}
+
+int main(int argc, char ** argv) {
+	const auto options = parse_arguments(argc, argv);
+
+	if (!options) {
+		return 1;
+	}
+
+	// everything is specialized for size of ngrams of the index (live one too, pages are added to it)
+	const auto ngram_size = crawler::dictionary_ngram_size(options->prefix / "ngrams.bin");
+
+	if (!ngram_size) {
+		std::cerr << "can't open index: " << options->prefix << "\n";
+		return 1;
+	}
+
+	return crawler::with_ngram_size(*ngram_size, [&](auto n) {
+		return run<decltype(n)::value>(*options);
+	});
+}
@@ -0,0 +1,245 @@
+#include <crawler/reader.hpp>
+#include <crawler/search.hpp>
+#include <crawler/shard.hpp>
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unistd.h>
+
+struct options_t {
+	std::filesystem::path prefix{"web/index/"};
+	size_t limit{20};
+	std::string query{};
+	std::vector<std::filesystem::path> shards{}; // query these `search-shard` servers instead of a local index
+	bool stats{false};							 // print counters of shards
+	bool complete{false};						 // print completions of the last word instead of searching
+
+	// every shard has this long to answer, slower ones are left out of the results
+	std::chrono::milliseconds timeout{crawler::default_shard_timeout};
+};
+
+static auto parse_arguments(int argc, char ** argv) -> options_t {
+	options_t output{};
+
+	for (int i = 1; i != argc; ++i) {
+		const auto arg = std::string_view{argv[i]};
+
+		if (arg.starts_with("--index=")) {
+			output.prefix = arg.substr(8);
+		} else if (arg.starts_with("--limit=")) {
+			const auto value = arg.substr(8);
+			std::from_chars(value.data(), value.data() + value.size(), output.limit);
+		} else if (arg.starts_with("--shard=")) {
+			output.shards.emplace_back(arg.substr(8));
+		} else if (arg.starts_with("--timeout=")) {
+			const auto value = arg.substr(10);
+			uint32_t milliseconds = 0;
+			std::from_chars(value.data(), value.data() + value.size(), milliseconds);
+			output.timeout = std::chrono::milliseconds{milliseconds};
+		} else if (arg == "--stats") {
+			output.stats = true;
+		} else if (arg == "--complete") {
+			output.complete = true;
+		} else {
+			if (!output.query.empty()) {
+				output.query += ' ';
+			}
+			output.query.append(arg);
+		}
+	}
+
+	return output;
+}
+
+static void print_hit(double score, std::string_view url, std::string_view anchor, const crawler::snippet_t * snippet, bool terminal) {
+	std::cout << std::fixed << std::setprecision(4) << score << " " << url;
+
+	if (!anchor.empty()) {
+		std::cout << "#" << anchor;
+	}
+
+	std::cout << "\n";
+
+	if (snippet) {
+		std::cout << "\t..." << snippet->before << (terminal ? "\033[1m" : "**") << snippet->match << (terminal ? "\033[0m" : "**") << snippet->after << "...\n";
+	}
+}
+
+static void print_stats(const options_t & options) {
+	const auto all = crawler::collect_stats(options.shards, options.timeout);
+
+	for (size_t i = 0; i != all.size(); ++i) {
+		std::cout << "shard " << options.shards[i].native() << ":\n";
+
+		if (!all[i]) {
+			std::cout << "\tno answer\n";
+			continue;
+		}
+
+		for (const auto & [name, value]: *all[i]) {
+			std::cout << "\t" << name << " = " << value << "\n";
+		}
+
+		const auto value_of = [&](std::string_view name) -> uint64_t {
+			const auto it = std::ranges::find(*all[i], name, [](const auto & item) { return std::string_view(item.first); });
+			return (it != all[i]->end()) ? it->second : 0u;
+		};
+
+		const auto rate = [](uint64_t hits, uint64_t misses) {
+			return (hits + misses != 0) ? 100.0 * static_cast<double>(hits) / static_cast<double>(hits + misses) : 0.0;
+		};
+
+		std::cout << std::fixed << std::setprecision(1) << "\tposting cache hit rate = " << rate(value_of("posting cache hits"), value_of("posting cache misses")) << "%, result cache hit rate = " << rate(value_of("result cache hits"), value_of("result cache misses")) << "%\n";
+	}
+}
+
+// what user is typing: word characters at the end of the query (`std::vec` -> `vec`)
+static auto typed_prefix(std::string_view query) -> std::string {
+	std::string output;
+
+	for (char c: query) {
+		if (c >= 'A' && c <= 'Z') {
+			c = static_cast<char>((c - 'A') + 'a');
+		}
+
+		if (crawler::is_word_character(c)) {
+			output += c;
+		} else {
+			output.clear();
+		}
+	}
+
+	return output;
+}
+
+static void print_completion(std::string_view query, std::string_view prefix, std::string_view term, uint32_t score) {
+	std::cout << score << " " << query.substr(0, query.size() - prefix.size()) << term << "\n";
+}
+
+static int complete_from_shards(const options_t & options) {
+	const auto prefix = typed_prefix(options.query);
+
+	const auto start = std::chrono::steady_clock::now();
+	const auto completions = crawler::collect_completions(options.shards, crawler::shard_request_t{.query = prefix, .limit = static_cast<uint32_t>(options.limit)}, options.timeout);
+	const auto end = std::chrono::steady_clock::now();
+
+	for (const auto & [term, score]: completions) {
+		print_completion(options.query, prefix, term, score);
+	}
+
+	std::cerr << completions.size() << " completions (" << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << "us)\n";
+
+	return 0;
+}
+
+static int search_shards(const options_t & options) {
+	if (options.complete) {
+		return complete_from_shards(options);
+	}
+
+	if (options.stats) {
+		print_stats(options);
+
+		if (options.query.empty()) {
+			return 0;
+		}
+	}
+
+	const bool terminal = isatty(STDOUT_FILENO);
+
+	const auto start = std::chrono::steady_clock::now();
+	const auto results = crawler::scatter(options.shards, crawler::shard_request_t{.query = options.query, .limit = static_cast<uint32_t>(options.limit)}, options.timeout);
+	const auto hits = crawler::gather(results, options.limit);
+	const auto end = std::chrono::steady_clock::now();
+
+	for (const auto & hit: hits) {
+		print_hit(hit.score, hit.url, hit.anchor, &hit.snippet, terminal);
+	}
+
+	bool all_answered = true;
+
+	for (const auto & result: results) {
+		std::cerr << "shard " << result.shard.native() << ": ";
+
+		if (result.response) {
+			std::cerr << result.response->hits.size() << " hits (" << result.latency.count() << "us, search " << result.response->search_time.count() << "us)\n";
+		} else if (result.timed_out) {
+			std::cerr << "timed out (" << result.latency.count() << "us)\n";
+			all_answered = false;
+		} else {
+			std::cerr << "no answer (" << result.latency.count() << "us)\n";
+			all_answered = false;
+		}
+	}
+
+	std::cerr << hits.size() << " hits (" << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << "us)\n";
+
+	// results are still useful when some shard is missing, but caller should know
+	return all_answered ? 0 : 2;
+}
+
+template <size_t N> static int search_index(const options_t & options) {
+	const auto index = crawler::layered_reader<N>::open(options.prefix);
+
+	if (!index) {
+		std::cerr << "can't open index: " << options.prefix << "\n";
+		return 1;
+	}
+
+	if (options.complete) {
+		const auto prefix = typed_prefix(options.query);
+
+		const auto start = std::chrono::steady_clock::now();
+		const auto completions = index->complete(prefix, options.limit);
+		const auto end = std::chrono::steady_clock::now();
+
+		for (const auto & item: completions) {
+			print_completion(options.query, prefix, item.term, item.score);
+		}
+
+		std::cerr << completions.size() << " completions (" << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << "us)\n";
+		return 0;
+	}
+
+	std::cerr << "intersection kernel = " << crawler::kernel_name(crawler::selected_intersection_kernel()) << "\n";
+
+	const auto start = std::chrono::steady_clock::now();
+	const auto hits = crawler::search(*index, options.query, options.limit);
+	const auto end = std::chrono::steady_clock::now();
+
+	const bool terminal = isatty(STDOUT_FILENO);
+
+	for (const auto & hit: hits) {
+		const auto anchor = index->nearest_target(hit.id, hit.position);
+		const auto snippet = index->snippet(hit.id, hit.position, hit.length);
+		print_hit(hit.score, index->url(hit.id).value_or("?"), anchor ? anchor->target : std::string_view{}, snippet ? &*snippet : nullptr, terminal);
+	}
+
+	std::cerr << hits.size() << " hits (" << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << "us)\n";
+	return 0;
+}
+
+int main(int argc, char ** argv) {
+	const auto options = parse_arguments(argc, argv);
+
+	if (!options.shards.empty()) {
+		return search_shards(options);
+	}
+
+	// index is read by code specialized for size of its ngrams
+	const auto ngram_size = crawler::dictionary_ngram_size(options.prefix / "ngrams.bin");
+
+	if (!ngram_size) {
+		std::cerr << "can't open index: " << options.prefix << "\n";
+		return 1;
+	}
+
+	return crawler::with_ngram_size(*ngram_size, [&](auto n) {
+		return search_index<decltype(n)::value>(options);
+	});
+}
@@ -0,0 +1,89 @@
+#include "files.hpp"
+#include <crawler/document-store.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace {
+
+// store with a short document, an empty one and one over several blocks
+auto saved_store(const std::filesystem::path & name) -> std::string {
+	std::string long_text;
+	for (int i = 0; long_text.size() < 3u * crawler::text_block_size; ++i) {
+		long_text += "word" + std::to_string(i) + " ";
+	}
+
+	const auto texts = std::vector<crawler::compressed_text_t>{crawler::compress_text("hello world"), crawler::compress_text(""), crawler::compress_text(long_text)};
+	std::vector<const crawler::compressed_text_t *> documents;
+	for (const auto & text: texts) {
+		documents.push_back(&text);
+	}
+
+	crawler::save_document_store(name, documents);
+	return long_text;
+}
+
+} // namespace
+
+TEST_CASE("document store gives back saved text") {
+	const auto name = temporary_file("text.bin");
+	const auto long_text = saved_store(name);
+
+	const auto store = crawler::document_store::open(name);
+	REQUIRE(store.has_value());
+
+	CHECK(store->documents() == 3u);
+	CHECK(store->extract(0, 0, 100) == "hello world");
+	CHECK(store->extract(0, 6, 5) == "world");
+	CHECK(store->extract(1, 0, 10) == "");
+	CHECK(store->extract(2, 4000, 300) == long_text.substr(4000, 300));
+	CHECK(store->extract(2, 100, 0xFFFFFFFFu) == long_text.substr(100));
+	CHECK_FALSE(store->extract(3, 0, 10).has_value());
+
+	std::filesystem::remove(name);
+}
+
+TEST_CASE("truncated or corrupted document store is not opened") {
+	const auto name = temporary_file("text.bin");
+	saved_store(name);
+
+	const auto content = read_file(name);
+	const auto broken = temporary_file("broken-text.bin");
+
+	// header: magic, version, block size, count, first block[4], text size[3], block offset[...]
+	constexpr size_t first_block = 16;
+	constexpr size_t block_offset = first_block + 4u * 4u + 3u * 4u;
+
+	SECTION("truncated data") {
+		write_file(broken, std::string_view(content).substr(0, content.size() - 10u));
+	}
+
+	SECTION("truncated tables") {
+		write_file(broken, std::string_view(content).substr(0, block_offset + 4u));
+	}
+
+	SECTION("blocks of documents are not monotonic") {
+		auto copy = content;
+		copy[first_block + 4u] = 5;
+		write_file(broken, copy);
+	}
+
+	SECTION("size of document doesn't match its blocks") {
+		auto copy = content;
+		copy[first_block + 4u * 4u] = static_cast<char>(0xFF);
+		copy[first_block + 4u * 4u + 1u] = static_cast<char>(0xFF);
+		write_file(broken, copy);
+	}
+
+	SECTION("block offset behind end of data") {
+		auto copy = content;
+		copy[block_offset + 8u + 4u] = 1;
+		write_file(broken, copy);
+	}
+
+	CHECK_FALSE(crawler::document_store::open(broken).has_value());
+
+	std::filesystem::remove(broken);
+	std::filesystem::remove(name);
+}
@@ -0,0 +1,26 @@
+#ifndef CRAWLER_TESTS_FILES_HPP
+#define CRAWLER_TESTS_FILES_HPP
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+// files of tests are in the temporary directory, corrupted copies are written by hand
+
+inline auto temporary_file(std::string_view name) -> std::filesystem::path {
+	return std::filesystem::temp_directory_path() / ("crawler-tests-" + std::string(name));
+}
+
+inline auto read_file(const std::filesystem::path & name) -> std::string {
+	auto in = std::ifstream{name, std::ios_base::binary};
+	return std::string(std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{});
+}
+
+inline void write_file(const std::filesystem::path & name, std::string_view content) {
+	auto of = std::ofstream{name, std::ios_base::binary | std::ios_base::trunc};
+	of.write(content.data(), static_cast<std::streamsize>(content.size()));
+}
+
+#endif
@@ -0,0 +1,183 @@
+#include <crawler/fuzzy.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using crawler::occurence_t;
+using crawler::similar_occurence_t;
+
+namespace {
+
+// postings of every ngram of whole texts, same interface as readers have for `find_similar`
+struct texts_index_t {
+	static constexpr size_t ngram_size = 3;
+	using ngram_type = crawler::ngram_t<ngram_size>;
+
+	std::map<ngram_type, std::vector<occurence_t>> leaves{};
+
+	explicit texts_index_t(std::initializer_list<std::string_view> texts) {
+		uint32_t id = 0;
+
+		for (std::string_view text: texts) {
+			auto builder = crawler::ngram_builder_t<ngram_size>{};
+
+			for (char c: text) {
+				if (builder.push(static_cast<char8_t>(c))) {
+					leaves[builder.ngram()].push_back(occurence_t{.id = id, .position = builder.position()});
+				}
+			}
+
+			++id;
+		}
+	}
+
+	auto lookup(ngram_type ngram) const -> std::optional<crawler::dictionary_entry_t> {
+		const auto it = leaves.find(ngram);
+
+		if (it == leaves.end()) {
+			return std::nullopt;
+		}
+
+		return crawler::dictionary_entry_t{.postings = static_cast<uint32_t>(it->second.size()), .bytes = 0, .documents = 0};
+	}
+
+	auto postings(ngram_type ngram) const -> std::vector<occurence_t> {
+		const auto it = leaves.find(ngram);
+		return (it != leaves.end()) ? it->second : std::vector<occurence_t>{};
+	}
+};
+
+auto places_of(const std::vector<similar_occurence_t> & found) -> std::vector<occurence_t> {
+	std::vector<occurence_t> output;
+	for (const similar_occurence_t & item: found) {
+		output.push_back(item.occurence);
+	}
+	return output;
+}
+
+constexpr auto at(uint32_t id, uint32_t position) -> occurence_t {
+	return occurence_t{.id = id, .position = crawler::position_t{position}};
+}
+
+// every list is checked, nothing is dropped as too common
+constexpr auto all_lists = crawler::fuzzy_options_t{.max_common_ratio = std::numeric_limits<double>::infinity()};
+
+} // namespace
+
+TEST_CASE("fuzzy search finds the word itself") {
+	const auto index = texts_index_t{"std::allocator<char>"};
+	const auto found = crawler::find_similar(index, "allocator", all_lists);
+
+	REQUIRE(found.size() == 1u);
+	CHECK(found[0].occurence == at(0, 5));
+	CHECK(found[0].matched == 7u);
+	CHECK(found[0].ngrams == 7u);
+	CHECK(found[0].similarity() == 1.0);
+}
+
+TEST_CASE("fuzzy search tolerates one wrong, missing or extra character") {
+	// "allocator" starts at 5 of the text, rest of the word is one character off after the typo
+	const auto index = texts_index_t{"std::allocator<char>"};
+
+	const auto check = [&](std::string_view typo, uint32_t matched) {
+		const auto found = crawler::find_similar(index, typo, all_lists);
+		INFO(typo);
+		REQUIRE(found.size() == 1u);
+		CHECK(found[0].occurence.id == 0u);
+		CHECK(found[0].occurence.position.n >= 4u);
+		CHECK(found[0].occurence.position.n <= 6u);
+		CHECK(found[0].matched == matched);
+	};
+
+	SECTION("missing") {
+		check("alocator", 5u);
+		check("allocatr", 5u);
+	}
+
+	SECTION("extra") {
+		// "all" is one character off from the others, so it still matches
+		check("alllocator", 7u);
+		check("allocattor", 6u);
+	}
+
+	SECTION("wrong") {
+		check("allocetor", 4u);
+		check("xllocator", 6u);
+	}
+}
+
+TEST_CASE("fuzzy search doesn't find other words") {
+	const auto index = texts_index_t{"set_difference, set_union and std::vector<int>"};
+
+	CHECK(crawler::find_similar(index, "set_intersecton", all_lists).empty());
+	CHECK(crawler::find_similar(index, "allocator", all_lists).empty());
+	CHECK(crawler::find_similar(index, "qqqqq", all_lists).empty());
+	CHECK(crawler::find_similar(index, "ab", all_lists).empty());
+}
+
+TEST_CASE("fuzzy search merges places of all documents in order") {
+	const auto index = texts_index_t{
+		"nothing here",
+		"vector and vectr and vector",
+		"no",
+		"a vectors",
+		"std::vector",
+	};
+
+	const auto found = crawler::find_similar(index, "vectro", all_lists);
+	const auto places = places_of(found);
+
+	// one place is reported once even when it's found from several aligned starts
+	REQUIRE(places.size() == 5u);
+	CHECK(std::ranges::is_sorted(places));
+	CHECK(std::ranges::adjacent_find(places) == places.end());
+
+	CHECK(places[0] == at(1, 0));
+	CHECK(places[1].id == 1u);
+	CHECK(places[1].position.n == 11u);
+	CHECK(places[2] == at(1, 21));
+	CHECK(places[3] == at(3, 2));
+	CHECK(places[4] == at(4, 5));
+
+	for (const similar_occurence_t & item: found) {
+		CHECK(item.matched <= item.ngrams);
+		CHECK(item.similarity() >= 0.5);
+	}
+}
+
+TEST_CASE("fuzzy search loses nothing within the edit limit when common ngrams are not checked") {
+	// "tion" and "ion" are everywhere, the word is in few documents
+	const auto index = texts_index_t{
+		"intersection of sets",
+		"set_intersection(first, last)",
+		"conversion function motion action",
+		"set_intersecton is a typo",
+		"function application notation option",
+		"union and intersections",
+		"operation description collection selection",
+		"std::set_intersection and std::set_union",
+	};
+
+	const auto with_all = crawler::find_similar(index, "set_intersection", all_lists);
+	const auto without_common = crawler::find_similar(index, "set_intersection", crawler::fuzzy_options_t{.max_common_ratio = 0.0});
+
+	REQUIRE_FALSE(with_all.empty());
+	REQUIRE_FALSE(without_common.empty());
+	CHECK(without_common.front().ngrams < with_all.front().ngrams);
+
+	const auto all_places = places_of(with_all);
+	const auto places = places_of(without_common);
+
+	for (const occurence_t & place: all_places) {
+		CHECK(std::ranges::find(places, place) != places.end());
+	}
+
+	CHECK(std::ranges::find(places, at(1, 0)) != places.end());
+	CHECK(std::ranges::find(places, at(3, 0)) != places.end());
+	CHECK(std::ranges::find(places, at(7, 5)) != places.end());
+}
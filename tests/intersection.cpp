@@ -0,0 +1,219 @@
+#include <crawler/intersection.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <vector>
+
+using crawler::occurence_t;
+using crawler::position_t;
+
+// every kernel is checked against std::ranges algorithms on same input
+
+namespace {
+
+// sorted and unique occurences with ids below `max_id` and positions below `max_position`
+auto random_occurences(size_t count, uint32_t max_id, uint32_t max_position, unsigned seed) -> std::vector<occurence_t> {
+	auto engine = std::mt19937{seed};
+	auto id = std::uniform_int_distribution<uint32_t>{0, max_id - 1u};
+	auto position = std::uniform_int_distribution<uint32_t>{0, max_position - 1u};
+
+	std::vector<occurence_t> output;
+	output.reserve(count);
+
+	for (size_t i = 0; i != count; ++i) {
+		output.push_back(occurence_t{.id = id(engine), .position = position_t{position(engine)}});
+	}
+
+	std::ranges::sort(output);
+	const auto duplicates = std::ranges::unique(output);
+	output.erase(duplicates.begin(), duplicates.end());
+
+	return output;
+}
+
+auto occurences(std::initializer_list<uint32_t> ids) -> std::vector<occurence_t> {
+	std::vector<occurence_t> output;
+	for (uint32_t id: ids) {
+		output.push_back(occurence_t{.id = id, .position = position_t{0}});
+	}
+	return output;
+}
+
+auto reference_intersection(crawler::occurences_view lhs, crawler::occurences_view rhs) -> std::vector<occurence_t> {
+	std::vector<occurence_t> output;
+	std::ranges::set_intersection(lhs, rhs, std::back_inserter(output));
+	return output;
+}
+
+auto reference_subtraction(crawler::occurences_view lhs, crawler::occurences_view rhs) -> std::vector<occurence_t> {
+	std::vector<occurence_t> output;
+	std::ranges::set_difference(lhs, rhs, std::back_inserter(output));
+	return output;
+}
+
+// all pairwise kernels give same result
+void check_all_kernels(crawler::occurences_view lhs, crawler::occurences_view rhs) {
+	const auto expected = reference_intersection(lhs, rhs);
+
+	CHECK(crawler::merge_intersection(lhs, rhs) == expected);
+	CHECK(crawler::simd_intersection(lhs, rhs) == expected);
+	CHECK(crawler::galloping_intersection(lhs, rhs) == expected);
+	CHECK(crawler::intersection(lhs, rhs) == expected);
+
+	// order of arguments doesn't matter
+	CHECK(crawler::simd_intersection(rhs, lhs) == expected);
+	CHECK(crawler::galloping_intersection(rhs, lhs) == expected);
+	CHECK(crawler::intersection(rhs, lhs) == expected);
+}
+
+} // namespace
+
+TEST_CASE("intersection of empty inputs") {
+	const auto some = occurences({1, 2, 3, 4, 5, 6, 7, 8});
+	const auto nothing = std::vector<occurence_t>{};
+
+	check_all_kernels(nothing, nothing);
+	check_all_kernels(some, nothing);
+	check_all_kernels(nothing, some);
+
+	const auto sets = std::vector<crawler::occurences_view>{some, nothing, some};
+	CHECK(crawler::intersection(sets).empty());
+	CHECK(crawler::intersection(sets, 3).empty());
+	CHECK(crawler::intersection(std::span<const crawler::occurences_view>{}).empty());
+}
+
+TEST_CASE("intersection of disjoint inputs") {
+	std::vector<occurence_t> even;
+	std::vector<occurence_t> odd;
+
+	for (uint32_t i = 0; i != 1000; ++i) {
+		((i % 2u == 0u) ? even : odd).push_back(occurence_t{.id = i, .position = position_t{i}});
+	}
+
+	check_all_kernels(even, odd);
+
+	// same id, different positions
+	const auto a = std::vector<occurence_t>{{.id = 1, .position = position_t{1}}, {.id = 1, .position = position_t{3}}};
+	const auto b = std::vector<occurence_t>{{.id = 1, .position = position_t{2}}, {.id = 1, .position = position_t{4}}};
+	check_all_kernels(a, b);
+}
+
+TEST_CASE("intersection of identical inputs") {
+	const auto data = random_occurences(5000, 100, 1000, 1);
+
+	check_all_kernels(data, data);
+	CHECK(crawler::intersection(data, data) == data);
+}
+
+TEST_CASE("SIMD intersection with lengths which are not multiples of 4") {
+	INFO("kernel = " << crawler::kernel_name(crawler::selected_intersection_kernel()));
+
+	// dense values, so blocks of both sides overlap in all possible ways
+	for (size_t lhs_size = 0; lhs_size != 23; ++lhs_size) {
+		for (size_t rhs_size = 0; rhs_size != 23; ++rhs_size) {
+			const auto seed = static_cast<unsigned>(lhs_size * 100u + rhs_size);
+			const auto lhs = random_occurences(lhs_size, 8, 4, seed);
+			const auto rhs = random_occurences(rhs_size, 8, 4, seed + 50000u);
+
+			INFO("lhs = " << lhs.size() << ", rhs = " << rhs.size());
+			CHECK(crawler::simd_intersection(lhs, rhs) == reference_intersection(lhs, rhs));
+			CHECK(crawler::simd_intersection(rhs, lhs) == reference_intersection(lhs, rhs));
+		}
+	}
+
+	// match in the tail after the last whole block
+	const auto lhs = occurences({1, 2, 3, 4, 5, 6, 7, 8, 100});
+	const auto rhs = occurences({9, 10, 11, 12, 100});
+	CHECK(crawler::simd_intersection(lhs, rhs) == occurences({100}));
+}
+
+TEST_CASE("galloping intersection of really different sizes") {
+	const auto big = random_occurences(200000, 20000, 1000, 2);
+
+	for (size_t small_size: {1u, 3u, 10u, 100u, 1000u}) {
+		// half of them from the big side, so there is something to find
+		auto small = random_occurences(small_size, 20000, 1000, static_cast<unsigned>(small_size));
+		for (size_t i = 0; i < small_size; i += 2u) {
+			small.push_back(big[(i * 7919u) % big.size()]);
+		}
+		std::ranges::sort(small);
+		const auto duplicates = std::ranges::unique(small);
+		small.erase(duplicates.begin(), duplicates.end());
+
+		INFO("small = " << small.size() << ", big = " << big.size());
+		check_all_kernels(small, big);
+	}
+
+	// everything from the small side is before or after the big one
+	const auto before = occurences({0, 1});
+	const auto after = occurences({30000, 30001});
+	check_all_kernels(before, big);
+	check_all_kernels(after, big);
+}
+
+TEST_CASE("intersection with limit") {
+	const auto lhs = random_occurences(3000, 50, 100, 3);
+	const auto rhs = random_occurences(3000, 50, 100, 4);
+	const auto expected = reference_intersection(lhs, rhs);
+
+	REQUIRE(expected.size() > 10u);
+
+	for (size_t limit: {1u, 2u, 5u, 10u}) {
+		const auto prefix = std::vector<occurence_t>(expected.begin(), expected.begin() + static_cast<std::ptrdiff_t>(limit));
+		CHECK(crawler::merge_intersection(lhs, rhs, limit) == prefix);
+		CHECK(crawler::simd_intersection(lhs, rhs, limit) == prefix);
+		CHECK(crawler::galloping_intersection(lhs, rhs, limit) == prefix);
+		CHECK(crawler::intersection(lhs, rhs, limit) == prefix);
+	}
+
+	// bigger than whole result
+	CHECK(crawler::intersection(lhs, rhs, expected.size() + 10u) == expected);
+}
+
+TEST_CASE("k-way intersection with limit") {
+	const auto a = random_occurences(20000, 40, 200, 5);
+	const auto b = random_occurences(8000, 40, 200, 6);
+	const auto c = random_occurences(12000, 40, 200, 7);
+
+	const auto expected = reference_intersection(reference_intersection(a, b), c);
+	REQUIRE(!expected.empty());
+
+	const auto sets = std::vector<crawler::occurences_view>{a, b, c};
+
+	CHECK(crawler::intersection(sets) == expected);
+	CHECK(crawler::intersection(sets, 0) == expected);
+
+	for (size_t limit = 1; limit <= expected.size() + 1u; limit = limit * 2u + 1u) {
+		const auto count = std::min(limit, expected.size());
+		const auto prefix = std::vector<occurence_t>(expected.begin(), expected.begin() + static_cast<std::ptrdiff_t>(count));
+
+		INFO("limit = " << limit);
+		CHECK(crawler::intersection(sets, limit) == prefix);
+	}
+
+	// single set is just copied
+	const auto single = std::vector<crawler::occurences_view>{b};
+	CHECK(crawler::intersection(single) == b);
+	CHECK(crawler::intersection(single, 3) == std::vector<occurence_t>(b.begin(), b.begin() + 3));
+}
+
+TEST_CASE("subtraction") {
+	const auto lhs = random_occurences(5000, 100, 100, 8);
+	const auto rhs = random_occurences(5000, 100, 100, 9);
+
+	CHECK(crawler::subtraction(lhs, rhs) == reference_subtraction(lhs, rhs));
+	CHECK(crawler::subtraction(rhs, lhs) == reference_subtraction(rhs, lhs));
+	CHECK(crawler::subtraction(lhs, lhs).empty());
+	CHECK(crawler::subtraction(lhs, {}) == lhs);
+	CHECK(crawler::subtraction({}, rhs).empty());
+
+	// small left side is galloped through big right one
+	const auto big = random_occurences(100000, 10000, 100, 10);
+	auto small = occurences({0, 5, 9999});
+	small.insert(small.end(), big.begin() + 1000, big.begin() + 1003);
+	std::ranges::sort(small);
+
+	CHECK(crawler::subtraction(small, big) == reference_subtraction(small, big));
+	CHECK(crawler::subtraction(big, small) == reference_subtraction(big, small));
+}
@@ -0,0 +1,91 @@
+#include <crawler/shard.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <array>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <cerrno>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+// both ends of a connected stream socket
+struct socket_pair_t {
+	std::array<int, 2> fd{-1, -1};
+
+	socket_pair_t() {
+		REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fd.data()) == 0);
+	}
+
+	socket_pair_t(const socket_pair_t &) = delete;
+
+	~socket_pair_t() noexcept {
+		for (int item: fd) {
+			::close(item);
+		}
+	}
+};
+
+auto in(std::chrono::milliseconds timeout) -> crawler::deadline_t {
+	return std::chrono::steady_clock::now() + timeout;
+}
+
+} // namespace
+
+TEST_CASE("messages go through a socket whole") {
+	const auto sockets = socket_pair_t{};
+	const auto payload = crawler::encode_request(crawler::shard_request_t{.query = "std::vector", .limit = 7});
+
+	REQUIRE(crawler::send_message(sockets.fd[0], payload, in(std::chrono::seconds{1})));
+
+	const auto received = crawler::receive_message(sockets.fd[1], in(std::chrono::seconds{1}));
+	REQUIRE(received.has_value());
+	CHECK(*received == payload);
+
+	const auto request = crawler::decode_request(*received);
+	REQUIRE(request.has_value());
+	CHECK(request->query == "std::vector");
+	CHECK(request->limit == 7u);
+}
+
+TEST_CASE("silent peer times out at the deadline") {
+	const auto sockets = socket_pair_t{};
+
+	SECTION("nothing is sent") { }
+
+	SECTION("only part of the message is sent") {
+		const std::string partial{"\x10\x00\x00\x00QURY", 8};
+		REQUIRE(::send(sockets.fd[0], partial.data(), partial.size(), 0) == static_cast<ssize_t>(partial.size()));
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	errno = 0;
+	CHECK_FALSE(crawler::receive_message(sockets.fd[1], in(std::chrono::milliseconds{50})).has_value());
+	CHECK(errno == ETIMEDOUT);
+	CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds{50});
+}
+
+TEST_CASE("too long message is not allocated") {
+	const auto sockets = socket_pair_t{};
+
+	// length prefix only, nothing follows
+	const std::string header{"\xff\xff\xff\xff", 4};
+	REQUIRE(::send(sockets.fd[0], header.data(), header.size(), 0) == 4);
+
+	errno = 0;
+	CHECK_FALSE(crawler::receive_message(sockets.fd[1], in(std::chrono::seconds{1})).has_value());
+	CHECK(errno == EMSGSIZE);
+
+	CHECK_FALSE(crawler::send_message(sockets.fd[0], std::string(crawler::max_message_size + 1u, 'x')));
+	CHECK(errno == EMSGSIZE);
+}
+
+TEST_CASE("closed peer is not a timeout") {
+	auto sockets = socket_pair_t{};
+	::close(std::exchange(sockets.fd[0], -1));
+
+	errno = 0;
+	CHECK_FALSE(crawler::receive_message(sockets.fd[1], in(std::chrono::seconds{1})).has_value());
+	CHECK(errno != ETIMEDOUT);
+}
@@ -0,0 +1,91 @@
+#include "files.hpp"
+#include <crawler/url-dictionary.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+// more than two blocks, with shared prefixes of all lengths, same URL twice and an empty one
+auto saved_dictionary(const std::filesystem::path & name) -> std::vector<std::string> {
+	std::vector<std::string> urls;
+	for (int i = 0; i != 40; ++i) {
+		urls.push_back("https://en.cppreference.com/w/cpp/" + std::string(static_cast<size_t>(i % 7), 'x') + std::to_string(i));
+	}
+	urls.push_back(urls.back());
+	urls.push_back("");
+	urls.push_back("http://other/");
+
+	const auto views = std::vector<std::string_view>(urls.begin(), urls.end());
+	crawler::save_url_dictionary(name, views);
+	return urls;
+}
+
+} // namespace
+
+TEST_CASE("url dictionary gives back saved URLs") {
+	const auto name = temporary_file("urls.bin");
+	const auto urls = saved_dictionary(name);
+
+	const auto dictionary = crawler::url_dictionary::open(name);
+	REQUIRE(dictionary.has_value());
+	REQUIRE(dictionary->size() == urls.size());
+
+	for (uint32_t id = 0; id != urls.size(); ++id) {
+		CHECK(dictionary->get(id) == urls[id]);
+	}
+
+	CHECK_FALSE(dictionary->get(static_cast<uint32_t>(urls.size())).has_value());
+
+	std::filesystem::remove(name);
+}
+
+TEST_CASE("empty url dictionary") {
+	const auto name = temporary_file("urls.bin");
+	crawler::save_url_dictionary(name, {});
+
+	const auto dictionary = crawler::url_dictionary::open(name);
+	REQUIRE(dictionary.has_value());
+	CHECK(dictionary->size() == 0u);
+	CHECK_FALSE(dictionary->get(0).has_value());
+
+	std::filesystem::remove(name);
+}
+
+TEST_CASE("truncated or corrupted url dictionary is not opened") {
+	const auto name = temporary_file("urls.bin");
+	saved_dictionary(name);
+
+	const auto content = read_file(name);
+	const auto broken = temporary_file("broken-urls.bin");
+
+	// header: magic, version, count, block size, block offset[4]
+	constexpr size_t block_offset = 16;
+
+	SECTION("truncated data") {
+		write_file(broken, std::string_view(content).substr(0, content.size() - 1u));
+	}
+
+	SECTION("truncated offsets") {
+		write_file(broken, std::string_view(content).substr(0, block_offset + 8u));
+	}
+
+	SECTION("offsets are not monotonic") {
+		auto copy = content;
+		copy[block_offset + 4u + 2u] = 1;
+		write_file(broken, copy);
+	}
+
+	SECTION("first block doesn't start at 0") {
+		auto copy = content;
+		copy[block_offset] = 1;
+		write_file(broken, copy);
+	}
+
+	CHECK_FALSE(crawler::url_dictionary::open(broken).has_value());
+
+	std::filesystem::remove(broken);
+	std::filesystem::remove(name);
+}
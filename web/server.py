@@ -1,22 +1,166 @@
+
 # -*- coding: utf-8 -*-
 #test on python 3.4 ,python of lower version  has different module organization.
 import http.server
 from http.server import HTTPServer, BaseHTTPRequestHandler
 import socketserver
 import posixpath
+import json
+import mmap
+import os
+import re
+import struct
+import zlib
+from urllib.parse import urlparse, parse_qs
 
 PORT = 8000
 
-Handler = http.server.SimpleHTTPRequestHandler
+# reader of text.bin written by index_t::save_documents_text (see crawler/document-store.hpp)
+class DocumentStore:
+	def __init__(self, name):
+		self.file = open(name, "rb")
+		self.data = mmap.mmap(self.file.fileno(), 0, access=mmap.ACCESS_READ)
+		magic, version, self.block_size, self.count = struct.unpack_from("<4sIII", self.data, 0)
+		if magic != b"TEXT" or version != 1:
+			raise ValueError("unsupported document store: " + name)
+		offset = 16
+		self.first_block = struct.unpack_from("<%dI" % (self.count + 1), self.data, offset)
+		offset += 4 * (self.count + 1)
+		self.text_size = struct.unpack_from("<%dI" % self.count, self.data, offset)
+		offset += 4 * self.count
+		total_blocks = self.first_block[-1]
+		self.block_offset = struct.unpack_from("<%dQ" % (total_blocks + 1), self.data, offset)
+		self.start = offset + 8 * (total_blocks + 1)
+		if not self.valid():
+			raise ValueError("corrupted document store: " + name)
+
+	# same checks as document_store::valid, so extract never reads outside of the file
+	def valid(self):
+		if self.block_size == 0 or self.first_block[0] != 0 or self.block_offset[0] != 0:
+			return False
+		for id in range(self.count):
+			blocks = (self.text_size[id] + self.block_size - 1) // self.block_size
+			if self.first_block[id + 1] - self.first_block[id] != blocks:
+				return False
+		if any(self.block_offset[i + 1] < self.block_offset[i] for i in range(len(self.block_offset) - 1)):
+			return False
+		return self.start + self.block_offset[-1] <= len(self.data)
+
+	def close(self):
+		self.data.close()
+		self.file.close()
+
+	def extract(self, id, position, length):
+		size = self.text_size[id]
+		end = min(size, position + length)
+		output = b""
+		block = position // self.block_size
+		while position < end and block * self.block_size < end:
+			index = self.first_block[id] + block
+			compressed = self.data[self.start + self.block_offset[index]:self.start + self.block_offset[index + 1]]
+			text = zlib.decompress(compressed)
+			block_start = block * self.block_size
+			output += text[max(position, block_start) - block_start:end - block_start]
+			block += 1
+		return output
+
+	def snippet(self, id, position, length, context = 80):
+		begin = max(0, position - context)
+		text = self.extract(id, begin, (position - begin) + length + context)
+		match_begin = position - begin
+		match_end = match_begin + length
+		decode = lambda b: b.decode("utf-8", errors="replace")
+		return {"before": decode(text[:match_begin]), "match": decode(text[match_begin:match_end]), "after": decode(text[match_end:])}
+
+# name -> (identity of the file, store), rebuilt index is a new file, so it's opened again
+stores = {}
+
+def store_for(directory):
+	name = os.path.join(directory, "text.bin")
+	try:
+		info = os.stat(name)
+	except OSError:
+		return None
+	identity = (info.st_dev, info.st_ino, info.st_mtime_ns, info.st_size)
+	cached = stores.get(name)
+	if cached is not None and cached[0] == identity:
+		return cached[1]
+	if cached is not None:
+		cached[1].close()
+		del stores[name]
+	store = DocumentStore(name)
+	stores[name] = (identity, store)
+	return store
+
+class Handler(http.server.SimpleHTTPRequestHandler):
+	def guess_type(self, path):
+		base, ext = posixpath.splitext(path)
+		if ext in self.extensions_map:
+			return self.extensions_map[ext]
+		ext = ext.lower()
+		if ext in self.extensions_map:
+			return self.extensions_map[ext]
+		return self.extensions_map['']
+
+	# "Range: bytes=FIRST-LAST" for static files (packs, targets.bin, urls.bin are read by parts)
+	def send_range(self, header):
+		path = self.translate_path(self.path)
+		match = re.fullmatch(r"bytes=(\d*)-(\d*)", header.strip())
+		if match is None or match.groups() == ("", "") or not os.path.isfile(path):
+			return super().do_GET()
+
+		size = os.path.getsize(path)
+		first, last = match.groups()
+		if first == "":
+			first, last = max(0, size - int(last)), size - 1
+		else:
+			first, last = int(first), min(int(last), size - 1) if last != "" else size - 1
+
+		if first > last:
+			self.send_response(416)
+			self.send_header("Content-Range", "bytes */%d" % size)
+			self.end_headers()
+			return
+
+		with open(path, "rb") as file:
+			file.seek(first)
+			body = file.read(last - first + 1)
+
+		self.send_response(206)
+		self.send_header("Content-Type", self.guess_type(path))
+		self.send_header("Content-Range", "bytes %d-%d/%d" % (first, last, size))
+		self.send_header("Content-Length", str(len(body)))
+		self.send_header("Accept-Ranges", "bytes")
+		self.end_headers()
+		self.wfile.write(body)
+
+	# GET <index>/snippet?doc=ID&pos=POSITION&len=LENGTH
+	def do_GET(self):
+		url = urlparse(self.path)
+		if not url.path.endswith("/snippet"):
+			if "Range" in self.headers:
+				return self.send_range(self.headers["Range"])
+			return super().do_GET()
+
+		directory = self.translate_path(posixpath.dirname(url.path))
+		query = parse_qs(url.query)
+		try:
+			store = store_for(directory)
+			doc, pos, length = int(query["doc"][0]), int(query["pos"][0]), int(query["len"][0])
+			if doc < 0 or pos < 0 or length < 0:
+				# negative index would be taken from the end of lists
+				return self.send_error(400)
+			if store is None or doc >= store.count:
+				return self.send_error(404)
+			body = json.dumps(store.snippet(doc, pos, length)).encode("utf-8")
+		except (KeyError, ValueError, struct.error, zlib.error):
+			return self.send_error(400)
 
-def guess_type(self, path):
-	base, ext = posixpath.splitext(path)
-	if ext in self.extensions_map:
-		return self.extensions_map[ext]
-	ext = ext.lower()
-	if ext in self.extensions_map:
-		return self.extensions_map[ext]
-	return self.extensions_map['']
+		self.send_response(200)
+		self.send_header("Content-Type", "application/json")
+		self.send_header("Content-Length", str(len(body)))
+		self.end_headers()
+		self.wfile.write(body)
 
 Handler.extensions_map[''] = "text/html";
 Handler.extensions_map['.html'] = "text/html";
@@ -24,9 +168,8 @@ Handler.extensions_map['.htm'] = "text/html";
 Handler.extensions_map['.css'] = "text/css";
 Handler.extensions_map['.js'] = "text/javascript";
 Handler.extensions_map['.json'] = "application/json";
-Handler.guess_type = guess_type
 
 httpd = socketserver.TCPServer(("", PORT), Handler)
 
 print("serving at port", PORT)
-httpd.serve_forever()
\ No newline at end of file
+httpd.serve_forever()